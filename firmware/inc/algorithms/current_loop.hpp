@@ -0,0 +1,35 @@
+#pragma once
+
+#include "algorithms/pid.hpp"
+
+namespace algorithm {
+
+/// @brief Current loop for one motor on a DRV8874.
+///
+/// The driver IPROPI output only gives the current magnitude, so the reading takes the sign of the voltage applied
+/// on the last cycle, the direction the driver is pushing current in. With no voltage applied it takes the sign of
+/// the target. The motor model gives the feed-forward voltage and the PI closes the remaining current error.
+class CurrentLoop {
+public:
+    CurrentLoop() {};
+    CurrentLoop(float ra_ohm, float kt, float kp, float ki, float integral_limit);
+
+    // Freely updatable constants
+    float ra_ohm; // Armature resistance [Ohm]
+    float kt;     // Torque and back EMF constant [Nm/A]
+    PID pid;
+
+    /// @brief Runs one loop step
+    /// @param target_a Signed current reference [A]
+    /// @param measured_a Current magnitude read from the driver [A]
+    /// @param ang_vel_rad_s Motor angular velocity [rad/s]
+    /// @param last_volts Voltage applied on the last step [V]
+    /// @return The voltage to apply [V]
+    float calculate(float target_a, float measured_a, float ang_vel_rad_s, float last_volts);
+    /// @brief Signed current from the magnitude and the applied voltage [A]
+    static float signed_current(float measured_a, float last_volts, float target_a);
+
+    void reset();
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+namespace algorithm {
+
+/// @brief Disturbance observer for a single wheel.
+///
+/// Estimates the external load on the wheel, in motor current units [A], as the difference between the current the
+/// driver is applying and the current needed to produce the measured wheel acceleration. The estimate is low-pass
+/// filtered so it only follows disturbances slower than the cutoff frequency.
+class DisturbanceObserver {
+public:
+    DisturbanceObserver() {};
+    DisturbanceObserver(float inertia_k, float cutoff_hz, float limit);
+
+    // Freely updatable constants
+    float inertia_k; // Current needed per wheel angular acceleration [A / (rad/s^2)]
+    float cutoff_hz;
+    float limit;
+
+    /// @brief Runs one observer step
+    /// @param applied_current Current applied to the motor on the last cycle [A]
+    /// @param wheel_ang_vel Measured wheel angular velocity [rad/s]
+    /// @param dt Time since the last step [s]
+    /// @return The disturbance estimate [A]
+    float update(float applied_current, float wheel_ang_vel, float dt);
+    float get_estimate() const { return estimate; }
+
+    void reset();
+
+private:
+    float estimate = 0.0f;
+    float previous_ang_vel = 0.0f;
+    bool has_previous = false;
+};
+
+}
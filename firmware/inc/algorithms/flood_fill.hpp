@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -18,10 +20,16 @@ enum Walls : uint8_t {
 
 namespace algorithm {
 
+/// @brief Wall confidence, observations add or remove evidence and LOCKED walls never change
+static constexpr uint8_t WALL_CONFIDENCE_LOCKED = 255;
+static constexpr std::array<uint8_t, 4> WALL_CONFIDENCE_FULL = {
+    WALL_CONFIDENCE_LOCKED, WALL_CONFIDENCE_LOCKED, WALL_CONFIDENCE_LOCKED, WALL_CONFIDENCE_LOCKED};
+
 struct Cell {
     uint8_t distance;
     uint8_t walls;
     uint8_t known_walls;
+    uint8_t confidence[4]; // Indexed by Direction
 
     bool visited() { return known_walls == 0b1111; }
 
@@ -30,40 +38,58 @@ struct Cell {
     Cell* south;
     Cell* west;
 
-    void update_walls(uint8_t walls) {
-        this->walls = walls;
-        this->known_walls = 0b1111;
+    void update_walls(uint8_t walls) { update_walls(walls, WALL_CONFIDENCE_FULL); }
 
-        if (walls & N && (north != nullptr)) {
-            north->walls |= S;
-            north->known_walls |= S;
-        } else if (north != nullptr) {
-            north->walls &= ~S;
-            north->known_walls |= S;
+    /// @brief Adds a wall observation, confidence is the evidence for each direction
+    void update_walls(uint8_t walls, std::array<uint8_t, 4> const& confidence) {
+        for (auto& d : Directions) {
+            observe_wall(d, (walls & (1 << std::to_underlying(d))) != 0, confidence[std::to_underlying(d)]);
         }
+    }
 
-        if (walls & E && (east != nullptr)) {
-            east->walls |= W;
-            east->known_walls |= W;
-        } else if (east != nullptr) {
-            east->walls &= ~W;
-            east->known_walls |= W;
+    Cell* neighbor(Direction d) {
+        switch (d) {
+        case Direction::NORTH:
+            return north;
+        case Direction::WEST:
+            return west;
+        case Direction::SOUTH:
+            return south;
+        case Direction::EAST:
+            return east;
+        default:
+            return nullptr;
         }
+    }
 
-        if (walls & S && (south != nullptr)) {
-            south->walls |= N;
-            south->known_walls |= N;
-        } else if (south != nullptr) {
-            south->walls &= ~N;
-            south->known_walls |= N;
+private:
+    void observe_wall(Direction d, bool has_wall, uint8_t weight) {
+        uint8_t idx = std::to_underlying(d);
+        uint8_t bit = 1 << idx;
+
+        if (!(known_walls & bit) || weight == WALL_CONFIDENCE_LOCKED) {
+            walls = has_wall ? (walls | bit) : (walls & ~bit);
+            confidence[idx] = weight;
+        } else if (confidence[idx] == WALL_CONFIDENCE_LOCKED) {
+            return;
+        } else if (((walls & bit) != 0) == has_wall) {
+            confidence[idx] = std::min(confidence[idx] + weight, WALL_CONFIDENCE_LOCKED - 1);
+        } else if (weight > confidence[idx]) {
+            // Re-observation outweighs what we had, flip the wall
+            walls ^= bit;
+            confidence[idx] = weight - confidence[idx];
+        } else {
+            confidence[idx] -= weight;
         }
-
-        if (walls & W && (west != nullptr)) {
-            west->walls |= E;
-            west->known_walls |= E;
-        } else if (west != nullptr) {
-            west->walls &= ~E;
-            west->known_walls |= E;
+        known_walls |= bit;
+
+        Cell* other = neighbor(d);
+        if (other != nullptr) {
+            uint8_t other_idx = (idx + 2) % 4;
+            uint8_t other_bit = 1 << other_idx;
+            other->walls = (walls & bit) ? (other->walls | other_bit) : (other->walls & ~other_bit);
+            other->known_walls |= other_bit;
+            other->confidence[other_idx] = confidence[idx];
         }
     }
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace algorithm {
+
+/// @brief Online gyro Z bias estimator.
+///
+/// Refines the bias while the robot is standing still: wheels stopped, rate close to the current bias and the
+/// accelerometer reading just gravity, held for settle_time_s. The bias is modeled as bias + temp_coefficient * (T -
+/// T_ref), so it keeps being corrected between still periods when the coefficient is known.
+class GyroBiasEstimator {
+public:
+    GyroBiasEstimator() {};
+    GyroBiasEstimator(float settle_time_s, float tau_s, float gyro_threshold_dps, float acc_threshold_g);
+
+    // Freely updatable constants
+    float settle_time_s;
+    float tau_s;
+    float gyro_threshold_dps;
+    float acc_threshold_g;
+    float temp_coefficient_dps_c = 0.0f;
+
+    /// @brief Runs one estimator step
+    /// @param gyro_dps Raw Z rate, bias included [deg/s]
+    /// @param acc_norm_g Accelerometer norm [g]
+    /// @param temperature_c IMU temperature [°C]
+    /// @param wheels_still True if the encoders see no movement
+    /// @param dt Time since the last step [s]
+    /// @return The bias to remove from the rate [deg/s]
+    float update(float gyro_dps, float acc_norm_g, float temperature_c, bool wheels_still, float dt);
+    float get_bias(float temperature_c) const;
+    bool is_still() const { return still; }
+
+    void reset(float bias_dps);
+
+private:
+    float bias_dps = 0.0f;
+    float reference_temperature_c = 0.0f;
+    bool has_reference_temperature = false;
+    float still_time_s = 0.0f;
+    bool still = false;
+};
+
+}
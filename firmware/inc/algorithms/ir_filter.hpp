@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace algorithm {
+
+/// @brief Constant time filter for a single IR channel.
+///
+/// The moving average keeps a running sum, so each update costs one add and one subtract regardless of the window
+/// size. The IIR is a first order low-pass with alpha = 1 / 2^shift, kept in fixed point.
+class IrFilter {
+public:
+    enum FilterType : uint8_t {
+        NONE = 0,
+        MOVING_AVERAGE = 1,
+        IIR = 2,
+    };
+
+    static constexpr size_t MAX_WINDOW = 32;
+
+    IrFilter() {};
+    IrFilter(FilterType type, size_t window, uint8_t iir_shift);
+
+    void configure(FilterType type, size_t window, uint8_t iir_shift);
+    uint32_t update(uint32_t new_value);
+    uint32_t get_output() const { return output; }
+
+    void reset();
+
+private:
+    FilterType type = MOVING_AVERAGE;
+    size_t window = 20;
+    uint8_t iir_shift = 3;
+
+    uint32_t samples[MAX_WINDOW] = {0};
+    size_t idx = 0;
+    size_t count = 0;
+    uint32_t sum = 0;
+    uint32_t iir_state = 0; // Output << iir_shift
+    uint32_t output = 0;
+};
+
+/// @brief Adds up each channel of an interleaved DMA buffer in one pass, the accumulators stay in registers
+/// @param data First frame, the channels of a frame are consecutive
+/// @param frames Number of frames to add
+/// @param sums Per channel sums
+template <size_t CHANNELS>
+inline void sum_interleaved(const uint32_t* data, size_t frames, uint32_t (&sums)[CHANNELS]) {
+    uint32_t acc[CHANNELS] = {0};
+    const uint32_t* end = data + frames * CHANNELS;
+    for (const uint32_t* frame = data; frame < end; frame += CHANNELS) {
+        for (size_t i = 0; i < CHANNELS; i++) {
+            acc[i] += frame[i];
+        }
+    }
+
+    for (size_t i = 0; i < CHANNELS; i++) {
+        sums[i] = acc[i];
+    }
+}
+
+}
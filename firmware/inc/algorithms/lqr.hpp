@@ -0,0 +1,41 @@
+#pragma once
+
+namespace algorithm {
+
+/// @brief Discrete LQR for the linear/angular velocity dynamics.
+///
+/// State is [e_v, e_w, int(e_v), int(e_w)], with errors as target - measured, and the outputs are the linear and
+/// angular commands in motor current units [A], same as the velocity PIDs. Gains come from scripts/lqr_gains.py.
+/// With matched motors the model has no coupling and the default gains are two SISO LQRs, the full matrix only
+/// matters for gains computed with a motor mismatch.
+class LQR {
+public:
+    static constexpr int STATES = 4;
+    static constexpr int INPUTS = 2;
+
+    LQR() {};
+    LQR(const float (&gains)[INPUTS][STATES], float integral_limit_linear, float integral_limit_angular);
+
+    // Freely updatable constants
+    float k[INPUTS][STATES];
+    float integral_limit_linear;  // [m]
+    float integral_limit_angular; // [rad]
+
+    /// @brief Calculates the linear and angular commands
+    /// @param freeze_linear Stops the linear integrator, used when the linear command is being clamped
+    /// @param freeze_angular Stops the angular integrator, used when the angular command is being clamped
+    void calculate(float target_v, float measured_v, float target_w, float measured_w, float dt, bool freeze_linear,
+                   bool freeze_angular, float* u_linear, float* u_angular);
+
+    void set_gains(const float (&gains)[INPUTS][STATES]);
+    float get_integral_linear() const { return integral_v; }
+    float get_integral_angular() const { return integral_w; }
+
+    void reset();
+
+private:
+    float integral_v = 0.0f;
+    float integral_w = 0.0f;
+};
+
+}
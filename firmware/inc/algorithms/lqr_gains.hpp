@@ -0,0 +1,9 @@
+#pragma once
+
+// Generated by scripts/lqr_gains.py
+// Q = [1.0, 0.01, 1000.0, 2.0], R = [0.03, 1.0], Ts = 0.001
+// Matched motors leave no cross terms, so this is two SISO LQRs, linear and angular
+static constexpr float lqr_default_k[2][4] = {
+    {8.36536f, 0.0f, 175.617f, 0.0f},
+    {0.0f, 0.123305f, 0.0f, 1.3758f},
+};
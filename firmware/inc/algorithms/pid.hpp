@@ -14,7 +14,12 @@ public:
     float integral_limit;
 
     float calculate(float const& target, float const& measured_value);
+    /// @brief Same gains for a different sample period, period_ratio = period / CONTROL_PERIOD_S
+    float calculate(float const& target, float const& measured_value, float period_ratio);
     float get_integral() const { return integral; }
+    /// @brief Changes ki keeping the I term, so a scheduled gain does not make it jump. The I term is capped by
+    /// integral_limit, and a zero ki on either side clears it
+    void set_ki(float new_ki);
 
     void reset();
 
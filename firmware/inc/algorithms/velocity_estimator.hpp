@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace algorithm {
+
+/// @brief M/T method velocity estimator for a single encoder.
+///
+/// Counts the edges of the window (M) and divides by the time between the last edge of the previous window and the
+/// last edge of this one (T), so the result is exact at low speed and keeps the count resolution at high speed. A
+/// window without edges can only bring the estimate down, to at most one edge over the time since the last one.
+class MTVelocityEstimator {
+public:
+    MTVelocityEstimator() {};
+    MTVelocityEstimator(float dist_per_tick, uint32_t max_time_without_tick_us);
+
+    // Freely updatable constants
+    float dist_per_tick;
+    uint32_t max_time_without_tick_us;
+
+    /// @brief Runs one estimator step
+    /// @param ticks Signed edges counted since the last step
+    /// @param last_edge_time_us Timestamp of the latest edge [us]
+    /// @param now_us Current timestamp [us]
+    /// @return The velocity estimate [dist units / us]
+    float update(int32_t ticks, uint32_t last_edge_time_us, uint32_t now_us);
+    float get_velocity() const { return velocity; }
+
+    void reset();
+
+private:
+    float velocity = 0.0f;
+    int32_t direction = 1;
+    uint32_t last_edge_time_us = 0;
+    uint32_t last_update_time_us = 0;
+    bool has_edge = false;
+    bool has_update = false;
+};
+
+/// @brief Alpha-beta tracker, estimates a signal and its rate of change from noisy samples.
+///
+/// Gains follow the step time, alpha = dt / (tau + dt) and beta = alpha^2 / (2 - alpha), so the response does not
+/// depend on the update rate.
+class AlphaBetaTracker {
+public:
+    AlphaBetaTracker() {};
+    AlphaBetaTracker(float tau_s);
+
+    // Freely updatable constants
+    float tau_s;
+
+    /// @brief Runs one tracker step
+    /// @param measurement New sample
+    /// @param dt Time since the last step [s]
+    /// @return The tracked value
+    float update(float measurement, float dt);
+    float get_value() const { return value; }
+    float get_rate() const { return rate; }
+
+    void reset();
+
+private:
+    float value = 0.0f;
+    float rate = 0.0f;
+};
+
+}
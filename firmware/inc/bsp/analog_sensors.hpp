@@ -20,6 +20,11 @@ enum SensingDirection {
     LEFT = 3,
 };
 
+enum CurrentSensor {
+    CURRENT_LEFT = 0,
+    CURRENT_RIGHT = 1,
+};
+
 struct SensingStatus {
     bool front_seeing;
     bool right_seeing;
@@ -44,6 +49,10 @@ constexpr std::array<SensingPattern, 8> ir_wall_patterns = {{
     {180, 66, 238, 800}     // None
 }};
 
+/// @brief Distances of the IR calibration points, each sensor LUT holds its raw reading at these distances
+constexpr uint8_t IR_LUT_POINTS = 8;
+constexpr std::array<float, IR_LUT_POINTS> ir_lut_distances_mm = {20, 30, 45, 60, 80, 100, 130, 170};
+
 typedef void (*bsp_analog_ready_callback_t)(void);
 
 /// @section Interface definition
@@ -55,9 +64,18 @@ void stop(void);
 /// @brief Register a callback to be called when a new reading is available
 void register_callback(bsp_analog_ready_callback_t callback);
 
+/// @brief Register a callback to be called on every new motor current reading (ADC2 half buffer)
+void register_current_callback(bsp_analog_ready_callback_t callback);
+
 uint32_t* ir_latest_reading(void);
 uint32_t battery_latest_reading(void);
 uint32_t* current_latest_reading(void);
+
+/// @brief Motor current in [A], relative to the offset captured by current_calibrate_offset
+float current_latest_reading_amps(CurrentSensor sensor);
+
+/// @brief Captures the zero current readings, motors must be stopped
+void current_calibrate_offset(void);
 float battery_latest_reading_mv(void);
 float battery_latest_reading_volts(void);
 bool battery_low();
@@ -68,9 +86,18 @@ bool ir_reading_wall(SensingDirection direction);
 /// @brief compares the readings to a known pattern and calculates the sensing status
 SensingStatus ir_get_sensing_status();
 
-int32_t ir_side_wall_error();
-int32_t ir_diagonal_error();
+/// @brief Wall errors in raw counts, or in mm when linearisation is enabled and the sensors are calibrated
+float ir_side_wall_error();
+float ir_diagonal_error();
 bool ir_wall_control_valid(SensingDirection direction);
+
+/// @brief Sets the raw readings at ir_lut_distances_mm, must be decreasing with the distance
+bool ir_set_lut(SensingDirection direction, const uint16_t raw[IR_LUT_POINTS]);
+bool ir_lut_valid(SensingDirection direction);
+
+/// @brief Distance to the wall interpolated from the sensor LUT, -1 if the sensor is not calibrated
+float ir_raw_to_mm(SensingDirection direction, uint32_t raw);
+float ir_reading_mm(SensingDirection direction);
 void enable_modulation(bool enable = true);
 
 }
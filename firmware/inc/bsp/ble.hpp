@@ -25,6 +25,7 @@ enum BlePacketType : uint8_t {
     RequestLogData = 0x08,
     RequestMoveSequence = 0x09,
     UpdateMoveSequence = 0x0A,
+    LogDumpData = 0x0B, // Sequence number (u16) and a chunk of the logger dump image
 };
 
 enum BleCommands : uint8_t {
@@ -36,6 +37,7 @@ enum BleCommands : uint8_t {
     ButtonMovementParameters = 0x05,
     ButtonLogDump = 0x06,
     ButtonRequestMoveSequence = 0x07,
+    LogTrigger = 0x08,
 };
 
 enum ForwardParamID : uint8_t {
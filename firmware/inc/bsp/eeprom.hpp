@@ -10,12 +10,19 @@ enum EepromResult {
     OK,
     ERROR,
     DATA_NOT_FOUND,
+    BUSY,
 };
 
+static constexpr uint16_t PAGE_SIZE = 64;
+static constexpr uint16_t WRITE_QUEUE_PAGES = 32;
+static constexpr uint16_t CONFIG_BLOCK_SIZE = 0x0600;
+
+typedef void (*write_callback_t)(EepromResult result);
+
 typedef enum : uint16_t {
     ADDR_MEMORY_CLEAR = 0x0000,
 
-    // PARAMS 0x0004 ~ 0x0FFF
+    // LEGACY PARAMS 0x0004 ~ 0x03FF, one u32 each, only read to migrate them to the config block
     ADDR_FAN_SPEED = 0x0004,
     ADDR_ANGULAR_KP = 0x0008,
     ADDR_ANGULAR_KI = 0x000C,
@@ -58,8 +65,38 @@ typedef enum : uint16_t {
     ADDR_LINEAR_JERK_FEED_FORWARD_LIMIT = 0x0094,
     ADDR_ANGULAR_JERK_FEED_FORWARD_K = 0x0098,
     ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT = 0x009C,
+    ADDR_CURRENT_LOOP_ENABLE = 0x00A0,
+    ADDR_CURRENT_KP = 0x00A4,
+    ADDR_CURRENT_KI = 0x00A8,
+    ADDR_DOB_ENABLE = 0x00AC,
+    ADDR_DOB_INERTIA_K = 0x00B0,
+    ADDR_DOB_CUTOFF_HZ = 0x00B4,
+    ADDR_CONTROL_MODE = 0x00B8,
+    ADDR_CONTROL_FAST_FREQUENCY_HZ = 0x00BC,
+    ADDR_IR_FILTER_TYPE_RIGHT = 0x00C0,
+    ADDR_IR_FILTER_TYPE_FRONT_LEFT = 0x00C4,
+    ADDR_IR_FILTER_TYPE_FRONT_RIGHT = 0x00C8,
+    ADDR_IR_FILTER_TYPE_LEFT = 0x00CC,
+    ADDR_IR_LINEARIZE = 0x00D0,
+    ADDR_ENCODER_BACKEND = 0x00D4,
+    ADDR_GYRO_BIAS_ESTIMATION = 0x00D8,
+    ADDR_GYRO_BIAS_TEMP_COEF = 0x00DC,
+    ADDR_LOG_STREAM = 0x00E0,
+    ADDR_LOG_CHANNELS = 0x00E4,
+    ADDR_LOG_COMPRESSION = 0x00E8,
+    ADDR_LOG_TRIGGER = 0x00EC,
+    ADDR_LOG_PRE_MS = 0x00F0,
+    ADDR_LOG_POST_MS = 0x00F4,
+    ADDR_LOG_TRIGGER_SPEED = 0x00F8,
+    ADDR_LOG_TRIGGER_MOVEMENT = 0x00FC,
+    ADDR_LOG_PERSIST = 0x0100,
+    ADDR_BATTERY_SAG_COMPENSATION = 0x0104,
+    ADDR_LOG_SEARCH = 0x0108,
+
+    // CONFIG BLOCK 0x0400 ~ 0x0A00, every param and movement param with a version and a CRC
+    ADDR_CONFIG_BLOCK = 0x0400,
 
-    // FOWARD PARAMS 0x1400 ~ 0x1600
+    // LEGACY FOWARD PARAMS 0x1400 ~ 0x1600, migrated to the config block
     ADDR_FORWARD_PARAMS_START = 0x1400,
     ADDR_FORWARD_PARAMS_FOWARD = 0x1410,
     ADDR_FORWARD_PARAMS_DIAGONAL = 0x1420,
@@ -83,7 +120,7 @@ typedef enum : uint16_t {
     ADDR_FORWARD_PARAMS_RIGHT_180 = 0x1540,
     ADDR_FORWARD_PARAMS_LEFT_180 = 0x1550,
 
-    // TURN PARAMS 0x1600 ~ 0x1960
+    // LEGACY TURN PARAMS 0x1600 ~ 0x1960, migrated to the config block
     ADDR_TURN_PARAMS_RIGHT_45 = 0x1600,
     ADDR_TURN_PARAMS_LEFT_45 = 0x1630,
     ADDR_TURN_PARAMS_RIGHT_90 = 0x1660,
@@ -123,12 +160,19 @@ typedef enum : uint16_t {
     ADDR_MOVE_SEQUENCE_17 = 0x2010,
     ADDR_MOVE_SEQUENCE_18 = 0x2011,
 
+    // IR LUT 0x2100 ~ 0x2200
+    ADDR_IR_LUT_START = 0x2100,
+
     // MAZE 0x3000 ~ 0x4000
     ADDR_MAZE_START = 0x3000,
 
     // MAZE_BACKUP 0x4000 ~ 0x5000
     ADDR_MAZE_BACKUP_START = 0x4000,
 
+    // LOG STORAGE 0x5000 ~ 0xFFFF, a directory page followed by the stored runs
+    ADDR_LOG_DIRECTORY = 0x5000,
+    ADDR_LOG_DATA_START = 0x5040,
+
     ADDR_MAX = 0xFFFF,
 } param_addresses_t;
 
@@ -166,7 +210,34 @@ const ParamInfo paramInfoArray[] = {
     {ADDR_LINEAR_JERK_FEED_FORWARD_K, "ADDR_LINEAR_JERK_FEED_FORWARD_K"},
     {ADDR_LINEAR_JERK_FEED_FORWARD_LIMIT, "ADDR_LINEAR_JERK_FEED_FORWARD_LIMIT"},
     {ADDR_ANGULAR_JERK_FEED_FORWARD_K, "ADDR_ANGULAR_JERK_FEED_FORWARD_K"},
-    {ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT, "ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT"}
+    {ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT, "ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT"},
+    {ADDR_CURRENT_LOOP_ENABLE, "ADDR_CURRENT_LOOP_ENABLE"},
+    {ADDR_CURRENT_KP, "ADDR_CURRENT_KP"},
+    {ADDR_CURRENT_KI, "ADDR_CURRENT_KI"},
+    {ADDR_DOB_ENABLE, "ADDR_DOB_ENABLE"},
+    {ADDR_DOB_INERTIA_K, "ADDR_DOB_INERTIA_K"},
+    {ADDR_DOB_CUTOFF_HZ, "ADDR_DOB_CUTOFF_HZ"},
+    {ADDR_CONTROL_MODE, "ADDR_CONTROL_MODE"},
+    {ADDR_CONTROL_FAST_FREQUENCY_HZ, "ADDR_CONTROL_FAST_FREQUENCY_HZ"},
+    {ADDR_IR_FILTER_TYPE_RIGHT, "ADDR_IR_FILTER_TYPE_RIGHT"},
+    {ADDR_IR_FILTER_TYPE_FRONT_LEFT, "ADDR_IR_FILTER_TYPE_FRONT_LEFT"},
+    {ADDR_IR_FILTER_TYPE_FRONT_RIGHT, "ADDR_IR_FILTER_TYPE_FRONT_RIGHT"},
+    {ADDR_IR_FILTER_TYPE_LEFT, "ADDR_IR_FILTER_TYPE_LEFT"},
+    {ADDR_IR_LINEARIZE, "ADDR_IR_LINEARIZE"},
+    {ADDR_ENCODER_BACKEND, "ADDR_ENCODER_BACKEND"},
+    {ADDR_GYRO_BIAS_ESTIMATION, "ADDR_GYRO_BIAS_ESTIMATION"},
+    {ADDR_GYRO_BIAS_TEMP_COEF, "ADDR_GYRO_BIAS_TEMP_COEF"},
+    {ADDR_LOG_STREAM, "ADDR_LOG_STREAM"},
+    {ADDR_LOG_CHANNELS, "ADDR_LOG_CHANNELS"},
+    {ADDR_LOG_COMPRESSION, "ADDR_LOG_COMPRESSION"},
+    {ADDR_LOG_TRIGGER, "ADDR_LOG_TRIGGER"},
+    {ADDR_LOG_PRE_MS, "ADDR_LOG_PRE_MS"},
+    {ADDR_LOG_POST_MS, "ADDR_LOG_POST_MS"},
+    {ADDR_LOG_TRIGGER_SPEED, "ADDR_LOG_TRIGGER_SPEED"},
+    {ADDR_LOG_TRIGGER_MOVEMENT, "ADDR_LOG_TRIGGER_MOVEMENT"},
+    {ADDR_LOG_PERSIST, "ADDR_LOG_PERSIST"},
+    {ADDR_BATTERY_SAG_COMPENSATION, "ADDR_BATTERY_SAG_COMPENSATION"},
+    {ADDR_LOG_SEARCH, "ADDR_LOG_SEARCH"},
 };
 
 /// @section Interface definition
@@ -182,6 +253,17 @@ EepromResult read_array(uint16_t address, uint8_t* data, uint16_t size);
 EepromResult write_u32(uint16_t address, uint32_t data);
 EepromResult write_array(uint16_t address, uint8_t* data, uint16_t size);
 
+/// @brief Queues a write of any size, stored page by page in the background by update(). data is
+/// copied, BUSY if the queue has no room for all of it. callback runs from update() once the last
+/// page is stored, with ERROR if any page failed
+EepromResult write_queued(uint16_t address, const uint8_t* data, uint16_t size, write_callback_t callback = nullptr);
+/// @brief Starts the next queued page once the previous one is written (ACK polling), call from the main loop
+void update(void);
+/// @brief Blocks until every queued write is done, the blocking reads and writes call it first.
+/// BUSY without waiting when called from an interrupt
+EepromResult flush(void);
+uint16_t queue_free_pages(void);
+
 void clear(void);
 void print_all(void);
 const char* param_name(uint16_t address);
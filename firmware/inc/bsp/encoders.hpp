@@ -15,6 +15,13 @@ static constexpr float MM_PER_US_TO_M_PER_S = 1000.0; // 1mm/us = 1000m/s
 enum DirectionType { CW, CCW };
 enum EncoderSide { LEFT, RIGHT };
 
+/// @brief Source of the wheel ticks
+enum EncoderBackend {
+    EXTI_ABI = 0,         // Interrupt on every A edge of the AS5047P ABI output
+    QUADRATURE_TIMER = 1, // Timer encoder mode, needs A/B on a timer CH1/CH2 pair
+    AS5047_SPI = 2,       // 14 bit absolute angle read over SPI1 with DMA
+};
+
 struct EncoderData {
     int32_t ticks;
     DirectionType direction;
@@ -28,18 +35,27 @@ struct EncoderData {
 /// @section Interface definitions
 
 void init();
+
+/// @brief Switches the tick source, returns false and keeps the current one if not available
+bool set_backend(EncoderBackend backend);
+EncoderBackend get_backend();
+
 void reset();
 void clear_ticks();
 EncoderData get_data(EncoderSide side);
 
+/// @brief Starts a new angle read on the SPI backend, ticks are updated when it completes
 void update_ticks();
 void reset_velocities();
+
+/// @brief M/T velocity per wheel, smoothed by an alpha-beta tracker that also gives the acceleration
 void update_velocities();
 
 void set_right_ang_vel_rad_s(float speed);
 void set_left_ang_vel_rad_s(float speed);
 float get_linear_velocity_m_s();
 float get_filtered_velocity_m_s();
+float get_filtered_acceleration_m_s2();
 float get_right_filtered_ang_vel_rad_s();
 float get_left_filtered_ang_vel_rad_s();
 float get_encoder_dist_mm_pulse();
@@ -14,6 +14,9 @@ enum ImuResult {
 /// @section Interface definition
 
 ImuResult init();
+
+/// @brief Consumes the newest sample read in the background and starts the next read, never waits for the bus
+/// @return ERROR if a read timed out and the bus had to be restarted
 ImuResult update();
 
 // All angles are related to the Z axis
@@ -24,9 +27,22 @@ float get_rad_per_s();
 
 float get_z_acceleration();
 
+/// @brief Timestamp of the sample used by the last update [us]
+uint32_t get_sample_time_us();
+
 void set_g_bias_z(float z_gbias);
 float get_g_bias_z();
 
+/// @brief Bias currently removed by the online estimator, follows the temperature model [deg/s]
+float get_estimated_g_bias_z();
+float get_temperature_c();
+
+/// @brief Refines the Z bias while the robot is still, used when the MotionGC filter is off
+void enable_bias_estimation(bool enable, float temp_coefficient_dps_c);
+
+/// @brief Stillness hint from the encoders, the estimator only learns while it is set
+void set_wheels_still(bool still);
+
 void enable_motion_gc_filter(bool enable);
 
 bool is_imu_emergency();
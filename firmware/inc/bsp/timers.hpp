@@ -6,10 +6,18 @@ namespace bsp {
 
 namespace timers {
 
+/// @section Custom types
+
+typedef void (*timer_callback_t)(void);
+
 /// @section Interface definition
 
 void init(void);
 
+/// @brief Calls callback every period_us from the microsecond timer compare interrupt
+void start_periodic(uint32_t period_us, timer_callback_t callback);
+void stop_periodic(void);
+
 } // namespace bsp::timers
 
 // For convenience, the generic delay and ticks can be accessed directly from bsp namespace
@@ -1,8 +1,24 @@
 #pragma once
 
+#include <cstdint>
+
 namespace bsp::usb {
 
 /// @section Interface definition
 void init(void);
 
+/// @brief True once the host has enumerated the CDC interface
+bool is_connected(void);
+
+/// @brief Queues data for a non-blocking CDC transmit. Frames are appended to the
+/// buffer being filled while the other one is in flight; returns false if they do not fit
+bool write(const uint8_t* data, uint16_t len);
+
+/// @brief Bulk variant of write, waits for buffer space instead of dropping.
+/// Returns false if the host stops reading for timeout_ms
+bool write_blocking(const uint8_t* data, uint32_t len, uint32_t timeout_ms);
+
+/// @brief Number of bytes rejected by write since init
+uint32_t get_dropped_bytes(void);
+
 } // namespace
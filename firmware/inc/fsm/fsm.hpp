@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bsp/ble.hpp"
 #include "fsm/event.hpp"
 #include "fsm/state.hpp"
 #include "services/maze.hpp"
@@ -19,8 +20,17 @@ public:
     void dispatch(Event const& event);
 
 private:
+    struct ConfigPacket {
+        uint8_t data[bsp::ble::receive_packet_size];
+    };
+
+    /// @brief Parses a config packet and saves it to the EEPROM, from the main loop only
+    void handle_config_packet(uint8_t packet[bsp::ble::receive_packet_size]);
+
     State* current_state;
     RingBuffer<Event, 16> event_queue;
+    // Filled by the BLE receive interrupt, parsed by spin() so the EEPROM is never written from it
+    RingBuffer<ConfigPacket, 8> config_packets;
 
     services::Navigation* navigation_service;
     services::Maze* maze_service;
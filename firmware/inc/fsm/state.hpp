@@ -5,11 +5,13 @@
 #include <utility>
 
 #include "algorithms/pid.hpp"
+#include "bsp/analog_sensors.hpp"
 #include "fsm/event.hpp"
 #include "services/logger.hpp"
 #include "services/maze.hpp"
 #include "services/navigation.hpp"
 #include "services/notification.hpp"
+#include "services/wall_observer.hpp"
 
 namespace fsm {
 
@@ -119,11 +121,14 @@ private:
     services::Navigation* navigation;
     services::Notification* notification;
     services::Maze* maze;
+    services::WallObserver* wall_observer;
+    services::Logger* logger;
     bool returning;
     Point target;
     bool save_maze;
     bool stop_next_move;
     bool emergency = false;
+    bool logging = false;
 };
 
 /// @section Run States
@@ -245,6 +250,10 @@ public:
 
 private:
     services::Notification* notification;
+
+    // Raw readings at each bsp::analog_sensors::ir_lut_distances_mm, recorded with SHORT1
+    uint16_t lut[4][bsp::analog_sensors::IR_LUT_POINTS];
+    uint8_t lut_step;
 };
 
 class CalibrationIMU : public State {
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace services {
+
+/// @brief Battery model V = OCV - R * I, fitted online by recursive least squares on the measured voltage and the
+/// load current drawn by the motors.
+class Battery {
+public:
+    static constexpr float MIN_LOAD_VOLTS = 9.0;          // Lowest voltage allowed under load, 3.0 V per cell
+    static constexpr float INITIAL_RESISTANCE_OHM = 0.15; // Pack plus wiring, refined while running
+
+    static Battery* instance();
+
+    void reset(float volts);
+
+    /// @brief Runs one estimator step
+    /// @param volts Measured battery voltage [V]
+    /// @param load_current_a Current drawn from the battery [A]
+    void update(float volts, float load_current_a);
+
+    /// @brief Battery voltage expected while drawing load_current_a [V]
+    float predict_volts(float load_current_a) const;
+
+    /// @brief Largest current that keeps the battery above min_volts [A]
+    float max_current_a(float min_volts) const;
+
+    bool is_initialized() const { return initialized; }
+    float get_ocv_volts() const { return ocv_volts; }
+    float get_resistance_ohm() const { return resistance_ohm; }
+
+    Battery(const Battery&) = delete;
+
+private:
+    Battery() {};
+
+    bool initialized = false;
+    float ocv_volts = 0.0f;
+    float resistance_ohm = INITIAL_RESISTANCE_OHM;
+
+    // RLS covariance, symmetric
+    float p_00 = 0.0f;
+    float p_01 = 0.0f;
+    float p_11 = 0.0f;
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bsp/analog_sensors.hpp"
 #include "bsp/ble.hpp"
 
 namespace services {
@@ -9,6 +10,7 @@ public:
 
     static constexpr float CONTROL_FREQUENCY_HZ = 1000.0;
     static constexpr float CONTROL_PERIOD_S = 1.0 / CONTROL_FREQUENCY_HZ;
+    static constexpr float CONTROL_FAST_MAX_FREQUENCY_HZ = 4000.0;
 
     static constexpr float WHEELS_DIST_MM = (70.0);
 
@@ -64,6 +66,40 @@ public:
     static float start_wall_break_mm_right;
     static float enable_wall_break_correction;
 
+    static float current_loop_enable;
+    static float current_kp;
+    static float current_ki;
+
+    static float dob_enable;
+    static float dob_inertia_k;
+    static float dob_cutoff_hz;
+
+    static float control_mode;
+    static float control_fast_frequency_hz;
+    static float battery_sag_compensation;
+
+    static float ir_filter_type_right;
+    static float ir_filter_type_front_left;
+    static float ir_filter_type_front_right;
+    static float ir_filter_type_left;
+    static float ir_linearize;
+
+    static float encoder_backend;
+
+    static float gyro_bias_estimation;
+    static float gyro_bias_temp_coef;
+
+    static float log_stream;
+    static float log_channels;
+    static float log_compression;
+    static float log_trigger;
+    static float log_pre_ms;
+    static float log_post_ms;
+    static float log_trigger_speed;
+    static float log_trigger_movement;
+    static float log_persist;
+    static float log_search;
+
     static void init();
     static int parse_packet(uint8_t packet[bsp::ble::max_packet_size]);
     static int parse_movement_packet(uint8_t packet[bsp::ble::max_packet_size]);
@@ -76,6 +112,8 @@ public:
     static void send_movement_parameters();
     static void send_move_sequence();
     static int save_z_bias();
+    static int save_ir_lut(const uint16_t lut[4][bsp::analog_sensors::IR_LUT_POINTS]);
+    static void load_ir_lut_from_eeprom();
     static void load_custom_movements_from_eeprom();
     static void load_movement_sequence_from_eeprom();
 };
@@ -2,7 +2,11 @@
 
 #include <cstdint>
 
+#include "algorithms/current_loop.hpp"
+#include "algorithms/disturbance_observer.hpp"
+#include "algorithms/lqr.hpp"
 #include "algorithms/pid.hpp"
+#include "services/battery.hpp"
 #include "utils/movement_params.hpp"
 
 
@@ -10,14 +14,27 @@ namespace services {
 
 class Control {
     public:
+        enum ControlMode : uint8_t {
+            PID = 0,
+            LQR = 1,
+        };
+
         static Control* instance();
 
         Control(const Control&) = delete;
 
         void init();
-        void reset(GeneralParams general_params);
+        void reset(GeneralParams general_params, GainSchedule gain_schedule = gain_schedule_flat);
+        /// @brief Slow stage, called from the 1 kHz soft timer: walls, gain scheduling and feed-forward
         void update();
 
+        /// @brief Fast stage, velocity loop on the TIM5 compare interrupt when Config::control_fast_frequency_hz > 1 kHz.
+        /// The timer is started once and only restarted when that rate changes
+        void fast_update();
+
+        /// @brief Inner current loop, runs on every ADC2 reading when Config::current_loop_enable is set
+        void current_loop_update();
+
         void start_fan();
         void stop_fan();
         
@@ -26,6 +43,7 @@ class Control {
         void set_wall_pid_enabled(bool enabled) { wall_pid_enabled = enabled; }
         void set_diagonal_pid_enabled(bool enabled) { diagonal_pid_enabled = enabled; }
         void set_motor_control_disabled(bool disabled) {motor_control_disabled = disabled;}
+        void set_control_mode(ControlMode mode) { control_mode = mode; }
         
         float get_target_linear_speed() const { return target_linear_speed_m_s; }
         float get_target_angular_speed() const { return target_angular_speed_rad_s; }
@@ -37,19 +55,53 @@ class Control {
         float get_integral_vel() const { return linear_vel_pid.get_integral(); }
         float get_integral_angular() const { return angular_vel_pid.get_integral(); }
         bool is_emergency() const {return emergency; }
+        ControlMode get_control_mode() const { return control_mode; }
+        bool is_fast_loop_enabled() const { return fast_loop_enabled; }
 
         algorithm::PID get_vel_pid() const { return linear_vel_pid; }
         algorithm::PID get_ang_vel_pid() const { return angular_vel_pid; }
         float get_rotation_ff() const { return rotation_ff; }
         float get_linear_ff() const { return linear_ff; }
+        float get_target_current_l() const { return target_current_l; }
+        float get_target_current_r() const { return target_current_r; }
+        float get_disturbance_l() const { return dob_l.get_estimate(); }
+        float get_disturbance_r() const { return dob_r.get_estimate(); }
         uint16_t get_fan_pwm() const { return fan_pwm; }
 
     private:
+        /// @brief Targets, feed-forward and scheduled gains the slow stage hands to the velocity loop
+        struct VelocitySetpoint {
+            float linear_speed_m_s;
+            float angular_speed_rad_s;
+            float linear_ff;
+            float rotation_ff;
+            float linear_kp;
+            float linear_ki;
+            float linear_kd;
+            float angular_kp;
+            float angular_ki;
+            float angular_kd;
+        };
+
         Control() {}
 
+        /// @brief Starts, restarts or stops the TIM5 fast stage when its configured period changed
+        void configure_fast_timer();
+
+        /// @brief Writes the setpoint to the idle buffer and swaps, the fast stage only reads the active one
+        void publish_setpoint(const VelocitySetpoint& setpoint);
+
         void fan_control_update(float bat_volts);
         std::pair<int16_t, int16_t> clamp_pwms(int16_t pwm_l, int16_t pwm_r);
 
+        /// @brief Limits the PWMs keeping the differential (angular) part and giving up common mode (linear) first
+        std::pair<int16_t, int16_t> allocate_pwms(float pwm_l, float pwm_r);
+        std::pair<int16_t, int16_t> limit_pwms(float pwm_l, float pwm_r);
+        void velocity_loop_update(float dt);
+
+        /// @brief Battery current drawn by the motor drivers on the last cycle [A]
+        float battery_load_current_a() const;
+
 
         float rotation_ff = 0.0f;
         float linear_ff = 0.0f;
@@ -58,6 +110,34 @@ class Control {
         algorithm::PID angular_vel_pid;
         algorithm::PID walls_pid;
         algorithm::PID diagonal_walls_pid;
+        algorithm::LQR velocity_lqr;
+
+        ControlMode control_mode = PID;
+        bool linear_saturated = false;
+        bool angular_saturated = false;
+        algorithm::CurrentLoop current_loop_l;
+        algorithm::CurrentLoop current_loop_r;
+
+        algorithm::DisturbanceObserver dob_l;
+        algorithm::DisturbanceObserver dob_r;
+        bool dob_enabled = false;
+        bool sag_compensation_enabled = false;
+
+        volatile bool fast_loop_enabled = false;
+        bool fast_loop_stopped = true;
+        volatile bool slow_stage_ran = false;
+        uint32_t fast_period_us = 0;
+        uint32_t timer_period_us = 0;
+        uint32_t last_fast_update_us = 0;
+        volatile uint32_t last_slow_update_us = 0;
+        float slow_period_s = 0.0f;
+
+        VelocitySetpoint setpoints[2] = {};
+        volatile uint8_t active_setpoint = 0;
+
+        bool current_loop_enabled = false;
+        volatile float target_current_l = 0.0f;
+        volatile float target_current_r = 0.0f;
 
         float target_linear_speed_m_s;
         float last_target_linear_speed_m_s;
@@ -78,6 +158,9 @@ class Control {
         uint16_t fan_pwm = 0;
 
         GeneralParams params;
+        GainSchedule schedule;
+
+        Battery* battery = Battery::instance();
 
 };
 
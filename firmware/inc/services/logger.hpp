@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
-namespace services {
+#include "bsp/eeprom.hpp"
+#include "utils/bit_packer.hpp"
 
-#define CONTROL_LOG_MODE 1
+namespace services {
 
+// Every signal the logger can sample, bit N of the channel mask selects signal N
 enum class ParamIndex : uint8_t {
     VelocityMS,
     TargetVelocityMS,
@@ -14,70 +17,24 @@ enum class ParamIndex : uint8_t {
     PwmLeft,
     PwmRight,
     EncoderImuDiff,
-#if CONTROL_LOG_MODE
     VelP,
     VelI,
     AngP,
     AngI,
     RotationFF,
     LinearFF,
-#else
+    DisturbanceLeft,
+    DisturbanceRight,
     Battery,
     PositionX,
     PositionY,
     Angle,
     Distance,
-#endif
     COUNT
 };
 
 class Logger {
 public:
-    union LogData {
-
-        #if CONTROL_LOG_MODE
-        uint8_t data[20];
-        #else
-        uint8_t data[17];
-        #endif
-
-        struct {
-            uint16_t velocity_ms : 13;
-            uint16_t target_velocity_ms : 13;
-
-            uint16_t angular_speed_rad_s : 13;
-            uint16_t target_rad_s : 13;
-
-            uint16_t pwm_left : 10;
-            uint16_t pwm_right : 10;
-            uint16_t encoder_imu_diff : 12;
-
-#if CONTROL_LOG_MODE
-            uint16_t vel_p : 14;
-            uint16_t vel_i : 14;
-            uint16_t ang_p : 14;
-            uint16_t ang_i : 14;
-            uint16_t rotation_ff : 10;
-            uint16_t linear_ff : 10;
-#else
-            uint16_t battery : 8;
-
-            uint16_t position_mm_x : 16;
-            uint16_t position_mm_y : 16;
-            uint16_t angle : 14;
-            uint16_t distance : 14;
-#endif
-
-        } __attribute__((packed)) fields;
-    };
-
-    #if CONTROL_LOG_MODE
-    static_assert(sizeof(LogData) == 20, "LogData size must be exactly 20 bytes!");
-    #else
-    static_assert(sizeof(LogData) == 17, "LogData size must be exactly 17 bytes!");
-    #endif
-
-
     struct ParamInfo {
         uint16_t max_store_value; // Max integer value for the bitfield (e.g., 4095 for 12 bits)
         float min_param_value;    // Min measured value
@@ -85,28 +42,294 @@ public:
         float scale;              // Scale factor, calculated as: max_store_value / (max_param_value - min_param_value)
     };
 
+    // Entry of the signal registry, the field width follows from info.max_store_value
+    struct SignalInfo {
+        const char* name;
+        float (*getter)();
+        ParamInfo info;
+    };
+
+    // Describes one logged channel to the host, sent ahead of every dump and stream
+    struct SchemaEntry {
+        uint8_t signal_id;
+        uint8_t bits;
+        char name[10];
+        float min_param_value;
+        float scale;
+    } __attribute__((packed));
+
+    static constexpr uint32_t CONTROL_CHANNELS = 0x00007FFF; // Velocities, PWMs and controller terms
+    static constexpr uint32_t POSE_CHANNELS = 0x000F807F;    // Velocities, PWMs, battery and pose
+
+    // RAM capture encoding. Compressed records start with a keyframe flag bit, keyframes hold the raw
+    // fields and the others the Exp-Golomb coded zig-zag residual of each field from its prediction
+    enum Compression : uint8_t {
+        COMPRESSION_NONE,
+        COMPRESSION_DELTA,  // Predict the previous value
+        COMPRESSION_LINEAR, // Predict the linear extrapolation of the last two values
+    };
+
+    static constexpr uint16_t KEYFRAME_INTERVAL = 100;
+
+    // Events that freeze a triggered capture, combined as a bit mask
+    enum TriggerSource : uint8_t {
+        TRIGGER_EMERGENCY = 1 << 0,  // Control emergency trip
+        TRIGGER_WALL_BREAK = 1 << 1, // Wall break distance correction
+        TRIGGER_MOVEMENT = 1 << 2,   // Start of the configured movement
+        TRIGGER_SPEED = 1 << 3,      // Filtered speed above the threshold
+        TRIGGER_COMMAND = 1 << 4,    // trigger() call, e.g. from a BLE command
+    };
+
+    struct TriggerConfig {
+        uint8_t sources; // TriggerSource mask, 0 keeps the linear capture
+        uint16_t pre_ms;
+        uint16_t post_ms;
+        float speed_m_s;
+        Movement movement;
+    };
+
+    static constexpr uint32_t NO_TRIGGER = 0xFFFFFFFF;
+
+    // Discrete events captured next to the samples, decoded by the host tooling
+    enum EventTag : uint8_t {
+        EVENT_STATE,      // arg: FSM state index
+        EVENT_MOVEMENT,   // arg: Movement, value: cells
+        EVENT_WALL_BREAK, // arg: 0 left, 1 right, value: distance error [mm], corrected below 60
+        EVENT_MAZE_STEP,  // arg: chosen Direction, value: cell x | y << 8
+        EVENT_FLOOD_FILL, // value: duration [us]
+        EVENT_TRIGGER,    // arg: TriggerSource mask that froze the capture
+    };
+
+    struct LogEvent {
+        uint32_t record; // Number of sample records logged before the event
+        uint32_t timestamp_us;
+        uint8_t tag;
+        uint8_t arg;
+        int16_t value;
+    } __attribute__((packed));
+
+    // Events fill ram_logger from the end, a triggered capture keeps this much room for them
+    static constexpr size_t RING_EVENT_RESERVE = 128 * sizeof(LogEvent);
+
+    static constexpr size_t MAX_RECORD_SIZE = 32;
+    static constexpr size_t MAX_SCHEMA_SIZE = static_cast<size_t>(ParamIndex::COUNT) * sizeof(SchemaEntry);
+
+    // Live telemetry frame sent over USB: this header, length payload bytes and a checksum byte
+    // (sum of header and payload). Decoded by scripts/decode_telemetry.py
+    enum StreamFrameType : uint8_t {
+        STREAM_SCHEMA,
+        STREAM_RECORD,
+        STREAM_EVENT,
+    };
+
+    struct StreamFrameHeader {
+        uint8_t sync[2];
+        uint8_t type;
+        uint16_t length;
+        uint16_t sequence;
+        uint32_t timestamp_us;
+    } __attribute__((packed));
+
+    static constexpr uint8_t STREAM_SYNC_0 = 0xA5;
+    static constexpr uint8_t STREAM_SYNC_1 = 0x5A;
+
+    // Binary dump layout: DumpHeader, channel_count SchemaEntry, the raw records, event_count LogEvent
+    // in time order, then the CRC32 of everything before it. Decoded by scripts/dump_log_usb.py
+    struct DumpHeader {
+        char magic[4];
+        uint8_t schema_version;
+        uint8_t record_size;
+        uint8_t channel_count;
+        uint8_t compression;
+        uint32_t record_count;
+        uint32_t payload_size;
+        uint32_t trigger_record; // Index of the trigger record, NO_TRIGGER if none fired
+        uint8_t trigger_source;
+        uint32_t first_record; // LogEvent::record of the first dumped record
+        uint16_t event_count;  // LogEvent entries after the records
+        uint32_t run_number;   // Counts the stored runs since the EEPROM log storage was cleared, 0 if not stored
+    } __attribute__((packed));
+
+    static constexpr char DUMP_MAGIC[4] = {'F', 'J', 'L', 'G'};
+    static constexpr uint8_t DUMP_SCHEMA_VERSION = 6;
+
+    // EEPROM log storage: this directory page at ADDR_LOG_DIRECTORY and the dump image of each kept
+    // run after it, written in a circle from ADDR_LOG_DATA_START to the end of the EEPROM
+    static constexpr uint8_t MAX_STORED_RUNS = 6;
+
+    struct StoredRun {
+        uint32_t run_number;
+        uint16_t address;
+        uint16_t size;
+    } __attribute__((packed));
+
+    struct LogDirectory {
+        char magic[4];
+        uint32_t next_run;
+        uint8_t run_count;
+        StoredRun runs[MAX_STORED_RUNS]; // Oldest first
+        uint32_t crc;                    // CRC32 of the fields above
+    } __attribute__((packed));
+
+    static_assert(sizeof(LogDirectory) <= bsp::eeprom::PAGE_SIZE, "The directory is written as one page");
+
+    static constexpr char DIRECTORY_MAGIC[4] = {'F', 'J', 'L', 'D'};
+
     static Logger* instance();
 
     void init();
     void reset();
     void update();
-    void save_size();
+    /// @brief Ends the capture started by init(), later events are no longer stored. Starts copying
+    /// the capture to the EEPROM log storage when persistence is enabled
+    void stop();
     void print_log();
+    /// @brief Sends the captured log over USB as a binary dump, much faster than print_log
+    bool dump_log();
+    /// @brief Sends every run kept in the EEPROM log storage over USB, oldest first
+    bool dump_stored();
+    bool has_capture() const;
+    /// @brief Sends the capture over BLE, one raw record per RequestLogData packet when a record fits,
+    /// otherwise the dump image in sequenced LogDumpData packets
     void send_log_ble();
 
+    /// @brief Selects the logged signals by ParamIndex bit, discards what was captured so far
+    void set_channels(uint32_t mask);
+    uint32_t get_channels() const;
+
+    /// @brief Selects the RAM capture encoding, discards what was captured so far
+    void set_compression(Compression mode);
+
+    /// @brief Switches to a ring capture that keeps pre_ms before the first trigger and
+    /// stops post_ms after it. Triggered captures are stored uncompressed
+    void set_trigger(const TriggerConfig& config);
+
+    /// @brief Fires TRIGGER_COMMAND, safe to call from interrupts
+    void trigger();
+    bool is_triggered() const;
+
+    /// @brief Records a discrete event aligned with the current sample, from the main loop only
+    void log_event(EventTag tag, uint8_t arg = 0, int16_t value = 0);
+
+    /// @brief Also push every record to USB while logging, so no post-run dump is needed
+    void set_streaming(bool enabled);
+    bool is_streaming() const;
+
+    void set_persistence(bool enabled);
+    /// @brief Queues the next pages of a stopped capture for the EEPROM without waiting for them,
+    /// call from the main loop
+    void persist_step();
+    bool is_persisting() const;
+
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
 private:
-    Logger() {};
+    Logger();
+
+    struct Predictor {
+        uint32_t prev[static_cast<size_t>(ParamIndex::COUNT)];
+        uint32_t prev2[static_cast<size_t>(ParamIndex::COUNT)];
+        uint16_t since_keyframe;
+    };
+
+    // A dump of the current capture, its bytes are produced on demand by read_dump
+    struct DumpImage {
+        DumpHeader header;
+        uint16_t first_event;
+        uint32_t size;
+        uint32_t crc;
+    };
+
+    // Where a truncated dump stopped decoding the capture
+    struct TruncateCursor {
+        bit_packer::Reader reader{nullptr, 0};
+        Predictor decoder;
+        uint32_t kept;
+        uint32_t kept_size;
+        uint16_t events_end;
+    };
+
+    enum PersistState : uint8_t {
+        PERSIST_IDLE,
+        PERSIST_PREPARE,  // Dump header of the stopped capture
+        PERSIST_TRUNCATE, // Decode the records that fit the storage, a few per step
+        PERSIST_CRC,      // CRC of the image, a few pages per step
+        PERSIST_RELEASE,  // Drop the runs the new one overwrites from the directory
+        PERSIST_DATA,
+        PERSIST_COMMIT, // Add the new run to the directory
+    };
 
     float encode_value(float raw_value, const ParamInfo& info) const;
     float decode_value(float stored_value, const ParamInfo& info) const;
+    size_t fill_schema(SchemaEntry* entries) const;
+    void send_stream_frame(StreamFrameType type, const uint8_t* payload, uint16_t length);
+    void send_stream_schema();
+    uint32_t predict(const Predictor& predictor, uint8_t channel) const;
+    void push_prediction(Predictor& predictor, const uint32_t* values, bool keyframe) const;
+    bool store_record(const uint32_t* values);
+    void read_record(bit_packer::Reader& reader, Predictor& predictor, uint32_t* values) const;
+    uint8_t active_triggers();
+    void store_ring_record(const uint32_t* values);
+    void finalize_ring();
+    const LogEvent& event_at(uint16_t index) const;
+    uint32_t first_record() const;
+    /// @brief Whole dump image with its CRC in one call, for the blocking dumps
+    void prepare_dump(DumpImage& image);
+    void begin_dump(DumpImage& image);
+    void begin_truncate(const DumpImage& image, TruncateCursor& cursor) const;
+    /// @brief Shrinks the image to max_size decoding up to max_records, true once the image is final
+    bool truncate_step(DumpImage& image, TruncateCursor& cursor, uint32_t max_size, uint32_t max_records) const;
+    void read_dump(const DumpImage& image, uint32_t offset, uint8_t* out, uint32_t len) const;
+    bool load_directory();
+    bool write_directory();
+    static void on_persist_written(bsp::eeprom::EepromResult result);
+
+    uint32_t channel_mask;
+    uint8_t channel_ids[static_cast<size_t>(ParamIndex::COUNT)];
+    uint8_t channel_count;
+    uint8_t record_size;
+
+    Compression compression = COMPRESSION_NONE;
+    Predictor encoder;
 
-    LogData logdata[7];
-    uint8_t log_data_idx;
     uint32_t addr_offset;
-    uint8_t ram_logger[60000]; // Max log number is 60000 / sizeof(LogData)
+    uint32_t record_count;
+    bool ram_full;
+    uint8_t ram_logger[60000]; // Max log number is 60000 / record_size when uncompressed
+    bit_packer::Writer ram_writer{ram_logger, sizeof(ram_logger)};
+
+    TriggerConfig trigger_config = {};
+    uint32_t ring_capacity;
+    uint32_t ring_head;
+    uint32_t ring_count;
+    uint32_t post_remaining;
+    uint32_t records_since_trigger;
+    uint8_t fired_source;
+    uint8_t prev_conditions;
+    bool ring_finalized;
+    volatile bool command_trigger = false;
+
+    bool capturing = false;
+    uint32_t total_records;
+    uint16_t event_count;
+
+    bool persistence = false;
+    PersistState persist_state = PERSIST_IDLE;
+    DumpImage persist_image;
+    TruncateCursor persist_cursor;
+    uint32_t persist_offset;
+    uint16_t persist_address;
+    uint16_t persist_pending = 0; // Queued pages not written yet
+    bool persist_failed = false;
+    LogDirectory directory;
+    bool directory_loaded = false;
+    uint32_t run_number = 0;
+
+    bool streaming = false;
+    uint16_t stream_sequence = 0;
+    uint16_t records_since_schema = 0;
+    uint8_t stream_frame[sizeof(StreamFrameHeader) + MAX_SCHEMA_SIZE + 1];
 };
 
 }
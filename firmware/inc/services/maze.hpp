@@ -27,8 +27,10 @@ public:
     ///        the next cell that should be visited
     /// @param current_position Current cell coordinates
     /// @param walls Current cell wall information
+    /// @param confidence Evidence for each wall observation, indexed by Direction
     /// @return Next cell to be visited
-    Direction next_step(Point const& current_position, uint8_t walls, Point const& target, bool search_mode = true);
+    Direction next_step(Point const& current_position, uint8_t walls, Point const& target, bool search_mode = true,
+                        std::array<uint8_t, 4> const& confidence = algorithm::WALL_CONFIDENCE_FULL);
 
     /// @brief Prints the maze for debugging purpose
     void print(Point const& curr);
@@ -43,9 +45,11 @@ public:
 
     Point closest_unvisited(Point const& current_position);
 
+    /// @brief Stores the walls bit packed with a CRC, a few EEPROM pages
     void save_maze_to_memory(bool backup);
 
-    void read_maze_from_memory(bool backup);
+    /// @brief Loads the map from a saved copy, false leaves it empty if there is no valid one
+    bool read_maze_from_memory(bool backup);
 
     void create_maze_backup();
 
@@ -53,6 +57,21 @@ public:
 
 private:
     Maze();
+
+    // Stored maze: magic, format version and a padding byte, 4 bits per wall, then the CRC32 of it all
+    static constexpr char MAZE_MAGIC[2] = {'M', 'Z'};
+    static constexpr uint8_t MAZE_FORMAT_VERSION = 1;
+    static constexpr size_t MAZE_HEADER_SIZE = 4;
+    static constexpr size_t MAZE_WALLS = 2 * CELLS_X * CELLS_Y + CELLS_X + CELLS_Y;
+    static constexpr size_t MAZE_DATA_SIZE = (MAZE_WALLS * 4 + 7) / 8;
+    static constexpr size_t MAZE_IMAGE_SIZE = MAZE_HEADER_SIZE + MAZE_DATA_SIZE + sizeof(uint32_t);
+
+    static uint8_t confidence_level(uint8_t confidence);
+    static uint8_t level_confidence(uint8_t level);
+
+    template <typename F>
+    static void for_each_wall(algorithm::Grid<CELLS_X, CELLS_Y>& grid, F&& visit);
+    static void log_flood_fill(uint32_t start_us);
 };
 
 }
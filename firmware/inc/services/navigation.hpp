@@ -62,6 +62,8 @@ public:
     void set_hardcoded_movements(std::vector<std::pair<Movement, uint8_t>> moves);
 
     float get_encoder_imu_diff() const { return encoder_imu_diff; };
+    Movement get_current_movement() const { return current_movement; };
+    bool is_wall_break_detected() const { return current_wall_break_detected; };
 
 
 private:
@@ -104,6 +106,9 @@ private:
     void reset_wall_break();
     void reset_movement_variables();
 
+    /// @brief Battery current needed by the hardest forward movement of the loaded profile [A]
+    float profile_peak_current_a();
+
     std::vector<std::pair<Movement, uint8_t>> get_default_target_movements(std::vector<Direction> target_directions);
 
     std::vector<std::pair<Movement, uint8_t>>
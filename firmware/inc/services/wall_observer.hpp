@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "utils/types.hpp"
+
+namespace services {
+
+/// @brief Votes the IR wall classification over the last samples taken while crossing a cell
+class WallObserver {
+public:
+    static constexpr uint8_t SAMPLES = 8;
+    static constexpr float SAMPLE_SPACING_MM = 5.0;
+    static constexpr uint8_t OBSERVATION_WEIGHT = 100; // Confidence of an unanimous observation
+
+    /// @brief Walls relative to the robot (front = N, right = E, left = W) with their confidence [0-100]
+    struct Observation {
+        uint8_t walls;
+        std::array<uint8_t, 4> confidence; // Indexed by Direction
+    };
+
+    static WallObserver* instance();
+
+    void reset();
+
+    /// @brief Takes a new sample every SAMPLE_SPACING_MM of traveled distance
+    void update(float traveled_dist_mm);
+
+    /// @brief Adds the current sample and returns the voted walls, rotated to robot_dir
+    Observation observe(Direction robot_dir);
+
+    WallObserver(const WallObserver&) = delete;
+
+private:
+    WallObserver() {};
+
+    void add_sample();
+
+    // One bit per relative wall, same layout as Observation::walls
+    uint8_t samples[SAMPLES];
+    uint8_t sample_idx = 0;
+    uint8_t sample_count = 0;
+    float last_sample_dist_mm = 0;
+};
+
+}
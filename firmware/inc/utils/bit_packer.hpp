@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace bit_packer {
+
+/// @brief Maps signed values to unsigned so small magnitudes of either sign stay small: 0, -1, 1, -2 -> 0, 1, 2, 3
+inline uint32_t zigzag_encode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzag_decode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+/// @brief Writes variable-width unsigned fields LSB first, the same layout GCC uses for packed bitfields.
+class Writer {
+public:
+    Writer(uint8_t* buffer, size_t size_bytes) : buffer(buffer), size_bits(size_bytes * 8) {}
+
+    bool write(uint32_t value, uint8_t bits) {
+        if (bits > 32 || bit_pos + bits > size_bits) {
+            return false;
+        }
+
+        while (bits > 0) {
+            uint8_t offset = bit_pos & 7;
+            uint8_t take = std::min<uint8_t>(8 - offset, bits);
+            uint8_t mask = (1u << take) - 1;
+
+            uint8_t& byte = buffer[bit_pos >> 3];
+            byte = (byte & ~(mask << offset)) | ((value & mask) << offset);
+
+            value >>= take;
+            bits -= take;
+            bit_pos += take;
+        }
+
+        return true;
+    }
+
+    /// @brief Exp-Golomb code: n - 1 zeros, a one and the low n - 1 bits of value + 1, where n is its bit width.
+    /// Zero takes a single bit. On failure part of the code may be written, rewind to drop it
+    bool write_exp_golomb(uint32_t value) {
+        uint64_t x = static_cast<uint64_t>(value) + 1;
+        uint8_t suffix_bits = std::bit_width(x) - 1;
+        uint32_t suffix = static_cast<uint32_t>(x & ((uint64_t{1} << suffix_bits) - 1));
+
+        return write(0, suffix_bits) && write(1, 1) && write(suffix, suffix_bits);
+    }
+
+    size_t bits_written() const {
+        return bit_pos;
+    }
+
+    void rewind(size_t position) {
+        bit_pos = std::min(position, bit_pos);
+    }
+
+    /// @brief Moves the end of the usable buffer, never below what was already written
+    void resize(size_t size_bytes) {
+        size_bits = std::max(size_bytes * 8, bit_pos);
+    }
+
+private:
+    uint8_t* buffer;
+    size_t size_bits;
+    size_t bit_pos = 0;
+};
+
+/// @brief Reads back fields written by Writer
+class Reader {
+public:
+    Reader(const uint8_t* buffer, size_t size_bytes) : buffer(buffer), size_bits(size_bytes * 8) {}
+
+    uint32_t read(uint8_t bits) {
+        uint32_t value = 0;
+        uint8_t shift = 0;
+
+        if (bits > 32 || bit_pos + bits > size_bits) {
+            return 0;
+        }
+
+        while (bits > 0) {
+            uint8_t offset = bit_pos & 7;
+            uint8_t take = std::min<uint8_t>(8 - offset, bits);
+            uint8_t mask = (1u << take) - 1;
+
+            value |= static_cast<uint32_t>((buffer[bit_pos >> 3] >> offset) & mask) << shift;
+
+            shift += take;
+            bits -= take;
+            bit_pos += take;
+        }
+
+        return value;
+    }
+
+    uint32_t read_exp_golomb() {
+        uint8_t suffix_bits = 0;
+        while (bit_pos < size_bits && read(1) == 0) {
+            if (++suffix_bits > 32) {
+                return 0;
+            }
+        }
+
+        uint64_t x = (uint64_t{1} << suffix_bits) | read(suffix_bits);
+        return static_cast<uint32_t>(x - 1);
+    }
+
+    size_t bits_read() const {
+        return bit_pos;
+    }
+
+private:
+    const uint8_t* buffer;
+    size_t size_bits;
+    size_t bit_pos = 0;
+};
+
+} // namespace
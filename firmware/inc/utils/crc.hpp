@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crc {
+
+/// @brief CRC-32 (IEEE 802.3, reflected), same result as zlib.crc32 on the host.
+/// Pass the previous result as crc to continue a checksum over several blocks.
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+} // namespace
@@ -130,6 +130,41 @@ struct GeneralParams {
           start_wall_break_mm_right(swbcr), enable_wall_break_correction(ewbc) {}
 };
 
+static constexpr uint8_t GAIN_SCHEDULE_POINTS = 4;
+
+/**
+ * @struct GainSchedulePoint
+ * @brief One breakpoint of a gain schedule, scales are multipliers over the GeneralParams gains.
+ *
+ * @param speed Breakpoint speed, [m/s] for the linear loop or [rad/s] for the angular loop
+ * @param kp_scale Multiplier applied to the loop P gain
+ * @param ki_scale Multiplier applied to the loop I gain, the I term is kept continuous when it changes
+ * @param kd_scale Multiplier applied to the loop D gain
+ * @param ff_scale Multiplier applied to the loop feed-forward output
+ */
+struct GainSchedulePoint {
+    float speed;
+    float kp_scale;
+    float ki_scale;
+    float kd_scale;
+    float ff_scale;
+};
+
+/**
+ * @struct GainSchedule
+ * @brief Speed-scheduled gains for the velocity loops.
+ *
+ * The linear loop is keyed on the absolute target linear speed and the angular loop on the absolute target angular
+ * speed. Breakpoints must be sorted by speed, values are interpolated between them and held outside the table.
+ */
+struct GainSchedule {
+    GainSchedulePoint linear[GAIN_SCHEDULE_POINTS];
+    GainSchedulePoint angular[GAIN_SCHEDULE_POINTS];
+};
+
+/// @brief Interpolates the scales of a schedule table at the given speed
+GainSchedulePoint gain_schedule_lookup(const GainSchedulePoint (&table)[GAIN_SCHEDULE_POINTS], float speed);
+
 extern const std::map<Movement, TurnParams> turn_params_search_slow;
 extern const std::map<Movement, ForwardParams> forward_params_search_slow;
 extern const std::map<Movement, TurnParams> turn_params_search_medium;
@@ -153,3 +188,11 @@ extern const GeneralParams general_params_slow;
 extern const GeneralParams general_params_medium;
 extern const GeneralParams general_params_fast;
 extern const GeneralParams general_params_super;
+extern const GainSchedule gain_schedule_flat;
+extern const GainSchedule gain_schedule_search_slow;
+extern const GainSchedule gain_schedule_search_medium;
+extern const GainSchedule gain_schedule_search_fast;
+extern const GainSchedule gain_schedule_slow;
+extern const GainSchedule gain_schedule_medium;
+extern const GainSchedule gain_schedule_fast;
+extern const GainSchedule gain_schedule_super;
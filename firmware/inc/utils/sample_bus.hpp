@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace sample_bus {
+
+/// @section Custom types
+
+enum Channel : uint8_t {
+    IR_RIGHT,        // Filtered IR reading, same order as SensingDirection
+    IR_FRONT_LEFT,   //
+    IR_FRONT_RIGHT,  //
+    IR_LEFT,         //
+    WHEEL_VEL_LEFT,  // Wheel linear velocity [m/s], stamped at the last encoder edge
+    WHEEL_VEL_RIGHT, //
+    GYRO_Z,          // Angular velocity [rad/s]
+    HEADING,         // Incremental angle [rad]
+    CHANNEL_COUNT,
+};
+
+struct Sample {
+    uint32_t timestamp_us;
+    float value;
+};
+
+/// @brief History of a single producer channel.
+///
+/// The producer never waits: it fills the slot after the head and then moves the head. Readers copy the two newest
+/// samples and check the head again, so they only retry if the producer lapped them meanwhile.
+template <size_t size>
+class SampleHistory {
+public:
+    void publish(Sample sample) {
+        uint32_t next = head.load(std::memory_order_relaxed) + 1;
+        samples[next & idx_mask] = sample;
+        head.store(next, std::memory_order_release);
+
+        if (count.load(std::memory_order_relaxed) < size) {
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+    bool read(Sample* latest, Sample* previous) const {
+        for (int attempt = 0; attempt < 3; attempt++) {
+            uint32_t available = count.load(std::memory_order_acquire);
+            uint32_t first = head.load(std::memory_order_acquire);
+
+            if (available == 0) {
+                return false;
+            }
+
+            *latest = samples[first & idx_mask];
+            *previous = available > 1 ? samples[(first - 1) & idx_mask] : *latest;
+
+            // The slot being written is head + 1, both copies are good if it did not reach them
+            if ((head.load(std::memory_order_acquire) - first) < (size - 2)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void reset() {
+        count.store(0, std::memory_order_release);
+    }
+
+private:
+    constexpr static size_t idx_mask = size - 1;
+
+    Sample samples[size] = {};
+    std::atomic<uint32_t> head = 0;
+    std::atomic<uint32_t> count = 0;
+
+    static_assert((size > 2), "history needs more than two samples");
+    static_assert((size & idx_mask) == 0, "size is not a power of 2");
+};
+
+/// @section Interface definition
+
+/// @brief Stores a new sample, each channel must have a single producer
+void publish(Channel channel, uint32_t timestamp_us, float value);
+
+/// @brief Newest sample of the channel, false if none was published yet
+bool latest(Channel channel, Sample* out);
+
+/// @brief Linear extrapolation of the two newest samples to time_us, at most max_horizon_us past the newest one
+float value_at(Channel channel, uint32_t time_us, uint32_t max_horizon_us);
+
+/// @brief Forgets the history, used when the producer restarts its value
+void reset(Channel channel);
+
+}
@@ -0,0 +1,26 @@
+#include <cmath>
+
+#include "algorithms/current_loop.hpp"
+
+namespace algorithm {
+
+CurrentLoop::CurrentLoop(float ra_ohm, float kt, float kp, float ki, float integral_limit)
+    : ra_ohm(ra_ohm), kt(kt), pid(kp, ki, 0, integral_limit) {}
+
+float CurrentLoop::calculate(float target_a, float measured_a, float ang_vel_rad_s, float last_volts) {
+    float current_a = signed_current(measured_a, last_volts, target_a);
+    return target_a * ra_ohm + ang_vel_rad_s * kt + pid.calculate(target_a, current_a);
+}
+
+float CurrentLoop::signed_current(float measured_a, float last_volts, float target_a) {
+    // Offset noise can leave the reading slightly below zero
+    float magnitude = std::abs(measured_a);
+    float direction = last_volts != 0.0f ? last_volts : target_a;
+    return direction < 0.0f ? -magnitude : magnitude;
+}
+
+void CurrentLoop::reset() {
+    pid.reset();
+}
+
+}
@@ -0,0 +1,35 @@
+#include "algorithms/disturbance_observer.hpp"
+#include "utils/math.hpp"
+
+namespace algorithm {
+
+DisturbanceObserver::DisturbanceObserver(float inertia_k, float cutoff_hz, float limit)
+    : inertia_k(inertia_k), cutoff_hz(cutoff_hz), limit(limit) {}
+
+float DisturbanceObserver::update(float applied_current, float wheel_ang_vel, float dt) {
+    if (!has_previous || dt <= 0.0f) {
+        previous_ang_vel = wheel_ang_vel;
+        has_previous = true;
+        return estimate;
+    }
+
+    float acceleration = (wheel_ang_vel - previous_ang_vel) / dt;
+    previous_ang_vel = wheel_ang_vel;
+
+    float raw_estimate = applied_current - inertia_k * acceleration;
+
+    float tau = 1.0f / (M_TWOPI * cutoff_hz);
+    float alpha = dt / (tau + dt);
+    estimate += alpha * (raw_estimate - estimate);
+    estimate = constrain(estimate, -limit, limit);
+
+    return estimate;
+}
+
+void DisturbanceObserver::reset() {
+    estimate = 0.0f;
+    previous_ang_vel = 0.0f;
+    has_previous = false;
+}
+
+}
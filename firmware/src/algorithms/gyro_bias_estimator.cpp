@@ -0,0 +1,58 @@
+#include <cmath>
+
+#include "algorithms/gyro_bias_estimator.hpp"
+
+namespace algorithm {
+
+GyroBiasEstimator::GyroBiasEstimator(float settle_time_s, float tau_s, float gyro_threshold_dps,
+                                     float acc_threshold_g)
+    : settle_time_s(settle_time_s), tau_s(tau_s), gyro_threshold_dps(gyro_threshold_dps),
+      acc_threshold_g(acc_threshold_g) {}
+
+float GyroBiasEstimator::update(float gyro_dps, float acc_norm_g, float temperature_c, bool wheels_still, float dt) {
+    if (!has_reference_temperature) {
+        reference_temperature_c = temperature_c;
+        has_reference_temperature = true;
+    }
+
+    float predicted_bias = get_bias(temperature_c);
+    float residual = gyro_dps - predicted_bias;
+
+    bool candidate = wheels_still && std::abs(residual) < gyro_threshold_dps &&
+                     std::abs(acc_norm_g - 1.0f) < acc_threshold_g;
+
+    if (!candidate || dt <= 0.0f) {
+        still_time_s = 0.0f;
+        still = false;
+        return predicted_bias;
+    }
+
+    // Skip the start of the still period, the robot may still be settling after a stop
+    still_time_s += dt;
+    if (still_time_s < settle_time_s) {
+        return predicted_bias;
+    }
+
+    still = true;
+    float alpha = dt / (tau_s + dt);
+    bias_dps += alpha * residual;
+
+    return get_bias(temperature_c);
+}
+
+float GyroBiasEstimator::get_bias(float temperature_c) const {
+    if (!has_reference_temperature) {
+        return bias_dps;
+    }
+
+    return bias_dps + temp_coefficient_dps_c * (temperature_c - reference_temperature_c);
+}
+
+void GyroBiasEstimator::reset(float new_bias_dps) {
+    bias_dps = new_bias_dps;
+    has_reference_temperature = false;
+    still_time_s = 0.0f;
+    still = false;
+}
+
+}
@@ -0,0 +1,57 @@
+#include "algorithms/ir_filter.hpp"
+#include "utils/math.hpp"
+
+namespace algorithm {
+
+IrFilter::IrFilter(FilterType type, size_t window, uint8_t iir_shift) {
+    configure(type, window, iir_shift);
+}
+
+void IrFilter::configure(FilterType type, size_t window, uint8_t iir_shift) {
+    this->type = type;
+    this->window = constrain(window, static_cast<size_t>(1), MAX_WINDOW);
+    this->iir_shift = iir_shift;
+    reset();
+}
+
+uint32_t IrFilter::update(uint32_t new_value) {
+    switch (type) {
+    case MOVING_AVERAGE:
+        // Same output as averaging a zero initialized window, without summing it again
+        sum += new_value - samples[idx];
+        samples[idx] = new_value;
+        idx++;
+        if (idx == window) {
+            idx = 0;
+        }
+        output = sum / window;
+        break;
+    case IIR:
+        if (count == 0) {
+            iir_state = new_value << iir_shift;
+            count = 1;
+        } else {
+            iir_state += new_value - (iir_state >> iir_shift);
+        }
+        output = iir_state >> iir_shift;
+        break;
+    default:
+        output = new_value;
+        break;
+    }
+
+    return output;
+}
+
+void IrFilter::reset() {
+    for (size_t i = 0; i < MAX_WINDOW; i++) {
+        samples[i] = 0;
+    }
+    idx = 0;
+    count = 0;
+    sum = 0;
+    iir_state = 0;
+    output = 0;
+}
+
+}
@@ -0,0 +1,52 @@
+#include "algorithms/lqr.hpp"
+#include "utils/math.hpp"
+
+namespace algorithm {
+
+LQR::LQR(const float (&gains)[INPUTS][STATES], float integral_limit_linear, float integral_limit_angular)
+    : integral_limit_linear(integral_limit_linear), integral_limit_angular(integral_limit_angular) {
+    set_gains(gains);
+}
+
+void LQR::set_gains(const float (&gains)[INPUTS][STATES]) {
+    for (int i = 0; i < INPUTS; i++) {
+        for (int j = 0; j < STATES; j++) {
+            k[i][j] = gains[i][j];
+        }
+    }
+}
+
+void LQR::calculate(float target_v, float measured_v, float target_w, float measured_w, float dt, bool freeze_linear,
+                    bool freeze_angular, float* u_linear, float* u_angular) {
+    float error_v = target_v - measured_v;
+    float error_w = target_w - measured_w;
+
+    if (!freeze_linear) {
+        integral_v += error_v * dt;
+        integral_v = constrain(integral_v, -integral_limit_linear, integral_limit_linear);
+    }
+
+    if (!freeze_angular) {
+        integral_w += error_w * dt;
+        integral_w = constrain(integral_w, -integral_limit_angular, integral_limit_angular);
+    }
+
+    const float x[STATES] = {error_v, error_w, integral_v, integral_w};
+    float u[INPUTS] = {0.0f, 0.0f};
+
+    for (int i = 0; i < INPUTS; i++) {
+        for (int j = 0; j < STATES; j++) {
+            u[i] += k[i][j] * x[j];
+        }
+    }
+
+    *u_linear = u[0];
+    *u_angular = u[1];
+}
+
+void LQR::reset() {
+    integral_v = 0.0f;
+    integral_w = 0.0f;
+}
+
+}
@@ -19,6 +19,31 @@ float PID::calculate(float const& target, float const& measured_value) {
     return kp * error + ki * integral + kd * derivative;
 }
 
+float PID::calculate(float const& target, float const& measured_value, float period_ratio) {
+    float error = target - measured_value;
+
+    integral += error * period_ratio;
+
+    integral = constrain(integral, -integral_limit, integral_limit);
+
+    float derivative = (error - previous_error) / period_ratio;
+    previous_error = error;
+
+    return kp * error + ki * integral + kd * derivative;
+}
+
+void PID::set_ki(float new_ki) {
+    // The integral holds the raw error sum, rescale it so ki * integral stays the same. A smaller ki can push it
+    // past the limit, which then caps the I term the same as calculate does
+    if (ki != 0.0f && new_ki != 0.0f) {
+        integral = constrain(integral * (ki / new_ki), -integral_limit, integral_limit);
+    } else {
+        // No I term on one side, so there is nothing to keep and the sum kept while ki was zero must not kick in
+        integral = 0;
+    }
+    ki = new_ki;
+}
+
 void PID::reset() {
     integral = 0;
     previous_error = 0;
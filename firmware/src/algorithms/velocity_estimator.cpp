@@ -0,0 +1,83 @@
+#include <cstdlib>
+
+#include "algorithms/velocity_estimator.hpp"
+
+namespace algorithm {
+
+MTVelocityEstimator::MTVelocityEstimator(float dist_per_tick, uint32_t max_time_without_tick_us)
+    : dist_per_tick(dist_per_tick), max_time_without_tick_us(max_time_without_tick_us) {}
+
+float MTVelocityEstimator::update(int32_t ticks, uint32_t edge_time_us, uint32_t now_us) {
+    uint32_t window_us = now_us - last_update_time_us;
+    bool first_window = !has_update;
+    last_update_time_us = now_us;
+    has_update = true;
+
+    if (ticks != 0) {
+        // T spans from the last edge seen on the previous window, M counts the edges after it
+        uint32_t period_us = has_edge ? edge_time_us - last_edge_time_us : window_us;
+        last_edge_time_us = edge_time_us;
+        has_edge = true;
+        direction = ticks > 0 ? 1 : -1;
+
+        if (first_window || period_us == 0) {
+            return velocity;
+        }
+
+        velocity = (ticks * dist_per_tick) / period_us;
+        return velocity;
+    }
+
+    if (!has_edge) {
+        return velocity;
+    }
+
+    uint32_t time_since_edge_us = now_us - last_edge_time_us;
+    if (time_since_edge_us > max_time_without_tick_us) {
+        velocity = 0.0f;
+        return velocity;
+    }
+
+    // The next edge is at least this far away, so the speed can't be higher than one edge over that time
+    float bound = (direction * dist_per_tick) / time_since_edge_us;
+    if (std::abs(bound) < std::abs(velocity)) {
+        velocity = bound;
+    }
+
+    return velocity;
+}
+
+void MTVelocityEstimator::reset() {
+    velocity = 0.0f;
+    direction = 1;
+    last_edge_time_us = 0;
+    last_update_time_us = 0;
+    has_edge = false;
+    has_update = false;
+}
+
+AlphaBetaTracker::AlphaBetaTracker(float tau_s) : tau_s(tau_s) {}
+
+float AlphaBetaTracker::update(float measurement, float dt) {
+    if (dt <= 0.0f) {
+        return value;
+    }
+
+    float alpha = dt / (tau_s + dt);
+    float beta = (alpha * alpha) / (2.0f - alpha);
+
+    float predicted = value + rate * dt;
+    float residual = measurement - predicted;
+
+    value = predicted + alpha * residual;
+    rate += (beta / dt) * residual;
+
+    return value;
+}
+
+void AlphaBetaTracker::reset() {
+    value = 0.0f;
+    rate = 0.0f;
+}
+
+}
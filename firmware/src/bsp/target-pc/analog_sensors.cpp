@@ -43,9 +43,25 @@ uint32_t ir_reading(SensingDirection direction) {
 
 void enable_modulation(bool) {}
 
-int32_t ir_side_wall_error() {
+float ir_side_wall_error() {
     return 0;
 }
 
+bool ir_set_lut(SensingDirection, const uint16_t[IR_LUT_POINTS]) {
+    return false;
+}
+
+bool ir_lut_valid(SensingDirection) {
+    return false;
+}
+
+float ir_raw_to_mm(SensingDirection, uint32_t) {
+    return -1;
+}
+
+float ir_reading_mm(SensingDirection) {
+    return -1;
+}
+
 
 } // namespace
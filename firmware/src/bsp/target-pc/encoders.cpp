@@ -8,6 +8,14 @@ namespace bsp::encoders {
 
 void init() {}
 
+bool set_backend(EncoderBackend backend) {
+    return backend == EXTI_ABI;
+}
+
+EncoderBackend get_backend() {
+    return EXTI_ABI;
+}
+
 void register_callback_encoder_left(EncoderCallback callback) {
     (void)callback;
 }
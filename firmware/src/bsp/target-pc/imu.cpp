@@ -26,6 +26,22 @@ float get_rad_per_s() {
     return 0;
 }
 
+uint32_t get_sample_time_us() {
+    return 0;
+}
+
+float get_estimated_g_bias_z() {
+    return 0;
+}
+
+float get_temperature_c() {
+    return 0;
+}
+
+void enable_bias_estimation(bool, float) {}
+
+void set_wheels_still(bool) {}
+
 void update_g_bias() {}
 
 void set_g_bias(int32_t) {}
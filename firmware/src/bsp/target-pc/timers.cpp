@@ -13,6 +13,10 @@ static std::chrono::time_point start = timer::now();
 
 void timers::init(void) {}
 
+void timers::start_periodic(uint32_t, timer_callback_t) {}
+
+void timers::stop_periodic(void) {}
+
 uint32_t get_tick_ms(void) {
     return std::chrono::duration_cast<std::chrono::milliseconds>(timer::now() - start).count();
 }
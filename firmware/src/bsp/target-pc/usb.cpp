@@ -8,5 +8,20 @@ namespace bsp::usb {
 
 void init(void) {}
 
+bool is_connected(void) {
+    return false;
+}
+
+bool write(const uint8_t*, uint16_t) {
+    return false;
+}
+
+bool write_blocking(const uint8_t*, uint32_t, uint32_t) {
+    return false;
+}
+
+uint32_t get_dropped_bytes(void) {
+    return 0;
+}
 
 } // namespace
@@ -1,10 +1,12 @@
 #include "st/hal.h"
 
+#include "algorithms/ir_filter.hpp"
 #include "bsp/analog_sensors.hpp"
 #include "bsp/leds.hpp"
 #include "bsp/timers.hpp"
 #include "services/config.hpp"
 #include "utils/math.hpp"
+#include "utils/sample_bus.hpp"
 
 namespace bsp::analog_sensors {
 
@@ -17,16 +19,17 @@ namespace bsp::analog_sensors {
 /// @section Constants
 
 /* With these settings and ADC clock =  CLK/4 and sample cycles = 47.5*/
-/* We have 1 sample per 900us*/
+/* We have 1 frame per ~7us and 1 half buffer per ~141us, one IR emitter slot each*/
 #define ADC_1_DMA_CHANNELS 5
-#define READINGS_PER_ADC_1 128
+#define READINGS_PER_ADC_1 40
+#define ADC_1_FRAME_US 7.06f
 #define ADC_1_DMA_BUFFER_SIZE (ADC_1_DMA_CHANNELS * READINGS_PER_ADC_1)
 #define ADC_1_DMA_HALF_BUFFER_SIZE (ADC_1_DMA_BUFFER_SIZE / 2)
 
 /* With these settings and ADC clock =  CLK/4 and sample cycles = 47.5*/
-/* We have 1 sample per 45us*/
+/* We have 1 half buffer per 180us (~5.5kHz current loop)*/
 #define ADC_2_DMA_CHANNELS 2
-#define READINGS_PER_ADC_2 32
+#define READINGS_PER_ADC_2 128
 #define ADC_2_DMA_BUFFER_SIZE (ADC_2_DMA_CHANNELS * READINGS_PER_ADC_2)
 #define ADC_2_DMA_HALF_BUFFER_SIZE (ADC_2_DMA_BUFFER_SIZE / 2)
 
@@ -41,7 +44,26 @@ namespace bsp::analog_sensors {
 #define PWR_BAT_VOLTAGE_MULTIPLIER (4.19) // Experimentaly set
 #define PWR_BAT_POSITION_IN_ADC 4
 
-#define IR_AVG_WINDOW 20
+// Each sensor gets one lit slot per schedule round (5 half buffers, ~0.71 ms), ~1.4 kHz per sensor against the
+// ~1.1 kHz of the simultaneous on/off scheme. The window keeps the ~18 ms span that scheme had with 20 samples, the
+// wall thresholds were tuned with that span
+#define IR_SLOT_US (ADC_1_FRAME_US * ADC_1_DMA_HALF_BUFFER_SIZE / ADC_1_DMA_CHANNELS)
+#define IR_FILTER_SPAN_US 18000.0f
+#define IR_AVG_WINDOW static_cast<size_t>(IR_FILTER_SPAN_US / (IR_SLOT_US * IR_SCHEDULE_SLOTS) + 0.5f)
+#define IR_IIR_SHIFT 4 // alpha = 1/16, ~11 ms time constant at one update per round
+
+#define BATTERY_IIR_SHIFT 4 // alpha = 1/16 per half buffer, ~2 ms time constant
+
+// Frames at the start of each slot taken before the emitters switched or while the phototransistors settle
+#define IR_SETTLE_FRAMES 4
+#define IR_SLOT_DARK -1
+
+// DRV8874 IPROPI current mirror, V = R_IPROPI * A_IPROPI * I. A_IPROPI is 455 uA/A (DRV8874 datasheet)
+// and R_IPROPI is 2 kOhm (Fujin_Motors schematic), so 0.91 V/A and 3.62 A at full scale
+#define CURRENT_SENSE_IPROPI_OHMS (2000.0f)
+#define CURRENT_SENSE_IPROPI_GAIN (455e-6f)
+#define CURRENT_SENSE_AMPS_PER_VOLT (1.0f / (CURRENT_SENSE_IPROPI_OHMS * CURRENT_SENSE_IPROPI_GAIN))
+#define CURRENT_OFFSET_SAMPLES 64
 
 /// @section Private variables
 
@@ -53,10 +75,32 @@ static uint32_t ir_readings[4];
 static int32_t ir_readings_on[4];
 static int32_t ir_readings_off[4];
 static uint32_t battery_reading;
+static uint32_t battery_state; // battery_reading << BATTERY_IIR_SHIFT
 static uint32_t current_reading[2];
-static bool modulation_enabled;
-static uint32_t ir_window[4][IR_AVG_WINDOW];
-static size_t window_idx[4];
+static uint32_t current_offset[2];
+static bsp_analog_ready_callback_t current_ready_callback;
+static volatile bool modulation_enabled;
+static algorithm::IrFilter ir_filters[4];
+static uint16_t ir_lut[4][IR_LUT_POINTS];
+static bool ir_lut_loaded[4];
+
+// One slot per ADC1 half buffer. Dark slots read the ambient light of all sensors, lit slots turn on a single emitter
+// so its light can't reach the other receivers
+static constexpr int8_t ir_schedule[] = {
+    IR_SLOT_DARK, SensingDirection::RIGHT, SensingDirection::FRONT_LEFT, SensingDirection::FRONT_RIGHT,
+    SensingDirection::LEFT,
+};
+static constexpr bsp::leds::Emitter ir_emitters[4] = {
+    bsp::leds::RIGHT_SIDE,
+    bsp::leds::LEFT_FRONT,
+    bsp::leds::RIGHT_FRONT,
+    bsp::leds::LEFT_SIDE,
+};
+static constexpr uint8_t IR_SCHEDULE_SLOTS = sizeof(ir_schedule) / sizeof(ir_schedule[0]);
+static volatile uint8_t ir_slot_index;
+static uint32_t last_adc1_callback_us;
+static bool ir_resync_pending;
+static_assert(IR_AVG_WINDOW <= algorithm::IrFilter::MAX_WINDOW);
 
 /// @section Interface implementation
 
@@ -64,25 +108,28 @@ void init(void) {
     MX_ADC1_Init();
     HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED);
 
-    // Current sensor is not being used for now
-    // MAX_ADC2_Init();
-    // HAL_ADCEx_Calibration_Start(&hadc2, ADC_SINGLE_ENDED);
+    MX_ADC2_Init();
+    HAL_ADCEx_Calibration_Start(&hadc2, ADC_SINGLE_ENDED);
 }
 
 void start(void) {
     HAL_ADC_Start_DMA(&hadc1, adc_1_dma_buffer, ADC_1_DMA_BUFFER_SIZE);
-    // HAL_ADC_Start_DMA(&hadc2, adc_2_dma_buffer, ADC_2_DMA_BUFFER_SIZE);
+    HAL_ADC_Start_DMA(&hadc2, adc_2_dma_buffer, ADC_2_DMA_BUFFER_SIZE);
 }
 
 void stop(void) {
     HAL_ADC_Stop_DMA(&hadc1);
-    // HAL_ADC_Stop_DMA(&hadc2);
+    HAL_ADC_Stop_DMA(&hadc2);
 }
 
 void register_callback(bsp_analog_ready_callback_t callback) {
     reading_ready_callback = callback;
 }
 
+void register_current_callback(bsp_analog_ready_callback_t callback) {
+    current_ready_callback = callback;
+}
+
 uint32_t* ir_latest_reading(void) {
     return ir_readings;
 }
@@ -109,6 +156,24 @@ uint32_t* current_latest_reading(void) {
     return current_reading;
 }
 
+float current_latest_reading_amps(CurrentSensor sensor) {
+    int32_t counts = static_cast<int32_t>(current_reading[sensor]) - static_cast<int32_t>(current_offset[sensor]);
+    return (counts / ADC_MAX_VALUE) * ADC_MAX_VOLTAGE_VOLTS * CURRENT_SENSE_AMPS_PER_VOLT;
+}
+
+void current_calibrate_offset(void) {
+    uint32_t sum[2] = {0};
+
+    for (int i = 0; i < CURRENT_OFFSET_SAMPLES; i++) {
+        sum[CURRENT_LEFT] += current_reading[CURRENT_LEFT];
+        sum[CURRENT_RIGHT] += current_reading[CURRENT_RIGHT];
+        bsp::delay_us(200);
+    }
+
+    current_offset[CURRENT_LEFT] = sum[CURRENT_LEFT] / CURRENT_OFFSET_SAMPLES;
+    current_offset[CURRENT_RIGHT] = sum[CURRENT_RIGHT] / CURRENT_OFFSET_SAMPLES;
+}
+
 uint32_t ir_reading(SensingDirection direction) {
     return ir_readings[direction];
 }
@@ -128,11 +193,25 @@ bool ir_reading_wall(SensingDirection direction) {
     }
 }
 
-int32_t ir_side_wall_error() {
-    int32_t left_error = ir_readings[SensingDirection::LEFT] - services::Config::ir_wall_dist_ref_left;
-    int32_t right_error = ir_readings[SensingDirection::RIGHT] - services::Config::ir_wall_dist_ref_right;
+static bool ir_linearized(SensingDirection first, SensingDirection second) {
+    return services::Config::ir_linearize > 0.5f && ir_lut_loaded[first] && ir_lut_loaded[second];
+}
+
+// Positive when the robot is closer than the reference, in counts or mm
+static float ir_wall_error(SensingDirection direction, float raw_reference, bool linearized) {
+    if (linearized) {
+        return ir_raw_to_mm(direction, raw_reference) - ir_reading_mm(direction);
+    }
+
+    return static_cast<float>(ir_readings[direction]) - raw_reference;
+}
+
+float ir_side_wall_error() {
+    bool linearized = ir_linearized(SensingDirection::LEFT, SensingDirection::RIGHT);
+    float left_error = ir_wall_error(SensingDirection::LEFT, services::Config::ir_wall_dist_ref_left, linearized);
+    float right_error = ir_wall_error(SensingDirection::RIGHT, services::Config::ir_wall_dist_ref_right, linearized);
 
-    int32_t ir_error;
+    float ir_error;
     if (ir_wall_control_valid(SensingDirection::LEFT) && ir_wall_control_valid(SensingDirection::RIGHT)) {
         ir_error = left_error - right_error;
     } else if (ir_wall_control_valid(SensingDirection::LEFT)) {
@@ -211,15 +290,18 @@ SensingStatus ir_get_sensing_status() {
     return status;
 }
 
-int32_t ir_diagonal_error() {
+float ir_diagonal_error() {
     bool greater_error_left = ir_readings[SensingDirection::FRONT_LEFT] > ir_readings[SensingDirection::FRONT_RIGHT];
+    bool linearized = ir_linearized(SensingDirection::FRONT_LEFT, SensingDirection::FRONT_RIGHT);
 
-    int32_t ir_error;
+    float ir_error;
 
     if (greater_error_left && ir_wall_control_valid(SensingDirection::FRONT_LEFT)) {
-        ir_error = ir_readings[SensingDirection::FRONT_LEFT] - services::Config::ir_wall_dist_ref_front_left;
+        ir_error = ir_wall_error(SensingDirection::FRONT_LEFT, services::Config::ir_wall_dist_ref_front_left,
+                                 linearized);
     } else if (!greater_error_left && ir_wall_control_valid(SensingDirection::FRONT_RIGHT)) {
-        ir_error = -(ir_readings[SensingDirection::FRONT_RIGHT] - services::Config::ir_wall_dist_ref_front_right);
+        ir_error = -ir_wall_error(SensingDirection::FRONT_RIGHT, services::Config::ir_wall_dist_ref_front_right,
+                                  linearized);
     } else {
         ir_error = 0;
     }
@@ -242,50 +324,163 @@ bool ir_wall_control_valid(SensingDirection direction) {
     }
 }
 
+bool ir_set_lut(SensingDirection direction, const uint16_t raw[IR_LUT_POINTS]) {
+    for (uint8_t i = 1; i < IR_LUT_POINTS; i++) {
+        if (raw[i] >= raw[i - 1]) {
+            ir_lut_loaded[direction] = false;
+            return false;
+        }
+    }
+
+    for (uint8_t i = 0; i < IR_LUT_POINTS; i++) {
+        ir_lut[direction][i] = raw[i];
+    }
+    ir_lut_loaded[direction] = true;
+
+    return true;
+}
+
+bool ir_lut_valid(SensingDirection direction) {
+    return ir_lut_loaded[direction];
+}
+
+float ir_raw_to_mm(SensingDirection direction, uint32_t raw) {
+    if (!ir_lut_loaded[direction]) {
+        return -1;
+    }
+
+    const uint16_t* lut = ir_lut[direction];
+
+    // Readings decrease with the distance, saturate outside the calibrated range
+    if (raw >= lut[0]) {
+        return ir_lut_distances_mm[0];
+    }
+
+    if (raw <= lut[IR_LUT_POINTS - 1]) {
+        return ir_lut_distances_mm[IR_LUT_POINTS - 1];
+    }
+
+    uint8_t i = 1;
+    while (raw < lut[i]) {
+        i++;
+    }
+
+    float ratio = static_cast<float>(lut[i - 1] - raw) / static_cast<float>(lut[i - 1] - lut[i]);
+    return ir_lut_distances_mm[i - 1] + ratio * (ir_lut_distances_mm[i] - ir_lut_distances_mm[i - 1]);
+}
+
+float ir_reading_mm(SensingDirection direction) {
+    return ir_raw_to_mm(direction, ir_readings[direction]);
+}
+
 void enable_modulation(bool enable) {
+    if (enable && !modulation_enabled) {
+        // Filters restart with the filter types currently in Config
+        float filter_types[4];
+        filter_types[SensingDirection::RIGHT] = services::Config::ir_filter_type_right;
+        filter_types[SensingDirection::FRONT_LEFT] = services::Config::ir_filter_type_front_left;
+        filter_types[SensingDirection::FRONT_RIGHT] = services::Config::ir_filter_type_front_right;
+        filter_types[SensingDirection::LEFT] = services::Config::ir_filter_type_left;
+
+        for (int i = 0; i < 4; i++) {
+            auto type = static_cast<algorithm::IrFilter::FilterType>(static_cast<uint8_t>(filter_types[i]));
+            ir_filters[i].configure(type, IR_AVG_WINDOW, IR_IIR_SHIFT);
+        }
+    }
+
+    // Every sequence starts from the dark slot, the ADC callback leaves the emitters alone meanwhile
+    modulation_enabled = false;
+    bsp::leds::ir_emitter_all_off();
+    ir_slot_index = 0;
+    ir_resync_pending = false;
     modulation_enabled = enable;
 }
 
 /// @section Private functions
 
+// Readings the DMA has written past the end of data, wrapping around the circular buffer
+static uint32_t adc1_dma_readings_past(uint32_t* data) {
+    uint32_t position = ADC_1_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(hadc1.DMA_Handle);
+    uint32_t next_start = (data - adc_1_dma_buffer + ADC_1_DMA_HALF_BUFFER_SIZE) % ADC_1_DMA_BUFFER_SIZE;
+    return (position + ADC_1_DMA_BUFFER_SIZE - next_start) % ADC_1_DMA_BUFFER_SIZE;
+}
+
+// True when the DMA is already back in the half being processed or a whole half buffer went by unhandled, so
+// the emitter that lit this data is not the one the slot index says
+static bool adc1_callback_late(uint32_t* data, uint32_t now) {
+    uint32_t elapsed_us = now - last_adc1_callback_us;
+    last_adc1_callback_us = now;
+
+    bool dma_in_data = adc1_dma_readings_past(data) >= ADC_1_DMA_HALF_BUFFER_SIZE;
+    return dma_in_data || elapsed_us > static_cast<uint32_t>(1.5f * IR_SLOT_US);
+}
+
+// Restarts the sequence, the half being filled is dropped and a dark slot follows it
+static void ir_resync(void) {
+    bsp::leds::ir_emitter_all_off();
+    ir_slot_index = 0;
+    ir_resync_pending = true;
+}
+
 void adc1_callback(uint32_t* data) {
-    static bool read_ir_off = true;
-    uint32_t aux_readings[ADC_1_DMA_CHANNELS] = {0};
-
-    if (modulation_enabled) {
-        if (read_ir_off) {
-            bsp::leds::ir_emitter_all_on();
-        } else {
-            bsp::leds::ir_emitter_all_off();
-        }
+    uint32_t aux_readings[ADC_1_DMA_CHANNELS];
+    uint32_t now = bsp::get_tick_us();
+    bool late = adc1_callback_late(data, now);
+
+    // Power of two sample count, divisions are shifts
+    static constexpr uint32_t samples = ADC_1_DMA_HALF_BUFFER_SIZE / ADC_1_DMA_CHANNELS - IR_SETTLE_FRAMES;
+    static_assert((samples & (samples - 1)) == 0);
+    algorithm::sum_interleaved(data + IR_SETTLE_FRAMES * ADC_1_DMA_CHANNELS, samples, aux_readings);
+    for (int i = 0; i < ADC_1_DMA_CHANNELS; i++) {
+        aux_readings[i] /= samples;
     }
 
-    for (uint16_t i = 0; i < (ADC_1_DMA_HALF_BUFFER_SIZE - 1); i += ADC_1_DMA_CHANNELS) {
-        for (uint16_t j = 0; j < ADC_1_DMA_CHANNELS; j++) {
-            aux_readings[j] += data[i + j];
-        }
+    // Integer IIR on a scaled state. The rounded output is what gets subtracted, so it settles on the input
+    // from either side instead of truncating low
+    battery_state += aux_readings[4] - battery_reading;
+    battery_reading = (battery_state + (1 << (BATTERY_IIR_SHIFT - 1))) >> BATTERY_IIR_SHIFT;
+
+    if (!modulation_enabled) {
+        ir_readings[0] = aux_readings[0];
+        return;
+    }
+
+    if (late) {
+        ir_resync();
+        return;
     }
 
-    for (uint16_t j = 0; j < ADC_1_DMA_CHANNELS; j++) {
-        aux_readings[j] /= (ADC_1_DMA_HALF_BUFFER_SIZE / ADC_1_DMA_CHANNELS);
+    if (ir_resync_pending) {
+        ir_resync_pending = false;
+        return;
     }
 
-    for (int i = 0; i < 4; i++) {
-        if (modulation_enabled) {
-            if (read_ir_off) {
-                ir_readings_off[i] = aux_readings[i];
-            } else {
-                ir_readings_on[i] = aux_readings[i];
-                uint32_t reading = std::max(ir_readings_on[i] - ir_readings_off[i], 0L);
-                ir_readings[i] = moving_average(ir_window[i], IR_AVG_WINDOW, &window_idx[i], reading);
-            }
-        } else {
-            ir_readings[0] = aux_readings[0];
+    // The half buffer was sampled during the current slot
+    int8_t slot = ir_schedule[ir_slot_index];
+    if (slot == IR_SLOT_DARK) {
+        for (int i = 0; i < 4; i++) {
+            ir_readings_off[i] = aux_readings[i];
         }
+    } else {
+        ir_readings_on[slot] = aux_readings[slot];
+        uint32_t reading = std::max(ir_readings_on[slot] - ir_readings_off[slot], 0L);
+        ir_readings[slot] = ir_filters[slot].update(reading);
+        sample_bus::publish(static_cast<sample_bus::Channel>(sample_bus::IR_RIGHT + slot), now, ir_readings[slot]);
+        bsp::leds::ir_emitter_off(ir_emitters[slot]);
+    }
+
+    // The ADC is already filling the other half, its first frames are skipped while the emitter switches. A
+    // preempted callback can get here past them, then the other half would mix two slots
+    if (adc1_dma_readings_past(data) >= IR_SETTLE_FRAMES * ADC_1_DMA_CHANNELS) {
+        ir_resync();
+        return;
     }
 
-    read_ir_off = !read_ir_off;
-    battery_reading = 0.5 * aux_readings[4] + battery_reading * 0.5;
+    ir_slot_index = (ir_slot_index + 1) % IR_SCHEDULE_SLOTS;
+    int8_t next_slot = ir_schedule[ir_slot_index];
+    if (next_slot != IR_SLOT_DARK) {
+        bsp::leds::ir_emitter_on(ir_emitters[next_slot]);
+    }
 }
 
 void adc2_callback(uint32_t* data) {
@@ -301,8 +496,8 @@ void adc2_callback(uint32_t* data) {
         aux_readings[j] /= (ADC_2_DMA_HALF_BUFFER_SIZE / ADC_2_DMA_CHANNELS);
     }
 
-    current_reading[0] = aux_readings[0];
-    current_reading[1] = aux_readings[1];
+    current_reading[CURRENT_LEFT] = aux_readings[0];
+    current_reading[CURRENT_RIGHT] = aux_readings[1];
 }
 
 }
@@ -312,23 +507,31 @@ void adc2_callback(uint32_t* data) {
 void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
     if (hadc->Instance == ADC1) {
         bsp::analog_sensors::adc1_callback(&bsp::analog_sensors::adc_1_dma_buffer[0]);
+
+        if (bsp::analog_sensors::reading_ready_callback != NULL) {
+            bsp::analog_sensors::reading_ready_callback();
+        }
     } else if (hadc->Instance == ADC2) {
         bsp::analog_sensors::adc2_callback(&bsp::analog_sensors::adc_2_dma_buffer[0]);
-    }
 
-    if (bsp::analog_sensors::reading_ready_callback != NULL) {
-        bsp::analog_sensors::reading_ready_callback();
+        if (bsp::analog_sensors::current_ready_callback != NULL) {
+            bsp::analog_sensors::current_ready_callback();
+        }
     }
 }
 
 void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
     if (hadc->Instance == ADC1) {
         bsp::analog_sensors::adc1_callback(&bsp::analog_sensors::adc_1_dma_buffer[ADC_1_DMA_HALF_BUFFER_SIZE]);
+
+        if (bsp::analog_sensors::reading_ready_callback != NULL) {
+            bsp::analog_sensors::reading_ready_callback();
+        }
     } else if (hadc->Instance == ADC2) {
         bsp::analog_sensors::adc2_callback(&bsp::analog_sensors::adc_2_dma_buffer[ADC_2_DMA_HALF_BUFFER_SIZE]);
-    }
 
-    if (bsp::analog_sensors::reading_ready_callback != NULL) {
-        bsp::analog_sensors::reading_ready_callback();
+        if (bsp::analog_sensors::current_ready_callback != NULL) {
+            bsp::analog_sensors::current_ready_callback();
+        }
     }
 }
@@ -9,6 +9,10 @@ constexpr uint16_t WRITE_SIZE = 64;
 constexpr uint16_t READ_SIZE = 128;
 constexpr uint16_t I2C_ADDRESS = 0xA0;
 constexpr uint32_t I2C_TIMEOUT = 500;
+constexpr uint32_t WRITE_CYCLE_TIMEOUT = 10;
+
+static bool async_pending = false;
+static bool async_failed = false;
 
 namespace devices {
 
@@ -24,6 +28,12 @@ EEPROM_24LC512::Result EEPROM_24LC512::write(uint16_t write_addr, uint8_t* data,
     while (size > 0) {
         int bytes_to_write = std::min(WRITE_SIZE - (write_addr % WRITE_SIZE), (int)size);
 
+        // ACK polling, the chip answers again once the previous page is written
+        if (!wait_ready()) {
+            return EEPROM_24LC512::Result::ERROR;
+        }
+
+        retries = 0;
         do {
             ret = HAL_I2C_Mem_Write(&hi2c3, I2C_ADDRESS, write_addr, I2C_MEMADD_SIZE_16BIT, data, bytes_to_write,
                            I2C_TIMEOUT);
@@ -52,6 +62,10 @@ EEPROM_24LC512::Result EEPROM_24LC512::read(uint16_t addr, uint8_t* read_data, u
         return EEPROM_24LC512::Result::ERROR;
     }
 
+    if (!wait_ready()) {
+        return EEPROM_24LC512::Result::ERROR;
+    }
+
     int offset = 0;
 
     while (size > 0) {
@@ -75,4 +89,65 @@ EEPROM_24LC512::Result EEPROM_24LC512::read(uint16_t addr, uint8_t* read_data, u
     return EEPROM_24LC512::Result::OK;
 }
 
+EEPROM_24LC512::Result EEPROM_24LC512::write_page_async(uint16_t write_addr, const uint8_t* data, uint16_t size) {
+    if (size == 0 || size > WRITE_SIZE - (write_addr % WRITE_SIZE)) {
+        return EEPROM_24LC512::Result::ERROR;
+    }
+
+    if (poll() == EEPROM_24LC512::Result::BUSY) {
+        return EEPROM_24LC512::Result::BUSY;
+    }
+
+    if (HAL_I2C_Mem_Write_IT(&hi2c3, I2C_ADDRESS, write_addr, I2C_MEMADD_SIZE_16BIT, const_cast<uint8_t*>(data),
+                             size) != HAL_OK) {
+        return EEPROM_24LC512::Result::ERROR;
+    }
+
+    async_pending = true;
+    async_failed = false;
+    return EEPROM_24LC512::Result::OK;
+}
+
+EEPROM_24LC512::Result EEPROM_24LC512::poll() {
+    if (HAL_I2C_GetState(&hi2c3) != HAL_I2C_STATE_READY) {
+        return EEPROM_24LC512::Result::BUSY;
+    }
+
+    // The error code is only meaningful right after the transfer, ACK polling overwrites it
+    if (async_pending) {
+        async_pending = false;
+        async_failed = HAL_I2C_GetError(&hi2c3) != HAL_I2C_ERROR_NONE;
+    }
+
+    // The chip does not acknowledge its address until the page write cycle is over
+    if (HAL_I2C_IsDeviceReady(&hi2c3, I2C_ADDRESS, 1, 1) != HAL_OK) {
+        return EEPROM_24LC512::Result::BUSY;
+    }
+
+    // Each failure is reported once
+    if (async_failed) {
+        async_failed = false;
+        return EEPROM_24LC512::Result::ERROR;
+    }
+
+    return EEPROM_24LC512::Result::OK;
+}
+
+bool EEPROM_24LC512::wait_ready() {
+    uint32_t start = HAL_GetTick();
+    while (HAL_I2C_GetState(&hi2c3) != HAL_I2C_STATE_READY) {
+        if (HAL_GetTick() - start > I2C_TIMEOUT) {
+            return false;
+        }
+    }
+
+    while (HAL_I2C_IsDeviceReady(&hi2c3, I2C_ADDRESS, 1, 1) != HAL_OK) {
+        if (HAL_GetTick() - start > I2C_TIMEOUT + WRITE_CYCLE_TIMEOUT) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 }
@@ -8,11 +8,23 @@ class EEPROM_24LC512 {
 public:
     enum class Result {
         OK,
-        ERROR
+        ERROR,
+        BUSY
     };
 
     Result write(uint16_t write_addr, uint8_t* data, uint16_t len);
     Result read(uint16_t addr, uint8_t* read_data, uint16_t len);
+
+    /// @brief Starts an interrupt driven write inside one page, data must stay valid until poll() stops
+    /// returning BUSY
+    Result write_page_async(uint16_t write_addr, const uint8_t* data, uint16_t len);
+
+    /// @brief BUSY while a transfer or the internal write cycle runs (ACK polling), ERROR if the last
+    /// asynchronous write failed
+    Result poll();
+
+private:
+    bool wait_ready();
 };
 
 }
@@ -1,16 +1,56 @@
 #include "st/hal.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 #include "bsp/eeprom.hpp"
 #include "bsp/timers.hpp"
 #include "devices/eeprom_24lc512.hpp"
+#include "utils/RingBuffer.hpp"
 
 namespace bsp::eeprom {
 
+// A page of a queued write, the callback is kept on the last page of each request
+struct PageWrite {
+    uint16_t address;
+    uint8_t size;
+    bool last;
+    write_callback_t callback;
+    uint8_t data[PAGE_SIZE];
+};
+
+static constexpr uint32_t FLUSH_TIMEOUT_MS = 1000;
+
+static RingBuffer<PageWrite, WRITE_QUEUE_PAGES> write_queue;
+static PageWrite current_page;
+static uint16_t queued_pages = 0; // Including current_page
+static bool page_taken = false;
+static bool page_started = false;
+static bool request_failed = false;
+
 bool address_is_valid(uint16_t address) {
     return address <= ADDR_MAX;
 }
 
+static void finish_page(bool stored) {
+    request_failed |= !stored;
+    page_taken = false;
+    page_started = false;
+
+    // write_queued checks and adds to the count in one critical section
+    __disable_irq();
+    queued_pages--;
+    __enable_irq();
+
+    if (current_page.last) {
+        bool failed = request_failed;
+        request_failed = false;
+        if (current_page.callback != nullptr) {
+            current_page.callback(failed ? ERROR : OK);
+        }
+    }
+}
+
 /// @section Interface implementation
 
 EepromResult init() {
@@ -23,6 +63,10 @@ EepromResult read_u8(uint16_t address, uint8_t* data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     devices::EEPROM_24LC512 eeprom;
     auto result = eeprom.read(address, data, sizeof(uint8_t));
     if (result == devices::EEPROM_24LC512::Result::OK) {
@@ -38,6 +82,10 @@ EepromResult write_u8(uint16_t address, uint8_t data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     devices::EEPROM_24LC512 eeprom;
     auto result = eeprom.write(address, &data, sizeof(uint8_t));
     if (result == devices::EEPROM_24LC512::Result::OK) {
@@ -52,6 +100,10 @@ EepromResult read_u16(uint16_t address, uint16_t* data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     uint8_t read_data[2];
 
     devices::EEPROM_24LC512 eeprom;
@@ -71,6 +123,10 @@ EepromResult write_u16(uint16_t address, uint16_t data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     uint8_t write_data[2] = {(uint8_t)((data >> 8) & 0xff), (uint8_t)(data & 0xff)};
 
     devices::EEPROM_24LC512 eeprom;
@@ -87,6 +143,10 @@ EepromResult read_u32(uint16_t address, uint32_t* data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     uint8_t read_data[4];
 
     devices::EEPROM_24LC512 eeprom;
@@ -107,6 +167,10 @@ EepromResult read_array(uint16_t address, uint8_t* data, uint16_t size) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     devices::EEPROM_24LC512 eeprom;
     auto result = eeprom.read(address, data, size);
     if (result == devices::EEPROM_24LC512::Result::OK) {
@@ -121,6 +185,10 @@ EepromResult write_u32(uint16_t address, uint32_t data) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     uint8_t write_data[4] = {(uint8_t)((data >> 24) & 0xff), (uint8_t)((data >> 16) & 0xff),
                              (uint8_t)((data >> 8) & 0xff), (uint8_t)(data & 0xff)};
 
@@ -137,6 +205,10 @@ EepromResult write_array(uint16_t address, uint8_t* data, uint16_t size) {
         return ERROR;
     }
 
+    if (flush() == BUSY) {
+        return BUSY;
+    }
+
     devices::EEPROM_24LC512 eeprom;
     auto result = eeprom.write(address, data, size);
     if (result == devices::EEPROM_24LC512::Result::OK) {
@@ -146,7 +218,99 @@ EepromResult write_array(uint16_t address, uint8_t* data, uint16_t size) {
     return ERROR;
 }
 
+EepromResult write_queued(uint16_t address, const uint8_t* data, uint16_t size, write_callback_t callback) {
+    if (size == 0 || !address_is_valid(address + size - 1)) {
+        return ERROR;
+    }
+
+    uint16_t pages = (address % PAGE_SIZE + size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    // The room check, the pages and the count go in together even if an interrupt queues a write too
+    __disable_irq();
+    if (queued_pages + pages > WRITE_QUEUE_PAGES) {
+        __enable_irq();
+        return BUSY;
+    }
+
+    while (size > 0) {
+        PageWrite page;
+        page.address = address;
+        page.size = std::min<uint16_t>(PAGE_SIZE - address % PAGE_SIZE, size);
+        page.last = page.size == size;
+        page.callback = callback;
+        std::memcpy(page.data, data, page.size);
+        write_queue.put(page);
+
+        address += page.size;
+        data += page.size;
+        size -= page.size;
+    }
+
+    queued_pages += pages;
+    __enable_irq();
+
+    return OK;
+}
+
+void update(void) {
+    devices::EEPROM_24LC512 eeprom;
+
+    if (page_started) {
+        auto result = eeprom.poll();
+        if (result == devices::EEPROM_24LC512::Result::BUSY) {
+            return;
+        }
+
+        finish_page(result == devices::EEPROM_24LC512::Result::OK);
+    }
+
+    while (!page_taken) {
+        if (!write_queue.get(&current_page)) {
+            return;
+        }
+
+        page_taken = true;
+
+        // The rest of a request with a failed page is dropped
+        if (request_failed) {
+            finish_page(false);
+        }
+    }
+
+    // BUSY while the chip still runs a write cycle, the page is retried on the next update
+    auto result = eeprom.write_page_async(current_page.address, current_page.data, current_page.size);
+    if (result == devices::EEPROM_24LC512::Result::OK) {
+        page_started = true;
+    } else if (result == devices::EEPROM_24LC512::Result::ERROR) {
+        finish_page(false);
+    }
+}
+
+EepromResult flush(void) {
+    // The queue only drains from the main loop, waiting for it in an interrupt would never end
+    if (__get_IPSR() != 0) {
+        return BUSY;
+    }
+
+    uint32_t start = bsp::get_tick_ms();
+    while (queued_pages > 0) {
+        if (bsp::get_tick_ms() - start > FLUSH_TIMEOUT_MS) {
+            return ERROR;
+        }
+
+        update();
+    }
+
+    return OK;
+}
+
+uint16_t queue_free_pages(void) {
+    return WRITE_QUEUE_PAGES - queued_pages;
+}
+
 void clear(void) {
+    flush();
+
     uint32_t addr_to_clean = 0;
     while (addr_to_clean < 0xffff) {
         uint8_t data_write[64];
@@ -172,6 +336,8 @@ void clear(void) {
 }
 
 void print_all(void) {
+    flush();
+
     for (int i = 0; i < 0xffff; i += 64) {
         uint8_t data_read[64];
         devices::EEPROM_24LC512 eeprom;
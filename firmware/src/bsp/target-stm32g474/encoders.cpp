@@ -1,8 +1,11 @@
 #include "st/hal.h"
 
+#include "algorithms/velocity_estimator.hpp"
 #include "bsp/encoders.hpp"
 #include "bsp/timers.hpp"
+#include "devices/AS5047P.hpp"
 #include "pin_mapping.h"
+#include "utils/sample_bus.hpp"
 
 namespace bsp::encoders {
 
@@ -19,6 +22,23 @@ static constexpr float PULSES_PER_WHEEL_ROTATION = (WHEEL_TO_ENCODER_RATIO * ENC
 
 static constexpr float ENCODER_DIST_MM_PULSE = (WHEEL_PERIMETER_MM / PULSES_PER_WHEEL_ROTATION);
 
+static constexpr int32_t AS5047_COUNTS_PER_ROTATION = 16384;
+static constexpr float AS5047_DIST_MM_COUNT = (WHEEL_PERIMETER_MM / (WHEEL_TO_ENCODER_RATIO * AS5047_COUNTS_PER_ROTATION));
+
+// ANGLECOM read and NOP read frames, parity included
+static constexpr uint16_t AS5047_READ_ANGLE_FRAME = 0xFFFF;
+static constexpr uint16_t AS5047_READ_NOP_FRAME = 0xC000;
+
+// Angle grows in opposite directions on each wheel, same convention as the ABI B pin
+static constexpr int32_t AS5047_LEFT_SIGN = -1;
+static constexpr int32_t AS5047_RIGHT_SIGN = 1;
+
+// Velocity IIR time constant, same as the 0.1 / 0.9 filter at 1 kHz
+static constexpr float VELOCITY_FILTER_TAU_US = 9000.0;
+
+// Alpha-beta tracker time constant, follows ramps without lag so it can be faster than the IIR for the same noise
+static constexpr float VELOCITY_TRACKER_TAU_S = 0.006;
+
 
 static float linear_velocity_m_s;
 
@@ -34,12 +54,87 @@ uint32_t delta_vel_time;
 EncoderData left_encoder;
 EncoderData right_encoder;
 
+// Ticks since the last velocity update, independent of the odometry ticks so velocities can run at any rate
+static volatile int32_t left_velocity_ticks;
+static volatile int32_t right_velocity_ticks;
+static float velocity_filter_alpha = 0.1;
+static float filtered_acceleration_m_s2;
+
+static algorithm::MTVelocityEstimator left_estimator(ENCODER_DIST_MM_PULSE, MAX_TIME_WITHOUT_ENCODER_US);
+static algorithm::MTVelocityEstimator right_estimator(ENCODER_DIST_MM_PULSE, MAX_TIME_WITHOUT_ENCODER_US);
+static algorithm::AlphaBetaTracker left_tracker(VELOCITY_TRACKER_TAU_S);
+static algorithm::AlphaBetaTracker right_tracker(VELOCITY_TRACKER_TAU_S);
+
+static EncoderBackend backend = EXTI_ABI;
+static float dist_mm_per_tick = ENCODER_DIST_MM_PULSE;
+
+static devices::AS5047::Result as5047_transmit_receive(uint16_t* tx_data, uint16_t* rx_data, uint16_t size);
+static devices::AS5047 as5047_left(SPI_CS_1_PORT, SPI_CS_1_PIN, as5047_transmit_receive);
+static devices::AS5047 as5047_right(SPI_CS_2_PORT, SPI_CS_2_PIN, as5047_transmit_receive);
+
+// Each read is a command frame followed by a NOP frame that returns the angle, both sensors share SPI1
+enum SpiStep : uint8_t { SPI_IDLE, SPI_LEFT_COMMAND, SPI_RIGHT_COMMAND, SPI_LEFT_ANGLE, SPI_RIGHT_ANGLE };
+static volatile SpiStep spi_step = SPI_IDLE;
+static uint16_t spi_tx_frame;
+static uint16_t spi_rx_frame;
+static uint16_t last_angle[2];
+static bool last_angle_valid[2];
+
+/// @section Private functions declaration
+
+void spi_transfer_complete_callback();
+void spi_error_callback();
+
 /// @section Interface implementation
 
 void init() {
     reset();
 }
 
+bool set_backend(EncoderBackend new_backend) {
+    if (new_backend == QUADRATURE_TIMER) {
+        // ENC_2_A (PC7) and ENC_2_B (PB15) are not a CH1/CH2 pair of any timer on this board
+        return false;
+    }
+
+    if (new_backend == AS5047_SPI) {
+        static bool spi_initialized = false;
+        if (!spi_initialized) {
+            MX_SPI1_Init();
+            as5047_left.init();
+            as5047_right.init();
+            spi_initialized = true;
+        }
+
+        uint16_t diagnostics;
+        if (as5047_left.read_register(devices::AS5047::VOL_DIAAGC_ADDR, &diagnostics) != devices::AS5047::OK ||
+            as5047_right.read_register(devices::AS5047::VOL_DIAAGC_ADDR, &diagnostics) != devices::AS5047::OK) {
+            return false;
+        }
+    }
+
+    // ABI interrupts only run on their own backend, EXTI lines 2 and 7 match the A pins
+    if (new_backend == EXTI_ABI) {
+        EXTI->IMR1 |= (ENCODER_LEFT_A_PIN | ENCODER_RIGHT_A_PIN);
+    } else {
+        EXTI->IMR1 &= ~(ENCODER_LEFT_A_PIN | ENCODER_RIGHT_A_PIN);
+    }
+
+    backend = new_backend;
+    dist_mm_per_tick = backend == AS5047_SPI ? AS5047_DIST_MM_COUNT : ENCODER_DIST_MM_PULSE;
+    left_estimator.dist_per_tick = dist_mm_per_tick;
+    right_estimator.dist_per_tick = dist_mm_per_tick;
+    last_angle_valid[LEFT] = false;
+    last_angle_valid[RIGHT] = false;
+    reset();
+
+    return true;
+}
+
+EncoderBackend get_backend() {
+    return backend;
+}
+
 void reset() {
     left_encoder = {0, DirectionType::CW, 0, MAX_TIME_WITHOUT_ENCODER_US + 1, 0, 0};
     right_encoder = {0, DirectionType::CW, 0, MAX_TIME_WITHOUT_ENCODER_US + 1, 0, 0};
@@ -56,6 +151,10 @@ EncoderData get_data(EncoderSide side) {
 }
 
 void gpio_exti_callback(uint16_t GPIO_Pin) {
+    if (backend != EXTI_ABI) {
+        return;
+    }
+
     uint32_t current_time_us = bsp::get_tick_us();
 
     if (GPIO_Pin == ENCODER_LEFT_A_PIN) {
@@ -64,6 +163,7 @@ void gpio_exti_callback(uint16_t GPIO_Pin) {
         left_encoder.last_update_tick_time = current_time_us;
         left_encoder.direction = HAL_GPIO_ReadPin(ENCODER_LEFT_B_PORT, ENCODER_LEFT_B_PIN) == GPIO_PIN_SET ? CCW : CW;
         left_encoder.ticks = left_encoder.direction == CW ? left_encoder.ticks - 1 : left_encoder.ticks + 1;
+        left_velocity_ticks = left_encoder.direction == CW ? left_velocity_ticks - 1 : left_velocity_ticks + 1;
 
     } else if (GPIO_Pin == ENCODER_RIGHT_A_PIN) {
 
@@ -72,10 +172,119 @@ void gpio_exti_callback(uint16_t GPIO_Pin) {
         right_encoder.direction =
             HAL_GPIO_ReadPin(ENCODER_RIGHT_B_PORT, ENCODER_RIGHT_B_PIN) == GPIO_PIN_SET ? CW : CCW;
         right_encoder.ticks = right_encoder.direction == CW ? right_encoder.ticks - 1 : right_encoder.ticks + 1;
+        right_velocity_ticks = right_encoder.direction == CW ? right_velocity_ticks - 1 : right_velocity_ticks + 1;
     }
 }
 
-void update_ticks() {}
+void update_ticks() {
+    if (backend != AS5047_SPI || spi_step != SPI_IDLE) {
+        return;
+    }
+
+    spi_step = SPI_LEFT_COMMAND;
+    spi_tx_frame = AS5047_READ_ANGLE_FRAME;
+    as5047_left.select();
+    if (HAL_SPI_TransmitReceive_DMA(&hspi1, reinterpret_cast<uint8_t*>(&spi_tx_frame),
+                                    reinterpret_cast<uint8_t*>(&spi_rx_frame), 1) != HAL_OK) {
+        as5047_left.deselect();
+        spi_step = SPI_IDLE;
+    }
+}
+
+static devices::AS5047::Result as5047_transmit_receive(uint16_t* tx_data, uint16_t* rx_data, uint16_t size) {
+    auto result = HAL_SPI_TransmitReceive(&hspi1, reinterpret_cast<uint8_t*>(tx_data),
+                                          reinterpret_cast<uint8_t*>(rx_data), size, 10);
+    return result == HAL_OK ? devices::AS5047::OK : devices::AS5047::ERROR;
+}
+
+static bool as5047_frame_ok(uint16_t frame) {
+    // Even parity over the whole frame and no error flag
+    uint16_t parity = frame;
+    parity ^= parity >> 8;
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+    return ((parity & 1) == 0) && ((frame & (1 << 14)) == 0);
+}
+
+static void as5047_angle_callback(EncoderSide side, uint16_t frame) {
+    if (!as5047_frame_ok(frame)) {
+        return;
+    }
+
+    uint16_t angle = frame & 0x3FFF;
+    if (!last_angle_valid[side]) {
+        last_angle[side] = angle;
+        last_angle_valid[side] = true;
+        return;
+    }
+
+    int32_t delta = static_cast<int32_t>(angle) - static_cast<int32_t>(last_angle[side]);
+    if (delta > (AS5047_COUNTS_PER_ROTATION / 2)) {
+        delta -= AS5047_COUNTS_PER_ROTATION;
+    } else if (delta < -(AS5047_COUNTS_PER_ROTATION / 2)) {
+        delta += AS5047_COUNTS_PER_ROTATION;
+    }
+    last_angle[side] = angle;
+
+    if (delta == 0) {
+        return;
+    }
+
+    uint32_t current_time_us = bsp::get_tick_us();
+    EncoderData& encoder = side == LEFT ? left_encoder : right_encoder;
+    int32_t ticks = delta * (side == LEFT ? AS5047_LEFT_SIGN : AS5047_RIGHT_SIGN);
+
+    encoder.last_delta_tick_time = current_time_us - encoder.last_update_tick_time;
+    encoder.last_update_tick_time = current_time_us;
+    encoder.direction = ticks < 0 ? CW : CCW;
+    encoder.ticks += ticks;
+    if (side == LEFT) {
+        left_velocity_ticks += ticks;
+    } else {
+        right_velocity_ticks += ticks;
+    }
+}
+
+void spi_transfer_complete_callback() {
+    switch (spi_step) {
+    case SPI_LEFT_COMMAND:
+        as5047_left.deselect();
+        spi_step = SPI_RIGHT_COMMAND;
+        as5047_right.select();
+        break;
+    case SPI_RIGHT_COMMAND:
+        as5047_right.deselect();
+        spi_step = SPI_LEFT_ANGLE;
+        spi_tx_frame = AS5047_READ_NOP_FRAME;
+        as5047_left.select();
+        break;
+    case SPI_LEFT_ANGLE:
+        as5047_left.deselect();
+        as5047_angle_callback(LEFT, spi_rx_frame);
+        spi_step = SPI_RIGHT_ANGLE;
+        as5047_right.select();
+        break;
+    case SPI_RIGHT_ANGLE:
+        as5047_right.deselect();
+        as5047_angle_callback(RIGHT, spi_rx_frame);
+        spi_step = SPI_IDLE;
+        return;
+    default:
+        return;
+    }
+
+    if (HAL_SPI_TransmitReceive_DMA(&hspi1, reinterpret_cast<uint8_t*>(&spi_tx_frame),
+                                    reinterpret_cast<uint8_t*>(&spi_rx_frame), 1) != HAL_OK) {
+        spi_error_callback();
+    }
+}
+
+void spi_error_callback() {
+    as5047_left.deselect();
+    as5047_right.deselect();
+    spi_step = SPI_IDLE;
+}
 
 void reset_velocities() {
     linear_velocity_m_s = 0;
@@ -85,64 +294,62 @@ void reset_velocities() {
     left_filtered_ang_vel_rad_s = 0;
     last_update_vel_time = 0;
     delta_vel_time = MAX_TIME_WITHOUT_ENCODER_US + 1;
+    left_velocity_ticks = 0;
+    right_velocity_ticks = 0;
+    velocity_filter_alpha = 0.1;
+    filtered_acceleration_m_s2 = 0;
+    left_estimator.reset();
+    right_estimator.reset();
+    left_tracker.reset();
+    right_tracker.reset();
 }
 
 void set_right_ang_vel_rad_s(float speed) {
     right_encoder.ang_vel_rad_s = speed;
-    right_filtered_ang_vel_rad_s = speed * 0.1 + right_filtered_ang_vel_rad_s * 0.9;
+    right_filtered_ang_vel_rad_s =
+        speed * velocity_filter_alpha + right_filtered_ang_vel_rad_s * (1.0f - velocity_filter_alpha);
 }
 
 void set_left_ang_vel_rad_s(float speed) {
     left_encoder.ang_vel_rad_s = speed;
-    left_filtered_ang_vel_rad_s = speed * 0.1 + left_filtered_ang_vel_rad_s * 0.9;
+    left_filtered_ang_vel_rad_s =
+        speed * velocity_filter_alpha + left_filtered_ang_vel_rad_s * (1.0f - velocity_filter_alpha);
 }
 
 void update_velocities() {
-
-    delta_vel_time = bsp::get_tick_us() - last_update_vel_time;
-    last_update_vel_time = bsp::get_tick_us();
-
-    if (left_encoder.last_delta_tick_time == 0 || right_encoder.last_delta_tick_time == 0) {
-        return;
-    }
-
-    uint32_t delta_time_tick_left = bsp::get_tick_us() - left_encoder.last_update_tick_time;
-    uint32_t delta_time_tick_right = bsp::get_tick_us() - right_encoder.last_update_tick_time;
-
-    /* Left wheel */
-    if (delta_time_tick_left > MAX_TIME_WITHOUT_ENCODER_US) {
-        left_encoder.linear_vel_m_s = 0;
-    } else {
-        int32_t ticks = left_encoder.ticks;
-        if (ticks == 0) { // No tick detected in the last delta_vel_time (e.g 1ms)
-            ticks = left_encoder.direction == CW ? -1 : 1;
-        }
-
-        left_encoder.linear_vel_m_s = ((ticks * ENCODER_DIST_MM_PULSE) / (float)delta_vel_time) * MM_PER_US_TO_M_PER_S;
-    }
-
-    /* Right wheel */
-    if (delta_time_tick_right > MAX_TIME_WITHOUT_ENCODER_US) {
-        right_encoder.linear_vel_m_s = 0;
-    } else {
-        int32_t ticks = right_encoder.ticks;
-        if (ticks == 0) { // No tick detected in the last delta_vel_time (e.g 1ms)
-            ticks = right_encoder.direction == CW ? -1 : 1;
-        }
-
-        right_encoder.linear_vel_m_s = ((ticks * ENCODER_DIST_MM_PULSE) / (float)delta_vel_time) * MM_PER_US_TO_M_PER_S;
-    }
-
-    set_left_ang_vel_rad_s(left_encoder.linear_vel_m_s / WHEEL_RADIUS_M);
-    set_right_ang_vel_rad_s(right_encoder.linear_vel_m_s / WHEEL_RADIUS_M);
+    // Called from the main loop or from the fast control interrupt, encoder EXTIs preempt both
+    __disable_irq();
+    int32_t left_ticks = left_velocity_ticks;
+    int32_t right_ticks = right_velocity_ticks;
+    uint32_t left_edge_time = left_encoder.last_update_tick_time;
+    uint32_t right_edge_time = right_encoder.last_update_tick_time;
+    left_velocity_ticks = 0;
+    right_velocity_ticks = 0;
+    __enable_irq();
+
+    uint32_t now = bsp::get_tick_us();
+    delta_vel_time = now - last_update_vel_time;
+    last_update_vel_time = now;
+
+    velocity_filter_alpha = delta_vel_time / (VELOCITY_FILTER_TAU_US + delta_vel_time);
+    float dt = delta_vel_time / 1000000.0f;
+
+    // M/T method, edge count over the time between the last edges of consecutive windows
+    left_encoder.linear_vel_m_s = left_estimator.update(left_ticks, left_edge_time, now) * MM_PER_US_TO_M_PER_S;
+    right_encoder.linear_vel_m_s = right_estimator.update(right_ticks, right_edge_time, now) * MM_PER_US_TO_M_PER_S;
+    left_encoder.ang_vel_rad_s = left_encoder.linear_vel_m_s / WHEEL_RADIUS_M;
+    right_encoder.ang_vel_rad_s = right_encoder.linear_vel_m_s / WHEEL_RADIUS_M;
+    sample_bus::publish(sample_bus::WHEEL_VEL_LEFT, left_edge_time, left_encoder.linear_vel_m_s);
+    sample_bus::publish(sample_bus::WHEEL_VEL_RIGHT, right_edge_time, right_encoder.linear_vel_m_s);
+
+    left_tracker.update(left_encoder.linear_vel_m_s, dt);
+    right_tracker.update(right_encoder.linear_vel_m_s, dt);
+    left_filtered_ang_vel_rad_s = left_tracker.get_value() / WHEEL_RADIUS_M;
+    right_filtered_ang_vel_rad_s = right_tracker.get_value() / WHEEL_RADIUS_M;
 
     linear_velocity_m_s = (left_encoder.linear_vel_m_s + right_encoder.linear_vel_m_s) / 2.0;
-
-    // Butterworth filter - https://www.meme.net.au/butterworth.html
-    // filtered_velocity_m_s = (0.112157918)*(linear_velocity_m_s + last_velocity_m_s) +
-    // (0.775684163)*(filtered_velocity_m_s); // Low pass 40hz filtered_velocity_m_s =
-    // (0.072960747)*(linear_velocity_m_s + last_velocity_m_s) + (0.854078506)*(filtered_velocity_m_s); // Low pass 25hz
-    filtered_velocity_m_s = linear_velocity_m_s * 0.1 + filtered_velocity_m_s * 0.9;
+    filtered_velocity_m_s = (left_tracker.get_value() + right_tracker.get_value()) / 2.0;
+    filtered_acceleration_m_s2 = (left_tracker.get_rate() + right_tracker.get_rate()) / 2.0;
     last_velocity_m_s = linear_velocity_m_s;
 }
 
@@ -154,6 +361,10 @@ float get_filtered_velocity_m_s() {
     return filtered_velocity_m_s;
 }
 
+float get_filtered_acceleration_m_s2() {
+    return filtered_acceleration_m_s2;
+}
+
 float get_right_filtered_ang_vel_rad_s() {
     return right_filtered_ang_vel_rad_s;
 }
@@ -163,7 +374,21 @@ float get_left_filtered_ang_vel_rad_s() {
 }
 
 float get_encoder_dist_mm_pulse() {
-    return ENCODER_DIST_MM_PULSE;
+    return dist_mm_per_tick;
+}
+
 }
 
+/// @section HAL callbacks
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi) {
+    if (hspi->Instance == SPI1) {
+        bsp::encoders::spi_transfer_complete_callback();
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi) {
+    if (hspi->Instance == SPI1) {
+        bsp::encoders::spi_error_callback();
+    }
 }
@@ -1,13 +1,16 @@
 #include <lsm6dsr.h>
 #include <motion_gc.h>
+#include <cmath>
 #include <cstdio>
 
 #include "st/hal.h"
 
+#include "algorithms/gyro_bias_estimator.hpp"
 #include "bsp/imu.hpp"
 #include "bsp/timers.hpp"
 #include "pin_mapping.h"
 #include "utils/math.hpp"
+#include "utils/sample_bus.hpp"
 
 namespace bsp::imu {
 
@@ -18,6 +21,19 @@ namespace bsp::imu {
 #define SAMPLE_FREQ_HZ 1000
 #define I2C_TIMEOUT 1000
 
+// Temperature, gyro and accelerometer outputs are contiguous, OUT_TEMP_L to OUTZ_H_A
+#define SAMPLE_SIZE_BYTES 14
+#define TEMPERATURE_LSB_PER_C 256.0f
+#define TEMPERATURE_OFFSET_C 25.0f
+#define SAMPLE_READ_TIMEOUT_US 3000
+#define BUS_IDLE_TIMEOUT_US 2000
+
+// Empiric, the robot is still after half a second inside these limits
+#define BIAS_SETTLE_TIME_S 0.5f
+#define BIAS_TAU_S 2.0f
+#define BIAS_GYRO_THRESHOLD_DPS 1.0f
+#define BIAS_ACC_THRESHOLD_G 0.05f
+
 /// @section Private variables
 // If OUTPUT_DATA_RATE_HZ > 415, motion gc will not work. bias is not updated
 static bool enable_motion_gc = false;
@@ -50,8 +66,23 @@ static float incremental_φ;
 // Vertical acceleration in m/s²
 static float a_z;
 
+// IMU die temperature in °C
+static float temperature_c;
+
+static algorithm::GyroBiasEstimator bias_estimator(BIAS_SETTLE_TIME_S, BIAS_TAU_S, BIAS_GYRO_THRESHOLD_DPS,
+                                                   BIAS_ACC_THRESHOLD_G);
+static bool enable_bias_estimator = false;
+static bool wheels_still = false;
+
 static float sample_frequency = SAMPLE_FREQ_HZ;
 
+// Burst read of the latest sample, written by DMA and only touched here when no read is in progress
+static uint8_t raw_sample[SAMPLE_SIZE_BYTES];
+static volatile bool read_in_progress = false;
+static volatile bool sample_ready = false;
+static volatile uint32_t read_start_time_us;
+static uint32_t sample_time_us;
+
 /// @section Private functions
 
 void init_motion_gc() {
@@ -77,10 +108,10 @@ void init_motion_gc() {
 }
 
 static uint32_t last_time_imu = 0;
-/// @brief Get time passed since last time this function was called, in seconds
-/// @return delta time since last call in seconds
-float Δt() {
-    uint32_t current_tick = bsp::get_tick_us();
+/// @brief Get time passed since the previous sample, in seconds
+/// @param current_tick Timestamp of the new sample in us
+/// @return delta time since the previous sample in seconds
+float Δt(uint32_t current_tick) {
 
     // If we just started or reset the angle, Δt will be 0
     if (last_time_imu == 0) {
@@ -95,6 +126,123 @@ float Δt() {
     return delta_time_s;
 }
 
+/// @brief Waits for the background read so blocking register accesses find the bus free
+static void wait_bus_idle() {
+    uint32_t start = bsp::get_tick_us();
+    while (read_in_progress && (bsp::get_tick_us() - start) < BUS_IDLE_TIMEOUT_US) {}
+}
+
+void sample_read_complete_callback() {
+    // The sample was latched by the IMU while the read started
+    sample_time_us = read_start_time_us;
+    sample_ready = true;
+    read_in_progress = false;
+}
+
+void sample_read_error_callback() {
+    read_in_progress = false;
+}
+
+static void start_sample_read() {
+    read_start_time_us = bsp::get_tick_us();
+    read_in_progress = true;
+
+    if (HAL_I2C_Mem_Read_DMA(&hi2c2, LSM6DSR_I2C_ADDR, LSM6DSR_OUT_TEMP_L, I2C_MEMADD_SIZE_8BIT, raw_sample,
+                             SAMPLE_SIZE_BYTES) != HAL_OK) {
+        read_in_progress = false;
+    }
+}
+
+/// @brief Recovers from a read that never completed, without blocking on the bus
+static void restart_bus() {
+    HAL_I2C_DeInit(&hi2c2);
+    MX_I2C2_Init();
+    read_in_progress = false;
+}
+
+static int16_t raw_word(uint8_t index) {
+    return (int16_t)((raw_sample[2 * index + 1] << 8) | raw_sample[2 * index]);
+}
+
+/// @brief Integrates the sample left in the DMA buffer
+static void process_sample() {
+    // Angular Velocity in milidegrees per second
+    LSM6DSR_Axes_t mω = {
+        .x = (int32_t)(raw_word(1) * LSM6DSR_GYRO_SENSITIVITY_FS_4000DPS),
+        .y = (int32_t)(raw_word(2) * LSM6DSR_GYRO_SENSITIVITY_FS_4000DPS),
+        .z = (int32_t)(raw_word(3) * LSM6DSR_GYRO_SENSITIVITY_FS_4000DPS),
+    };
+
+    // Gravity acceleration in mm/s²
+    LSM6DSR_Axes_t mg = {
+        .x = (int32_t)(raw_word(4) * LSM6DSR_ACC_SENSITIVITY_FS_2G),
+        .y = (int32_t)(raw_word(5) * LSM6DSR_ACC_SENSITIVITY_FS_2G),
+        .z = (int32_t)(raw_word(6) * LSM6DSR_ACC_SENSITIVITY_FS_2G),
+    };
+
+    temperature_c = TEMPERATURE_OFFSET_C + raw_word(0) / TEMPERATURE_LSB_PER_C;
+
+    MGC_input_t data_in_gc;
+    MGC_output_t data_out_gc;
+    int bias_update;
+
+    float δt = Δt(sample_time_us);
+
+    ω = deg2rad(mω.z / 1000.0f);
+    a_z = mg.z / 1000.0f;
+
+    if (enable_motion_gc) {
+        if (δt > 0.000001) {
+            float new_frequency = 1.0f / δt;
+            MotionGC_SetFrequency(&new_frequency);
+        }
+
+        data_in_gc.Acc[0] = (mg.x / 1000.0f);
+        data_in_gc.Acc[1] = (mg.y / 1000.0f);
+        data_in_gc.Acc[2] = (mg.z / 1000.0f);
+
+        data_in_gc.Gyro[0] = mω.x / 1000.0f;
+        data_in_gc.Gyro[1] = mω.y / 1000.0f;
+        data_in_gc.Gyro[2] = mω.z / 1000.0f;
+        MotionGC_Update(&data_in_gc, &data_out_gc, &bias_update);
+
+        ω = deg2rad(data_in_gc.Gyro[2] - data_out_gc.GyroBiasZ);
+    } else if (enable_bias_estimator) {
+        float acc_norm_g = std::sqrt(mg.x * mg.x + mg.y * mg.y + mg.z * mg.z) / 1000.0f;
+        float gyro_dps = mω.z / 1000.0f;
+        ω = deg2rad(gyro_dps - bias_estimator.update(gyro_dps, acc_norm_g, temperature_c, wheels_still, δt));
+    } else {
+        ω = deg2rad((mω.z / 1000.0f) - get_g_bias_z());
+    }
+
+    if (δt > 0.000001) {
+        α = (ω - last_ω) / δt;
+    }
+
+    last_ω = ω;
+
+    φ += ω * δt;
+    incremental_φ += ω * δt;
+
+    sample_bus::publish(sample_bus::GYRO_Z, sample_time_us, ω);
+    sample_bus::publish(sample_bus::HEADING, sample_time_us, incremental_φ);
+
+    // Return to first revolution
+    while (φ > M_TWOPI) {
+        φ -= M_TWOPI;
+    }
+
+    while (φ < 0.0f) {
+        φ += M_TWOPI;
+    }
+
+    // Convert from 0-360 to -180-180
+    if (φ > M_PI) {
+        φ -= M_TWOPI;
+    }
+
+}
+
 /// @section Interface implementation
 
 ImuResult init() {
@@ -106,9 +254,11 @@ ImuResult init() {
     lsm6dsr_io.BusType = LSM6DSR_I2C_BUS;
     lsm6dsr_io.GetTick = [] { return (long)bsp::get_tick_ms(); };
     lsm6dsr_io.ReadReg = [](uint16_t addr, uint16_t mem_address, uint8_t* data, uint16_t len) {
+        wait_bus_idle();
         return (long)HAL_I2C_Mem_Read(&hi2c2, addr, mem_address, I2C_MEMADD_SIZE_8BIT, data, len, I2C_TIMEOUT);
     };
     lsm6dsr_io.WriteReg = [](uint16_t addr, uint16_t mem_address, uint8_t* data, uint16_t len) {
+        wait_bus_idle();
         return (long)HAL_I2C_Mem_Write(&hi2c2, addr, mem_address, I2C_MEMADD_SIZE_8BIT, data, len, I2C_TIMEOUT);
     };
 
@@ -158,75 +308,26 @@ ImuResult init() {
 }
 
 ImuResult update() {
-    // Angular Velocity in milidegrees per second
-    LSM6DSR_Axes_t mω;
-
-    // Gravity acceleration in mm/s²
-    LSM6DSR_Axes_t mg = {0, 0, 0};
-
-    MGC_input_t data_in_gc;
-    MGC_output_t data_out_gc;
-    int bias_update;
+    ImuResult result = OK;
 
-    if (enable_motion_gc) {
-        if (LSM6DSR_ACC_GetAxes(&lsm6dsr_ctx, &mg) != LSM6DSR_OK) {
-            return ERROR;
-        }
+    if (read_in_progress && (bsp::get_tick_us() - read_start_time_us) > SAMPLE_READ_TIMEOUT_US) {
+        restart_bus();
+        result = ERROR;
     }
 
-    if (LSM6DSR_GYRO_GetAxes(&lsm6dsr_ctx, &mω) != LSM6DSR_OK) {
-        return ERROR;
+    if (read_in_progress) {
+        return result;
     }
 
-    float δt = Δt();
-
-    ω = deg2rad(mω.z / 1000.0f);
-    a_z = mg.z / 1000.0f;
-
-    if (enable_motion_gc) {
-        if (δt > 0.000001) {
-            float new_frequency = 1.0f / δt;
-            MotionGC_SetFrequency(&new_frequency);
-        }
-
-        data_in_gc.Acc[0] = (mg.x / 1000.0f);
-        data_in_gc.Acc[1] = (mg.y / 1000.0f);
-        data_in_gc.Acc[2] = (mg.z / 1000.0f);
-
-        data_in_gc.Gyro[0] = mω.x / 1000.0f;
-        data_in_gc.Gyro[1] = mω.y / 1000.0f;
-        data_in_gc.Gyro[2] = mω.z / 1000.0f;
-        MotionGC_Update(&data_in_gc, &data_out_gc, &bias_update);
-
-        ω = deg2rad(data_in_gc.Gyro[2] - data_out_gc.GyroBiasZ);
-    } else {
-        ω = deg2rad((mω.z / 1000.0f) - get_g_bias_z());
+    // Only the newest sample is used, the next read starts right after so it is ready on the next cycle
+    if (sample_ready) {
+        sample_ready = false;
+        process_sample();
     }
 
-    if (δt > 0.000001) {
-        α = (ω - last_ω) / δt;
-    }
+    start_sample_read();
 
-    last_ω = ω;
-
-    φ += ω * δt;
-    incremental_φ += ω * δt;
-
-    // Return to first revolution
-    while (φ > M_TWOPI) {
-        φ -= M_TWOPI;
-    }
-
-    while (φ < 0.0f) {
-        φ += M_TWOPI;
-    }
-
-    // Convert from 0-360 to -180-180
-    if (φ > M_PI) {
-        φ -= M_TWOPI;
-    }
-
-    return OK;
+    return result;
 }
 
 float get_angle() {
@@ -241,6 +342,7 @@ void reset_angle() {
     last_time_imu = 0;
     φ = 0;
     incremental_φ = 0;
+    sample_bus::reset(sample_bus::HEADING);
 }
 
 float get_rad_per_s() {
@@ -260,6 +362,7 @@ void set_g_bias_z(float z_gbias) {
     };
 
     MotionGC_SetCalParams(&gyro_bias);
+    bias_estimator.reset(z_gbias);
 }
 
 float get_g_bias_z() {
@@ -270,9 +373,31 @@ float get_g_bias_z() {
     return z_gbias;
 }
 
+float get_estimated_g_bias_z() {
+    return bias_estimator.get_bias(temperature_c);
+}
+
+float get_temperature_c() {
+    return temperature_c;
+}
+
+void enable_bias_estimation(bool enable, float temp_coefficient_dps_c) {
+    enable_bias_estimator = enable;
+    bias_estimator.temp_coefficient_dps_c = temp_coefficient_dps_c;
+}
+
+void set_wheels_still(bool still) {
+    wheels_still = still;
+}
+
 void enable_motion_gc_filter(bool enable) {
     enable_motion_gc = enable;
 
+    // Start the online estimator from the MotionGC result
+    if (!enable) {
+        bias_estimator.reset(get_g_bias_z());
+    }
+
     uint16_t new_data_rate = enable ? motion_gc_data_rate : output_data_rate;
 
     if (LSM6DSR_ACC_SetOutputDataRate(&lsm6dsr_ctx, new_data_rate) != LSM6DSR_OK) {
@@ -284,6 +409,10 @@ void enable_motion_gc_filter(bool enable) {
     }
 }
 
+uint32_t get_sample_time_us() {
+    return sample_time_us;
+}
+
 bool is_imu_emergency() {
     // bool emergency_z_angular_accel = std::abs(α) > 6000.0f;
 
@@ -292,3 +421,17 @@ bool is_imu_emergency() {
 }
 
 } // namespace
+
+/// @section HAL callbacks
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef* hi2c) {
+    if (hi2c->Instance == I2C2) {
+        bsp::imu::sample_read_complete_callback();
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) {
+    if (hi2c->Instance == I2C2) {
+        bsp::imu::sample_read_error_callback();
+    }
+}
@@ -32,6 +32,12 @@ extern DMA_HandleTypeDef hdma_tim2_ch1;
 
 extern DMA_HandleTypeDef hdma_usart1_rx;
 
+extern DMA_HandleTypeDef hdma_i2c2_rx;
+
+extern DMA_HandleTypeDef hdma_spi1_rx;
+
+extern DMA_HandleTypeDef hdma_spi1_tx;
+
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN TD */
 
@@ -376,6 +382,29 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c) {
 
         /* Peripheral clock enable */
         __HAL_RCC_I2C2_CLK_ENABLE();
+
+        /* I2C2 DMA Init */
+        /* I2C2_RX Init */
+        hdma_i2c2_rx.Instance = DMA1_Channel7;
+        hdma_i2c2_rx.Init.Request = DMA_REQUEST_I2C2_RX;
+        hdma_i2c2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_i2c2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_i2c2_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_i2c2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_i2c2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_i2c2_rx.Init.Mode = DMA_NORMAL;
+        hdma_i2c2_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        if (HAL_DMA_Init(&hdma_i2c2_rx) != HAL_OK) {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(hi2c, hdmarx, hdma_i2c2_rx);
+
+        /* I2C2 interrupt Init */
+        HAL_NVIC_SetPriority(I2C2_EV_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C2_ER_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(I2C2_ER_IRQn);
         /* USER CODE BEGIN I2C2_MspInit 1 */
 
         /* USER CODE END I2C2_MspInit 1 */
@@ -406,6 +435,11 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c) {
 
         /* Peripheral clock enable */
         __HAL_RCC_I2C3_CLK_ENABLE();
+        /* I2C3 interrupt Init */
+        HAL_NVIC_SetPriority(I2C3_EV_IRQn, 6, 0);
+        HAL_NVIC_EnableIRQ(I2C3_EV_IRQn);
+        HAL_NVIC_SetPriority(I2C3_ER_IRQn, 6, 0);
+        HAL_NVIC_EnableIRQ(I2C3_ER_IRQn);
         /* USER CODE BEGIN I2C3_MspInit 1 */
 
         /* USER CODE END I2C3_MspInit 1 */
@@ -434,6 +468,12 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c) {
 
         HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9);
 
+        /* I2C2 DMA DeInit */
+        HAL_DMA_DeInit(hi2c->hdmarx);
+
+        /* I2C2 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(I2C2_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C2_ER_IRQn);
         /* USER CODE BEGIN I2C2_MspDeInit 1 */
 
         /* USER CODE END I2C2_MspDeInit 1 */
@@ -452,6 +492,9 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c) {
 
         HAL_GPIO_DeInit(GPIOC, GPIO_PIN_9);
 
+        /* I2C3 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(I2C3_EV_IRQn);
+        HAL_NVIC_DisableIRQ(I2C3_ER_IRQn);
         /* USER CODE BEGIN I2C3_MspDeInit 1 */
 
         /* USER CODE END I2C3_MspDeInit 1 */
@@ -482,10 +525,47 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* hspi) {
         GPIO_InitStruct.Pin = GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7;
         GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
         GPIO_InitStruct.Pull = GPIO_NOPULL;
-        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_MEDIUM;
         GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
         HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+        /* SPI1 DMA Init */
+        /* SPI1_RX Init */
+        hdma_spi1_rx.Instance = DMA1_Channel5;
+        hdma_spi1_rx.Init.Request = DMA_REQUEST_SPI1_RX;
+        hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+        hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+        hdma_spi1_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK) {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(hspi, hdmarx, hdma_spi1_rx);
+
+        /* SPI1_TX Init */
+        hdma_spi1_tx.Instance = DMA1_Channel6;
+        hdma_spi1_tx.Init.Request = DMA_REQUEST_SPI1_TX;
+        hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+        hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+        hdma_spi1_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK) {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(hspi, hdmatx, hdma_spi1_tx);
+
+        /* SPI1 interrupt Init */
+        HAL_NVIC_SetPriority(SPI1_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(SPI1_IRQn);
+
         /* USER CODE BEGIN SPI1_MspInit 1 */
 
         /* USER CODE END SPI1_MspInit 1 */
@@ -513,6 +593,12 @@ void HAL_SPI_MspDeInit(SPI_HandleTypeDef* hspi) {
         */
         HAL_GPIO_DeInit(GPIOA, GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7);
 
+        /* SPI1 DMA DeInit */
+        HAL_DMA_DeInit(hspi->hdmarx);
+        HAL_DMA_DeInit(hspi->hdmatx);
+
+        /* SPI1 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(SPI1_IRQn);
         /* USER CODE BEGIN SPI1_MspDeInit 1 */
 
         /* USER CODE END SPI1_MspDeInit 1 */
@@ -578,6 +664,8 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base) {
         /* Peripheral clock enable */
         __HAL_RCC_TIM5_CLK_ENABLE();
         /* USER CODE BEGIN TIM5_MspInit 1 */
+        HAL_NVIC_SetPriority(TIM5_IRQn, 4, 0);
+        HAL_NVIC_EnableIRQ(TIM5_IRQn);
 
         /* USER CODE END TIM5_MspInit 1 */
     } else if (htim_base->Instance == TIM8) {
@@ -716,6 +804,7 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base) {
         /* Peripheral clock disable */
         __HAL_RCC_TIM5_CLK_DISABLE();
         /* USER CODE BEGIN TIM5_MspDeInit 1 */
+        HAL_NVIC_DisableIRQ(TIM5_IRQn);
 
         /* USER CODE END TIM5_MspDeInit 1 */
     } else if (htim_base->Instance == TIM8) {
@@ -62,7 +62,14 @@ extern ADC_HandleTypeDef hadc1;
 extern ADC_HandleTypeDef hadc2;
 extern DMA_HandleTypeDef hdma_tim2_ch1;
 extern DMA_HandleTypeDef hdma_usart1_rx;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_spi1_tx;
+extern DMA_HandleTypeDef hdma_i2c2_rx;
+extern I2C_HandleTypeDef hi2c2;
+extern I2C_HandleTypeDef hi2c3;
+extern SPI_HandleTypeDef hspi1;
 extern UART_HandleTypeDef huart1;
+extern TIM_HandleTypeDef htim5;
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -242,6 +249,45 @@ void DMA1_Channel4_IRQHandler(void) {
     /* USER CODE END DMA1_Channel4_IRQn 1 */
 }
 
+/**
+ * @brief This function handles DMA1 channel5 global interrupt.
+ */
+void DMA1_Channel5_IRQHandler(void) {
+    /* USER CODE BEGIN DMA1_Channel5_IRQn 0 */
+
+    /* USER CODE END DMA1_Channel5_IRQn 0 */
+    HAL_DMA_IRQHandler(&hdma_spi1_rx);
+    /* USER CODE BEGIN DMA1_Channel5_IRQn 1 */
+
+    /* USER CODE END DMA1_Channel5_IRQn 1 */
+}
+
+/**
+ * @brief This function handles DMA1 channel6 global interrupt.
+ */
+void DMA1_Channel6_IRQHandler(void) {
+    /* USER CODE BEGIN DMA1_Channel6_IRQn 0 */
+
+    /* USER CODE END DMA1_Channel6_IRQn 0 */
+    HAL_DMA_IRQHandler(&hdma_spi1_tx);
+    /* USER CODE BEGIN DMA1_Channel6_IRQn 1 */
+
+    /* USER CODE END DMA1_Channel6_IRQn 1 */
+}
+
+/**
+ * @brief This function handles DMA1 channel7 global interrupt.
+ */
+void DMA1_Channel7_IRQHandler(void) {
+    /* USER CODE BEGIN DMA1_Channel7_IRQn 0 */
+
+    /* USER CODE END DMA1_Channel7_IRQn 0 */
+    HAL_DMA_IRQHandler(&hdma_i2c2_rx);
+    /* USER CODE BEGIN DMA1_Channel7_IRQn 1 */
+
+    /* USER CODE END DMA1_Channel7_IRQn 1 */
+}
+
 /**
  * @brief This function handles ADC1 and ADC2 global interrupt.
  */
@@ -309,6 +355,84 @@ void EXTI15_10_IRQHandler(void) {
     /* USER CODE END EXTI15_10_IRQn 1 */
 }
 
+/**
+ * @brief This function handles I2C2 event interrupt / I2C2 wake-up interrupt through EXTI line 24.
+ */
+void I2C2_EV_IRQHandler(void) {
+    /* USER CODE BEGIN I2C2_EV_IRQn 0 */
+
+    /* USER CODE END I2C2_EV_IRQn 0 */
+    HAL_I2C_EV_IRQHandler(&hi2c2);
+    /* USER CODE BEGIN I2C2_EV_IRQn 1 */
+
+    /* USER CODE END I2C2_EV_IRQn 1 */
+}
+
+/**
+ * @brief This function handles I2C2 error interrupt.
+ */
+void I2C2_ER_IRQHandler(void) {
+    /* USER CODE BEGIN I2C2_ER_IRQn 0 */
+
+    /* USER CODE END I2C2_ER_IRQn 0 */
+    HAL_I2C_ER_IRQHandler(&hi2c2);
+    /* USER CODE BEGIN I2C2_ER_IRQn 1 */
+
+    /* USER CODE END I2C2_ER_IRQn 1 */
+}
+
+/**
+ * @brief This function handles SPI1 global interrupt.
+ */
+void SPI1_IRQHandler(void) {
+    /* USER CODE BEGIN SPI1_IRQn 0 */
+
+    /* USER CODE END SPI1_IRQn 0 */
+    HAL_SPI_IRQHandler(&hspi1);
+    /* USER CODE BEGIN SPI1_IRQn 1 */
+
+    /* USER CODE END SPI1_IRQn 1 */
+}
+
+/**
+ * @brief This function handles TIM5 global interrupt.
+ */
+void TIM5_IRQHandler(void) {
+    /* USER CODE BEGIN TIM5_IRQn 0 */
+
+    /* USER CODE END TIM5_IRQn 0 */
+    HAL_TIM_IRQHandler(&htim5);
+    /* USER CODE BEGIN TIM5_IRQn 1 */
+
+    /* USER CODE END TIM5_IRQn 1 */
+}
+
+/**
+ * @brief This function handles I2C3 event interrupt / I2C3 wake-up interrupt through EXTI line 27.
+ */
+void I2C3_EV_IRQHandler(void) {
+    /* USER CODE BEGIN I2C3_EV_IRQn 0 */
+
+    /* USER CODE END I2C3_EV_IRQn 0 */
+    HAL_I2C_EV_IRQHandler(&hi2c3);
+    /* USER CODE BEGIN I2C3_EV_IRQn 1 */
+
+    /* USER CODE END I2C3_EV_IRQn 1 */
+}
+
+/**
+ * @brief This function handles I2C3 error interrupt.
+ */
+void I2C3_ER_IRQHandler(void) {
+    /* USER CODE BEGIN I2C3_ER_IRQn 0 */
+
+    /* USER CODE END I2C3_ER_IRQn 0 */
+    HAL_I2C_ER_IRQHandler(&hi2c3);
+    /* USER CODE BEGIN I2C3_ER_IRQn 1 */
+
+    /* USER CODE END I2C3_ER_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
@@ -301,12 +301,13 @@ static int8_t CDC_TransmitCplt_FS(uint8_t* Buf, uint32_t* Len, uint8_t epnum) {
     UNUSED(Buf);
     UNUSED(Len);
     UNUSED(epnum);
+    CDC_TransmitCplt_Callback();
     /* USER CODE END 13 */
     return result;
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
-
+__weak void CDC_TransmitCplt_Callback(void) {}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
@@ -4,6 +4,21 @@
 
 namespace bsp {
 
+/// @section Private variables
+
+static uint32_t periodic_period_us;
+static timers::timer_callback_t periodic_callback;
+
+/// @section Private functions
+
+// Not HAL_TIM_OC_Stop_IT, it also clears CEN once no channel is left on and TIM5 is the microsecond timebase
+static void stop_compare_interrupt(void) {
+    __HAL_TIM_DISABLE_IT(&htim5, TIM_IT_CC1);
+    TIM_CCxChannelCmd(htim5.Instance, TIM_CHANNEL_1, TIM_CCx_DISABLE);
+    __HAL_TIM_CLEAR_IT(&htim5, TIM_IT_CC1);
+    TIM_CHANNEL_STATE_SET(&htim5, TIM_CHANNEL_1, HAL_TIM_CHANNEL_STATE_READY);
+}
+
 /// @section Interface implementation
 
 void timers::init(void) {
@@ -11,6 +26,27 @@ void timers::init(void) {
     HAL_TIM_Base_Start(&htim5);
 }
 
+void timers::start_periodic(uint32_t period_us, timer_callback_t callback) {
+    stop_compare_interrupt();
+
+    periodic_period_us = period_us;
+    periodic_callback = callback;
+
+    TIM_OC_InitTypeDef sConfigOC = {0};
+    sConfigOC.OCMode = TIM_OCMODE_TIMING;
+    sConfigOC.Pulse = __HAL_TIM_GET_COUNTER(&htim5) + period_us;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    HAL_TIM_OC_ConfigChannel(&htim5, &sConfigOC, TIM_CHANNEL_1);
+
+    HAL_TIM_OC_Start_IT(&htim5, TIM_CHANNEL_1);
+}
+
+void timers::stop_periodic(void) {
+    stop_compare_interrupt();
+    periodic_callback = NULL;
+}
+
 uint32_t get_tick_ms(void) {
     return HAL_GetTick();
 }
@@ -37,3 +73,17 @@ void delay_us(uint32_t us) {
 }
 
 } // namespace bsp
+
+/// @section HAL callbacks
+
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef* htim) {
+    if (htim->Instance == TIM5 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1) {
+        // Free running counter, next compare is relative to the last one so the period does not drift
+        __HAL_TIM_SET_COMPARE(&htim5, TIM_CHANNEL_1,
+                              __HAL_TIM_GET_COMPARE(&htim5, TIM_CHANNEL_1) + bsp::periodic_period_us);
+
+        if (bsp::periodic_callback != NULL) {
+            bsp::periodic_callback();
+        }
+    }
+}
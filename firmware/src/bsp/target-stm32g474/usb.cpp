@@ -1,13 +1,123 @@
+#include <algorithm>
+#include <cstring>
+
 #include "st/hal.h"
+#include "usbd_cdc_if.h"
 
+#include "bsp/timers.hpp"
 #include "bsp/usb.hpp"
 
 namespace bsp::usb {
 
+/// @section Constants
+
+static constexpr uint16_t TX_BUFFER_SIZE = 1024;
+
+/// @section Private variables
+
+static uint8_t tx_buffers[2][TX_BUFFER_SIZE];
+static volatile uint16_t tx_fill_len[2];
+static volatile uint8_t fill_idx = 0;
+static volatile bool tx_busy = false;
+static uint32_t dropped_bytes = 0;
+
+/// @section Private functions
+
+// Must run with interrupts masked or from the USB interrupt itself
+static void start_next_transfer() {
+    if (tx_busy || tx_fill_len[fill_idx] == 0) {
+        return;
+    }
+
+    uint8_t send_idx = fill_idx;
+    if (CDC_Transmit_FS(tx_buffers[send_idx], tx_fill_len[send_idx]) != USBD_OK) {
+        // Endpoint taken by a printf transfer, its completion will retry
+        return;
+    }
+
+    tx_busy = true;
+    fill_idx = send_idx ^ 1;
+    tx_fill_len[fill_idx] = 0;
+}
+
+static bool try_append(const uint8_t* data, uint16_t len) {
+    __disable_irq();
+    uint16_t used = tx_fill_len[fill_idx];
+    bool fits = used + len <= TX_BUFFER_SIZE;
+    if (fits) {
+        std::memcpy(&tx_buffers[fill_idx][used], data, len);
+        tx_fill_len[fill_idx] = used + len;
+        start_next_transfer();
+    }
+    __enable_irq();
+
+    return fits;
+}
+
 /// @section Interface implementation
 
 void init(void) {
+    tx_fill_len[0] = 0;
+    tx_fill_len[1] = 0;
+    fill_idx = 0;
+    tx_busy = false;
+    dropped_bytes = 0;
+
     MX_USB_Device_Init();
 }
 
+bool is_connected(void) {
+    return hUsbDeviceFS.dev_state == USBD_STATE_CONFIGURED && hUsbDeviceFS.pClassData != nullptr;
+}
+
+bool write(const uint8_t* data, uint16_t len) {
+    if (!is_connected()) {
+        return false;
+    }
+
+    if (!try_append(data, len)) {
+        dropped_bytes += len;
+        return false;
+    }
+
+    return true;
+}
+
+bool write_blocking(const uint8_t* data, uint32_t len, uint32_t timeout_ms) {
+    static constexpr uint16_t CHUNK_SIZE = TX_BUFFER_SIZE / 2;
+
+    uint32_t last_progress_ms = bsp::get_tick_ms();
+    while (len > 0) {
+        if (!is_connected()) {
+            return false;
+        }
+
+        uint16_t chunk = std::min<uint32_t>(len, CHUNK_SIZE);
+        if (try_append(data, chunk)) {
+            data += chunk;
+            len -= chunk;
+            last_progress_ms = bsp::get_tick_ms();
+        } else if (bsp::get_tick_ms() - last_progress_ms > timeout_ms) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t get_dropped_bytes(void) {
+    return dropped_bytes;
+}
+
+void transmit_complete() {
+    tx_busy = false;
+    start_next_transfer();
+}
+
 } // namespace
+
+/// @section HAL callbacks
+
+extern "C" void CDC_TransmitCplt_Callback(void) {
+    bsp::usb::transmit_complete();
+}
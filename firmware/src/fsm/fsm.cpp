@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <map>
 #include <variant>
 
@@ -5,11 +6,39 @@
 #include "bsp/buttons.hpp"
 #include "fsm/fsm.hpp"
 #include "services/config.hpp"
+#include "services/logger.hpp"
 #include "services/navigation.hpp"
 #include "utils/soft_timer.hpp"
 
 namespace fsm {
 
+/// @brief Index of the state in the EVENT_STATE log events, matches scripts/decode_telemetry.py
+static uint8_t state_index(State* state) {
+    State* const states[] = {
+        &State::get<Idle>(),
+        &State::get<PreSearch>(),
+        &State::get<SearchWaitStart>(),
+        &State::get<SearchParamSelect>(),
+        &State::get<SearchExploreModeSelect>(),
+        &State::get<Search>(),
+        &State::get<PreRun>(),
+        &State::get<RunWaitStart>(),
+        &State::get<Run>(),
+        &State::get<RunParamSelect>(),
+        &State::get<RunMoveModeSelect>(),
+        &State::get<RunMapSelect>(),
+        &State::get<PreCalib>(),
+        &State::get<CalibrationModeSelect>(),
+        &State::get<CalibrationIRSensors>(),
+        &State::get<CalibrationIMU>(),
+        &State::get<CalibrationFan>(),
+        &State::get<CalibrationMotors>(),
+    };
+
+    auto it = std::find(std::begin(states), std::end(states), state);
+    return static_cast<uint8_t>(it - std::begin(states));
+}
+
 FSM::FSM() {
     current_state = &State::get<Idle>();
 
@@ -40,19 +69,19 @@ void FSM::start() {
             return;
         }
 
-        if (packet[1] == bsp::ble::BlePacketType::UpdateParameters && !bsp::ble::is_config_locked()) {
-            services::Config::parse_packet(packet);
-            dispatch(BleCommand());
-        }
-
-        if (packet[1] == bsp::ble::BlePacketType::UpdateMovementParameters && !bsp::ble::is_config_locked()) {
-            services::Config::parse_movement_packet(packet);
-            dispatch(BleCommand());
+        bool config_packet = packet[1] == bsp::ble::BlePacketType::UpdateParameters ||
+                             packet[1] == bsp::ble::BlePacketType::UpdateMovementParameters ||
+                             packet[1] == bsp::ble::BlePacketType::UpdateMoveSequence;
+        if (config_packet && !bsp::ble::is_config_locked()) {
+            ConfigPacket copy;
+            std::copy(packet, packet + bsp::ble::receive_packet_size, copy.data);
+            config_packets.put(copy);
+            return;
         }
 
-        if (packet[1] == bsp::ble::BlePacketType::UpdateMoveSequence && !bsp::ble::is_config_locked()) {
-            services::Config::parse_move_sequence_packet(packet);
-            dispatch(BleCommand());
+        if (packet[1] == bsp::ble::BlePacketType::Command && packet[2] == bsp::ble::BleCommands::LogTrigger) {
+            services::Logger::instance()->trigger();
+            return;
         }
 
         if (packet[1] == bsp::ble::BlePacketType::Command) {
@@ -77,6 +106,11 @@ void FSM::start() {
 }
 
 void FSM::spin() {
+    ConfigPacket config_packet;
+    while (config_packets.get(&config_packet)) {
+        handle_config_packet(config_packet.data);
+    }
+
     Event event;
     if (!event_queue.get(&event)) {
         return;
@@ -88,6 +122,7 @@ void FSM::spin() {
         current_state->exit();
         current_state = state;
         current_state->enter();
+        services::Logger::instance()->log_event(services::Logger::EVENT_STATE, state_index(current_state));
     }
 }
 
@@ -95,4 +130,22 @@ void FSM::dispatch(Event const& event) {
     event_queue.put(event);
 }
 
+void FSM::handle_config_packet(uint8_t packet[bsp::ble::receive_packet_size]) {
+    switch (packet[1]) {
+    case bsp::ble::BlePacketType::UpdateParameters:
+        services::Config::parse_packet(packet);
+        break;
+    case bsp::ble::BlePacketType::UpdateMovementParameters:
+        services::Config::parse_movement_packet(packet);
+        break;
+    case bsp::ble::BlePacketType::UpdateMoveSequence:
+        services::Config::parse_move_sequence_packet(packet);
+        break;
+    default:
+        return;
+    }
+
+    dispatch(BleCommand());
+}
+
 }
@@ -125,10 +125,47 @@ void CalibrationIRSensors::enter() {
     bsp::delay_ms(2000);
     bsp::buzzer::stop();
 
+    lut_step = 0;
+    std::printf("IR LUT: place the walls at %.0f mm and press SHORT1\r\n", bsp::analog_sensors::ir_lut_distances_mm[0]);
+
     soft_timer::start(1, soft_timer::CONTINUOUS);
 }
 
-State* CalibrationIRSensors::react(ButtonPressed const&) {
+State* CalibrationIRSensors::react(ButtonPressed const& event) {
+    using bsp::analog_sensors::IR_LUT_POINTS;
+
+    // Any other button leaves without touching the stored LUT
+    if (event.button != ButtonPressed::SHORT1) {
+        return &State::get<PreCalib>();
+    }
+
+    for (int i = 0; i < 4; i++) {
+        lut[i][lut_step] = bsp::analog_sensors::ir_reading(static_cast<bsp::analog_sensors::SensingDirection>(i));
+    }
+
+    std::printf("IR LUT %.0f mm: %d; %d; %d; %d\r\n", bsp::analog_sensors::ir_lut_distances_mm[lut_step],
+                lut[0][lut_step], lut[1][lut_step], lut[2][lut_step], lut[3][lut_step]);
+
+    bsp::buzzer::start();
+    bsp::delay_ms(100);
+    bsp::buzzer::stop();
+
+    lut_step++;
+    if (lut_step < IR_LUT_POINTS) {
+        std::printf("IR LUT: place the walls at %.0f mm and press SHORT1\r\n",
+                    bsp::analog_sensors::ir_lut_distances_mm[lut_step]);
+        return nullptr;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (!bsp::analog_sensors::ir_set_lut(static_cast<bsp::analog_sensors::SensingDirection>(i), lut[i])) {
+            std::printf("IR LUT %d not decreasing, sensor stays uncalibrated\r\n", i);
+        }
+    }
+
+    services::Config::save_ir_lut(lut);
+    std::printf("IR LUT saved\r\n");
+
     return &State::get<PreCalib>();
 }
 
@@ -287,7 +324,10 @@ State* CalibrationMotors::react(ButtonPressed const& event) {
 State* CalibrationMotors::react(Timeout const&) {
     loop_counter++;
 
-    bsp::encoders::update_velocities();
+    // With the fast loop enabled its interrupt already updates the velocities, and the update is not reentrant
+    if (!services::Control::instance()->is_fast_loop_enabled()) {
+        bsp::encoders::update_velocities();
+    }
 
     auto left_encoder = bsp::encoders::get_data(bsp::encoders::EncoderSide::LEFT);
     auto right_encoder = bsp::encoders::get_data(bsp::encoders::EncoderSide::RIGHT);
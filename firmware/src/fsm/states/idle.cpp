@@ -47,7 +47,13 @@ State* Idle::react(ButtonPressed const& event) {
     }
 
     if (event.button == ButtonPressed::LONG1) {
-        services::Logger::instance()->print_log();
+        // Without a capture since power up, send the runs kept in EEPROM instead
+        auto logger = services::Logger::instance();
+        if (logger->has_capture()) {
+            logger->dump_log();
+        } else {
+            logger->dump_stored();
+        }
     }
 
     if (event.button == ButtonPressed::LONG2) {
@@ -55,12 +61,16 @@ State* Idle::react(ButtonPressed const& event) {
         auto maze = services::Maze::instance();
         std::printf("Maze backup: \r\n");
         bsp::delay_ms(5);
-        maze->read_maze_from_memory(true);
+        if (!maze->read_maze_from_memory(true)) {
+            std::printf("No valid maze saved\r\n");
+        }
         maze->print(maze->ORIGIN);
 
         std::printf("Maze: \r\n");
         bsp::delay_ms(5);
-        maze->read_maze_from_memory(false);
+        if (!maze->read_maze_from_memory(false)) {
+            std::printf("No valid maze saved\r\n");
+        }
         maze->print(maze->ORIGIN);
 
         auto target_directions = maze->directions_to_goal();
@@ -330,7 +330,18 @@ void Run::enter() {
     
     soft_timer::start(1, soft_timer::CONTINUOUS);
     
+    logger->set_channels(static_cast<uint32_t>(services::Config::log_channels));
+    logger->set_compression(static_cast<services::Logger::Compression>(services::Config::log_compression));
+    logger->set_trigger({
+        .sources = static_cast<uint8_t>(services::Config::log_trigger),
+        .pre_ms = static_cast<uint16_t>(services::Config::log_pre_ms),
+        .post_ms = static_cast<uint16_t>(services::Config::log_post_ms),
+        .speed_m_s = services::Config::log_trigger_speed,
+        .movement = static_cast<Movement>(services::Config::log_trigger_movement),
+    });
     logger->init();
+    logger->set_streaming(services::Config::log_stream > 0);
+    logger->set_persistence(services::Config::log_persist > 0);
     
     maze->read_maze_from_memory(map_backup);
     maze->print(maze->ORIGIN);
@@ -440,7 +451,7 @@ void Run::exit() {
     bsp::analog_sensors::enable_modulation(false);
     bsp::leds::ir_emitter_all_off();
     bsp::leds::indication_off();
-    logger->save_size();
+    logger->stop();
     bsp::buzzer::stop();
 }
 
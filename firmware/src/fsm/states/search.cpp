@@ -12,7 +12,9 @@
 #include "bsp/motors.hpp"
 #include "bsp/timers.hpp"
 #include "fsm/state.hpp"
+#include "services/config.hpp"
 #include "services/control.hpp"
+#include "services/logger.hpp"
 #include "services/maze.hpp"
 #include "services/navigation.hpp"
 #include "services/notification.hpp"
@@ -29,6 +31,11 @@ static bool indicate_read = false;
 static uint32_t last_indication = 0;
 static bool full_explore = false;
 
+static void log_step(Direction dir, Point const& position) {
+    services::Logger::instance()->log_event(services::Logger::EVENT_MAZE_STEP, static_cast<uint8_t>(dir),
+                                            static_cast<int16_t>(position.x | (position.y << 8)));
+}
+
 void PreSearch::enter() {
 
     bsp::debug::print("state:PreSearch");
@@ -245,6 +252,8 @@ Search::Search() {
     navigation = services::Navigation::instance();
     maze = services::Maze::instance();
     notification = services::Notification::instance();
+    wall_observer = services::WallObserver::instance();
+    logger = services::Logger::instance();
 }
 
 void Search::enter() {
@@ -264,11 +273,24 @@ void Search::enter() {
     soft_timer::start(1, soft_timer::CONTINUOUS);
 
     maze->reset();
+    wall_observer->reset();
     returning = false;
     save_maze = false;
     stop_next_move = false;
     emergency = false;
     target = services::Maze::GOAL_POSITIONS[0];
+
+    // Own capture settings, mainly for the pose and the maze step and flood fill events. Off by default so
+    // the last Run capture stays in RAM, and never started over a capture still being stored
+    logging = services::Config::log_search > 0 && !logger->is_persisting();
+    if (logging) {
+        logger->set_channels(services::Logger::POSE_CHANNELS);
+        logger->set_trigger({});
+        logger->set_compression(services::Logger::COMPRESSION_DELTA);
+        logger->init();
+        logger->set_streaming(false);
+        logger->set_persistence(services::Config::log_persist > 0);
+    }
 }
 
 State* Search::react(BleCommand const&) {
@@ -298,7 +320,6 @@ State* Search::react(ButtonPressed const& event) {
 State* Search::react(Timeout const&) {
     using bsp::analog_sensors::ir_reading_wall;
     using bsp::analog_sensors::SensingDirection;
-    using bsp::analog_sensors::SensingStatus;
 
     if (indicate_read && ((bsp::get_tick_ms() - last_indication) > 100)) {
         bsp::leds::stripe_set(Color::Black);
@@ -308,8 +329,13 @@ State* Search::react(Timeout const&) {
 
     notification->update();
     navigation->update();
+    wall_observer->update(navigation->get_robot_travelled_dist_mm());
     bool done = navigation->step();
 
+    if (logging) {
+        logger->update();
+    }
+
     if (done) {
         if (stop_next_move) {
             return &State::get<Idle>();
@@ -318,8 +344,6 @@ State* Search::react(Timeout const&) {
             // maze->reset();
         }
 
-        SensingStatus sensingStatus = bsp::analog_sensors::ir_get_sensing_status();
-
         last_indication = bsp::get_tick_ms();
         indicate_read = true;
         bsp::leds::stripe_set(Color::Black);
@@ -328,11 +352,11 @@ State* Search::react(Timeout const&) {
         auto robot_cell_pos = navigation->get_robot_cell_position();
         auto robot_dir = navigation->get_robot_direction();
 
-        uint8_t walls =
-            (sensingStatus.front_seeing * N | sensingStatus.right_seeing * E | sensingStatus.left_seeing * W)
-            << robot_dir;
+        auto observation = wall_observer->observe(robot_dir);
+        uint8_t walls = observation.walls;
 
-        auto dir = maze->next_step(robot_cell_pos, walls, target, true);
+        auto dir = maze->next_step(robot_cell_pos, walls, target, true, observation.confidence);
+        log_step(dir, robot_cell_pos);
 
         bool main_goal_reached =
             std::any_of(std::begin(services::Maze::GOAL_POSITIONS), std::end(services::Maze::GOAL_POSITIONS),
@@ -364,7 +388,8 @@ State* Search::react(Timeout const&) {
             }
 
             if (!stop_next_move) {
-                auto dir = maze->next_step(robot_cell_pos, walls, target, true);
+                auto dir = maze->next_step(robot_cell_pos, walls, target, true, observation.confidence);
+                log_step(dir, robot_cell_pos);
                 navigation->set_movement(dir);
             }
         } else {
@@ -396,6 +421,10 @@ void Search::exit() {
     bsp::leds::ir_emitter_all_off();
     bsp::leds::indication_off();
     soft_timer::stop();
+    if (logging) {
+        logger->stop();
+        logging = false;
+    }
     if (save_maze) {
         bsp::buzzer::start();
         maze->save_maze_to_memory(true);
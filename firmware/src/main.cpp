@@ -4,11 +4,15 @@
 #include "bsp/ble.hpp"
 #include "bsp/buzzer.hpp"
 #include "bsp/core.hpp"
+#include "bsp/eeprom.hpp"
+#include "bsp/encoders.hpp"
 #include "bsp/leds.hpp"
 #include "bsp/timers.hpp"
 #include "fsm/fsm.hpp"
 #include "fsm/state.hpp"
+#include "services/battery.hpp"
 #include "services/config.hpp"
+#include "services/logger.hpp"
 #include "bsp/imu.hpp"
 
 void startup() {
@@ -25,10 +29,17 @@ void startup() {
     bsp::buzzer::stop();
     bsp::analog_sensors::start();
     bsp::delay_ms(30);
+    bsp::analog_sensors::current_calibrate_offset();
+    services::Battery::instance()->reset(bsp::analog_sensors::battery_latest_reading_volts());
     services::Config::init();
+    auto encoder_backend = static_cast<bsp::encoders::EncoderBackend>(services::Config::encoder_backend);
+    if (!bsp::encoders::set_backend(encoder_backend)) {
+        std::printf("Encoder backend %d not available\r\n", encoder_backend);
+    }
     bsp::ble::init();
     bsp::ble::start();
     bsp::imu::set_g_bias_z(services::Config::z_imu_bias);
+    bsp::imu::enable_bias_estimation(services::Config::gyro_bias_estimation > 0, services::Config::gyro_bias_temp_coef);
 }
 
 int main() {
@@ -41,7 +52,11 @@ int main() {
 
     fsm.start();
 
+    auto logger = services::Logger::instance();
+
     for (;;) {
         fsm.spin();
+        logger->persist_step();
+        bsp::eeprom::update();
     }
 }
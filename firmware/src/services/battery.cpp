@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "services/battery.hpp"
+#include "utils/math.hpp"
+
+/// @section Constants
+
+// About 2 s of memory at 1 kHz
+static constexpr float FORGETTING_FACTOR = 0.9995;
+
+static constexpr float INITIAL_OCV_COVARIANCE = 0.01;
+static constexpr float INITIAL_RESISTANCE_COVARIANCE = 0.001;
+
+// Forgetting with no current variation makes the covariance grow without bound, it's capped here
+static constexpr float MAX_OCV_COVARIANCE = 0.1;
+static constexpr float MAX_RESISTANCE_COVARIANCE = 0.01;
+
+static constexpr float MIN_RESISTANCE_OHM = 0.02;
+static constexpr float MAX_RESISTANCE_OHM = 1.0;
+
+namespace services {
+
+Battery* Battery::instance() {
+    static Battery b;
+    return &b;
+}
+
+void Battery::reset(float volts) {
+    ocv_volts = volts;
+    resistance_ohm = INITIAL_RESISTANCE_OHM;
+    p_00 = INITIAL_OCV_COVARIANCE;
+    p_01 = 0.0f;
+    p_11 = INITIAL_RESISTANCE_COVARIANCE;
+    initialized = true;
+}
+
+void Battery::update(float volts, float load_current_a) {
+    if (!initialized) {
+        reset(volts + resistance_ohm * load_current_a);
+        return;
+    }
+
+    // Regressor is [1, -I] for the parameters [OCV, R]
+    float phi_1 = -load_current_a;
+    float error = volts - predict_volts(load_current_a);
+
+    float p_phi_0 = p_00 + p_01 * phi_1;
+    float p_phi_1 = p_01 + p_11 * phi_1;
+    float denominator = FORGETTING_FACTOR + p_phi_0 + phi_1 * p_phi_1;
+
+    float gain_0 = p_phi_0 / denominator;
+    float gain_1 = p_phi_1 / denominator;
+
+    ocv_volts += gain_0 * error;
+    resistance_ohm += gain_1 * error;
+    resistance_ohm = constrain(resistance_ohm, MIN_RESISTANCE_OHM, MAX_RESISTANCE_OHM);
+
+    p_00 = (p_00 - gain_0 * p_phi_0) / FORGETTING_FACTOR;
+    p_01 = (p_01 - gain_0 * p_phi_1) / FORGETTING_FACTOR;
+    p_11 = (p_11 - gain_1 * p_phi_1) / FORGETTING_FACTOR;
+
+    // Scale the whole matrix so it stays positive definite
+    float scale = std::min(MAX_OCV_COVARIANCE / p_00, MAX_RESISTANCE_COVARIANCE / p_11);
+    if (scale < 1.0f) {
+        p_00 *= scale;
+        p_01 *= scale;
+        p_11 *= scale;
+    }
+}
+
+float Battery::predict_volts(float load_current_a) const {
+    return ocv_volts - resistance_ohm * load_current_a;
+}
+
+float Battery::max_current_a(float min_volts) const {
+    return std::max((ocv_volts - min_volts) / resistance_ohm, 0.0f);
+}
+
+}
@@ -1,10 +1,13 @@
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <utility>
 
 #include "bsp/eeprom.hpp"
 #include "bsp/timers.hpp"
 #include "services/config.hpp"
 #include "services/navigation.hpp"
+#include "utils/crc.hpp"
 #include "utils/math.hpp"
 #include "utils/movement_params.hpp"
 
@@ -66,7 +69,42 @@ float Config::start_wall_break_mm_left = 65.0;  // 3.0m/s
 float Config::start_wall_break_mm_right = 80.0; // 3.0m/s
 float Config::enable_wall_break_correction = 1.0;
 
-// All params
+float Config::current_loop_enable = 0.0;
+float Config::current_kp = 1.5;
+float Config::current_ki = 0.05;
+
+float Config::dob_enable = 0.0;
+float Config::dob_inertia_k = 0.0012; // [A / (rad/s^2)]
+float Config::dob_cutoff_hz = 20.0;
+
+float Config::control_mode = 0.0; // 0: PID, 1: LQR
+float Config::control_fast_frequency_hz = 1000.0; // Velocity stage rate, fast stage disabled at <= 1000 Hz
+
+// 0: None, 1: Moving average, 2: IIR
+float Config::ir_filter_type_right = 1.0;
+float Config::ir_filter_type_front_left = 1.0;
+float Config::ir_filter_type_front_right = 1.0;
+float Config::ir_filter_type_left = 1.0;
+float Config::ir_linearize = 0.0; // Wall errors in mm from the calibrated IR LUTs
+
+float Config::encoder_backend = 0.0; // 0: ABI interrupts, 1: Timer quadrature, 2: AS5047P SPI
+
+float Config::gyro_bias_estimation = 1.0;
+float Config::gyro_bias_temp_coef = 0.0; // deg/s per °C
+
+float Config::log_stream = 0.0; // 1: Stream log frames over USB during runs
+float Config::log_channels = 32767.0; // Logger::ParamIndex bit mask, 32767: control, 1015935: pose
+float Config::log_compression = 0.0; // 0: Raw records, 1: Delta, 2: Linear prediction
+float Config::log_trigger = 0.0; // Logger::TriggerSource mask, 0: Linear capture until the RAM is full
+float Config::log_pre_ms = 1500.0; // Triggered capture kept before the trigger
+float Config::log_post_ms = 500.0; // Triggered capture kept after the trigger
+float Config::log_trigger_speed = 3.0; // m/s
+float Config::log_trigger_movement = 0.0; // Movement enum value
+float Config::log_persist = 1.0; // Copy each capture to the EEPROM log storage after the run
+float Config::log_search = 0.0; // 1: Search captures the pose and maze events, replacing the last Run capture
+float Config::battery_sag_compensation = 0.0; // 1: PWM computed for the predicted sagged voltage, 0: measured voltage
+
+// All params, by BLE parameter id. The addresses are the legacy layout, only read to migrate it
 static std::pair<float*, bsp::eeprom::param_addresses_t> params[] = {
     {&Config::fan_speed, bsp::eeprom::ADDR_FAN_SPEED},
     {&Config::angular_kp, bsp::eeprom::ADDR_ANGULAR_KP},
@@ -107,6 +145,33 @@ static std::pair<float*, bsp::eeprom::param_addresses_t> params[] = {
     {&Config::linear_jerk_ff_ms, bsp::eeprom::ADDR_LINEAR_JERK_FEED_FORWARD_LIMIT},
     {&Config::angular_jerk_ff_k, bsp::eeprom::ADDR_ANGULAR_JERK_FEED_FORWARD_K},
     {&Config::angular_jerk_ff_ms, bsp::eeprom::ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT},
+    {&Config::current_loop_enable, bsp::eeprom::ADDR_CURRENT_LOOP_ENABLE},
+    {&Config::current_kp, bsp::eeprom::ADDR_CURRENT_KP},
+    {&Config::current_ki, bsp::eeprom::ADDR_CURRENT_KI},
+    {&Config::dob_enable, bsp::eeprom::ADDR_DOB_ENABLE},
+    {&Config::dob_inertia_k, bsp::eeprom::ADDR_DOB_INERTIA_K},
+    {&Config::dob_cutoff_hz, bsp::eeprom::ADDR_DOB_CUTOFF_HZ},
+    {&Config::control_mode, bsp::eeprom::ADDR_CONTROL_MODE},
+    {&Config::control_fast_frequency_hz, bsp::eeprom::ADDR_CONTROL_FAST_FREQUENCY_HZ},
+    {&Config::ir_filter_type_right, bsp::eeprom::ADDR_IR_FILTER_TYPE_RIGHT},
+    {&Config::ir_filter_type_front_left, bsp::eeprom::ADDR_IR_FILTER_TYPE_FRONT_LEFT},
+    {&Config::ir_filter_type_front_right, bsp::eeprom::ADDR_IR_FILTER_TYPE_FRONT_RIGHT},
+    {&Config::ir_filter_type_left, bsp::eeprom::ADDR_IR_FILTER_TYPE_LEFT},
+    {&Config::ir_linearize, bsp::eeprom::ADDR_IR_LINEARIZE},
+    {&Config::encoder_backend, bsp::eeprom::ADDR_ENCODER_BACKEND},
+    {&Config::gyro_bias_estimation, bsp::eeprom::ADDR_GYRO_BIAS_ESTIMATION},
+    {&Config::gyro_bias_temp_coef, bsp::eeprom::ADDR_GYRO_BIAS_TEMP_COEF},
+    {&Config::log_stream, bsp::eeprom::ADDR_LOG_STREAM},
+    {&Config::log_channels, bsp::eeprom::ADDR_LOG_CHANNELS},
+    {&Config::log_compression, bsp::eeprom::ADDR_LOG_COMPRESSION},
+    {&Config::log_trigger, bsp::eeprom::ADDR_LOG_TRIGGER},
+    {&Config::log_pre_ms, bsp::eeprom::ADDR_LOG_PRE_MS},
+    {&Config::log_post_ms, bsp::eeprom::ADDR_LOG_POST_MS},
+    {&Config::log_trigger_speed, bsp::eeprom::ADDR_LOG_TRIGGER_SPEED},
+    {&Config::log_trigger_movement, bsp::eeprom::ADDR_LOG_TRIGGER_MOVEMENT},
+    {&Config::log_persist, bsp::eeprom::ADDR_LOG_PERSIST},
+    {&Config::battery_sag_compensation, bsp::eeprom::ADDR_BATTERY_SAG_COMPENSATION},
+    {&Config::log_search, bsp::eeprom::ADDR_LOG_SEARCH},
 };
 
 static const std::map<Movement, uint16_t> turn_address_map = {
@@ -161,29 +226,288 @@ union _float {
     uint32_t u32;
 };
 
-void Config::init() {
-    if (write_default) {
-        write_default_params();
-        write_all_move_params_to_eeprom();
+// Parameter block at ADDR_CONFIG_BLOCK: this header, the TurnParams of turn_address_map and the ForwardParams
+// of forward_address_map in map order, param_count floats in params[] order, then the CRC32 of it all.
+// New params are appended to params[] and a block with fewer of them keeps their defaults, any other layout
+// change bumps CONFIG_VERSION and needs a migration in load_config_block
+struct ConfigHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t param_count;
+} __attribute__((packed));
+
+static constexpr char CONFIG_MAGIC[4] = {'F', 'J', 'C', 'F'};
+static constexpr uint16_t CONFIG_VERSION = 1;
+
+// RAM copy of the block, the saves write the changed bytes and the CRC from it
+static uint8_t config_image[bsp::eeprom::CONFIG_BLOCK_SIZE];
+
+// Whether the stored block matches config_image apart from the changes being saved
+static bool config_stored = false;
+
+static size_t turn_offset(size_t index) {
+    return sizeof(ConfigHeader) + index * sizeof(TurnParams);
+}
+
+static size_t forward_offset(size_t index) {
+    return turn_offset(turn_address_map.size()) + index * sizeof(ForwardParams);
+}
+
+static size_t param_offset(size_t index) {
+    return forward_offset(forward_address_map.size()) + index * sizeof(float);
+}
+
+static size_t param_index(const float* value) {
+    for (size_t i = 0; i < len(params); i++) {
+        if (params[i].first == value) {
+            return i;
+        }
     }
 
-    for (auto& param : params) {
+    return len(params);
+}
+
+/// @brief Bytes of the whole block, CRC included
+static size_t config_block_size() {
+    return param_offset(len(params)) + sizeof(uint32_t);
+}
+
+/// @brief false, leaving config_image untouched, when the block has outgrown CONFIG_BLOCK_SIZE
+static bool fill_config_image() {
+    if (config_block_size() > sizeof(config_image)) {
+        std::printf("Config: block does not fit in %d bytes, not saved\r\n", (int)sizeof(config_image));
+        return false;
+    }
+
+    ConfigHeader header;
+    std::memcpy(header.magic, CONFIG_MAGIC, sizeof(CONFIG_MAGIC));
+    header.version = CONFIG_VERSION;
+    header.param_count = len(params);
+    std::memcpy(config_image, &header, sizeof(header));
+
+    size_t i = 0;
+    for (const auto& pair : turn_address_map) {
+        std::memcpy(config_image + turn_offset(i++), &turn_params_custom[pair.first], sizeof(TurnParams));
+    }
+
+    i = 0;
+    for (const auto& pair : forward_address_map) {
+        std::memcpy(config_image + forward_offset(i++), &forward_params_custom[pair.first], sizeof(ForwardParams));
+    }
+
+    for (i = 0; i < len(params); i++) {
+        std::memcpy(config_image + param_offset(i), params[i].first, sizeof(float));
+    }
+
+    size_t size = param_offset(len(params));
+    uint32_t crc = crc::crc32(config_image, size);
+    std::memcpy(config_image + size, &crc, sizeof(crc));
+    return true;
+}
+
+static void config_saved(bsp::eeprom::EepromResult result) {
+    if (result != bsp::eeprom::OK) {
+        std::printf("Config: save failed\r\n");
+    }
+}
+
+// Queued so that a save does not stall the main loop, blocking only when the EEPROM queue is full
+static int store_config_bytes(size_t offset, size_t size) {
+    uint16_t address = bsp::eeprom::ADDR_CONFIG_BLOCK + offset;
+    auto result = bsp::eeprom::write_queued(address, config_image + offset, size, config_saved);
+    if (result == bsp::eeprom::BUSY) {
+        result = bsp::eeprom::write_array(address, config_image + offset, size);
+    }
+
+    return result == bsp::eeprom::OK ? 0 : -1;
+}
+
+/// @brief Writes offset..offset + size of the block and its CRC, from the current values
+static int save_config_range(size_t offset, size_t size) {
+    if (!fill_config_image()) {
+        return -1;
+    }
+
+    if (!config_stored) {
+        offset = 0;
+        size = param_offset(len(params));
+    }
+
+    size_t crc_offset = param_offset(len(params));
+    if (store_config_bytes(offset, size) != 0 || store_config_bytes(crc_offset, sizeof(uint32_t)) != 0) {
+        return -1;
+    }
+
+    config_stored = true;
+    return 0;
+}
+
+// The last param of the legacy layout, params added since only exist in the block
+static constexpr uint16_t LEGACY_PARAMS_LAST = bsp::eeprom::ADDR_LOG_PERSIST;
+
+// Every legacy firmware wrote at least the params up to this one on its first boot
+static constexpr uint16_t LEGACY_PARAMS_REQUIRED_LAST = bsp::eeprom::ADDR_ANGULAR_JERK_FEED_FORWARD_LIMIT;
+
+// Larger magnitudes are not a real setting, the largest ones are IR readings and the fan speed
+static constexpr float LEGACY_PARAM_LIMIT = 100000.0f;
+
+static bool plausible(float value) {
+    return std::isfinite(value) && std::abs(value) <= LEGACY_PARAM_LIMIT;
+}
+
+static bool plausible(const TurnParams& stored) {
+    return plausible(stored.start) && plausible(stored.end) && plausible(stored.turn_linear_speed) &&
+           plausible(stored.angular_accel) && plausible(stored.max_angular_speed) && plausible(stored.jerk) &&
+           (stored.sign == 1 || stored.sign == -1);
+}
+
+static bool plausible(const ForwardParams& stored) {
+    return plausible(stored.max_speed) && plausible(stored.acceleration) && plausible(stored.deceleration) &&
+           plausible(stored.target_travel_mm);
+}
+
+static uint32_t legacy_u32(const uint8_t* raw) {
+    return ((uint32_t)raw[0] << 24) | ((uint32_t)raw[1] << 16) | ((uint32_t)raw[2] << 8) | raw[3];
+}
+
+/// @brief Whether the legacy params are there: all the ones every version wrote, and none out of range
+static bool is_legacy_layout(const uint8_t* legacy, uint16_t first) {
+    for (const auto& param : params) {
+        if (param.second > LEGACY_PARAMS_LAST) {
+            continue;
+        }
+
         _float f;
-        if (bsp::eeprom::read_u32(param.second, &f.u32) == bsp::eeprom::OK) {
-            if (f.u32 == 0xFFFFFFFF) {
-                continue;
+        f.u32 = legacy_u32(legacy + (param.second - first));
+        if (f.u32 == 0xFFFFFFFF) {
+            if (param.second <= LEGACY_PARAMS_REQUIRED_LAST) {
+                return false;
             }
+        } else if (!plausible(f.value)) {
+            return false;
+        }
+    }
 
+    return true;
+}
+
+/// @brief Reads the parameters from their legacy scattered addresses and stores them as a block,
+/// keeping the defaults when the legacy layout is not found
+static void migrate_legacy_params() {
+    constexpr uint16_t first = bsp::eeprom::ADDR_FAN_SPEED;
+    uint8_t legacy[LEGACY_PARAMS_LAST + sizeof(float) - first];
+
+    if (bsp::eeprom::read_array(first, legacy, sizeof(legacy)) != bsp::eeprom::OK) {
+        std::printf("Config: read failed, using defaults\r\n");
+        return;
+    }
+
+    if (!is_legacy_layout(legacy, first)) {
+        std::printf("Config: no parameter block, using defaults\r\n");
+        return;
+    }
+
+    for (auto& param : params) {
+        if (param.second > LEGACY_PARAMS_LAST) {
+            continue;
+        }
+
+        _float f;
+        f.u32 = legacy_u32(legacy + (param.second - first));
+        if (f.u32 != 0xFFFFFFFF) {
             *param.first = f.value;
+        }
+    }
+
+    // Erased or implausible entries keep the built in movement params
+    for (const auto& pair : turn_address_map) {
+        TurnParams stored;
+        auto raw = reinterpret_cast<uint8_t*>(&stored);
+        if (bsp::eeprom::read_array(pair.second, raw, sizeof(stored)) == bsp::eeprom::OK && plausible(stored)) {
+            turn_params_custom[pair.first] = stored;
+        }
+    }
 
-            std::printf("%s: %f\r\n", bsp::eeprom::param_name(param.second), f.value);
-            bsp::delay_ms(2);
+    for (const auto& pair : forward_address_map) {
+        ForwardParams stored;
+        auto raw = reinterpret_cast<uint8_t*>(&stored);
+        if (bsp::eeprom::read_array(pair.second, raw, sizeof(stored)) == bsp::eeprom::OK && plausible(stored)) {
+            forward_params_custom[pair.first] = stored;
         }
     }
 
+    Config::write_default_params();
+    std::printf("Config: migrated the legacy parameters\r\n");
+}
+
+/// @brief Loads every parameter with one read, a corrupt or unknown block keeps the defaults
+static void load_config_block() {
+    size_t size = config_block_size();
+    if (size > sizeof(config_image)) {
+        std::printf("Config: block does not fit in %d bytes, using defaults\r\n", (int)sizeof(config_image));
+        return;
+    }
+
+    if (bsp::eeprom::read_array(bsp::eeprom::ADDR_CONFIG_BLOCK, config_image, size) != bsp::eeprom::OK) {
+        std::printf("Config: read failed, using defaults\r\n");
+        return;
+    }
+
+    ConfigHeader header;
+    std::memcpy(&header, config_image, sizeof(header));
+
+    // Version 0 is the per parameter layout used before the block, only migrated when it is recognised
+    if (std::memcmp(header.magic, CONFIG_MAGIC, sizeof(CONFIG_MAGIC)) != 0) {
+        migrate_legacy_params();
+        return;
+    }
+
+    if (header.version != CONFIG_VERSION || header.param_count > len(params)) {
+        std::printf("Config: unknown version %d with %d params, using defaults\r\n", header.version,
+                    header.param_count);
+        return;
+    }
+
+    size_t crc_offset = param_offset(header.param_count);
+    uint32_t crc;
+    std::memcpy(&crc, config_image + crc_offset, sizeof(crc));
+    if (crc != crc::crc32(config_image, crc_offset)) {
+        std::printf("Config: CRC mismatch, using defaults\r\n");
+        return;
+    }
+
+    size_t i = 0;
+    for (const auto& pair : turn_address_map) {
+        std::memcpy(&turn_params_custom[pair.first], config_image + turn_offset(i++), sizeof(TurnParams));
+    }
+
+    i = 0;
+    for (const auto& pair : forward_address_map) {
+        std::memcpy(&forward_params_custom[pair.first], config_image + forward_offset(i++), sizeof(ForwardParams));
+    }
+
+    for (i = 0; i < header.param_count; i++) {
+        std::memcpy(params[i].first, config_image + param_offset(i), sizeof(float));
+    }
+
+    config_stored = true;
+
+    // Store the defaults of the params added since the block was written
+    if (header.param_count < len(params)) {
+        save_config_range(param_offset(header.param_count), (len(params) - header.param_count) * sizeof(float));
+    }
+
+    std::printf("Config: %d params loaded\r\n", header.param_count);
+}
+
+void Config::init() {
+    if (write_default) {
+        write_default_params();
+    }
+
     load_custom_movements_from_eeprom();
-    bsp::delay_ms(5);
     load_movement_sequence_from_eeprom();
+    load_ir_lut_from_eeprom();
 }
 
 int Config::parse_packet(uint8_t packet[bsp::ble::max_packet_size]) {
@@ -208,22 +532,11 @@ int Config::parse_packet(uint8_t packet[bsp::ble::max_packet_size]) {
 
     *params[parameter].first = f.value;
 
-    bsp::eeprom::write_u32(params[parameter].second, f.u32);
-
-    return 0;
+    return save_config_range(param_offset(parameter), sizeof(float));
 }
 
 int Config::write_default_params() {
-    for (auto& param : params) {
-        _float f;
-        f.value = *param.first;
-        if (bsp::eeprom::write_u32(param.second, f.u32) != bsp::eeprom::OK) {
-            return -1;
-        }
-        bsp::delay_ms(5);
-    }
-
-    return 0;
+    return save_config_range(0, param_offset(len(params)));
 }
 
 void Config::send_parameters() {
@@ -395,79 +708,64 @@ void Config::send_movement_parameters() {
 }
 
 int Config::save_z_bias() {
-    _float f;
-    f.value = Config::z_imu_bias;
+    return save_config_range(param_offset(param_index(&Config::z_imu_bias)), sizeof(float));
+}
 
-    if (bsp::eeprom::write_u32(bsp::eeprom::ADDR_Z_IMU_BIAS, f.u32) != bsp::eeprom::OK) {
-        return -1;
+int Config::save_ir_lut(const uint16_t lut[4][bsp::analog_sensors::IR_LUT_POINTS]) {
+    uint16_t data[4][bsp::analog_sensors::IR_LUT_POINTS];
+    std::memcpy(data, lut, sizeof(data));
+
+    // Queued like the config block, the queue keeps its own copy of data
+    auto bytes = reinterpret_cast<uint8_t*>(data);
+    auto result = bsp::eeprom::write_queued(bsp::eeprom::ADDR_IR_LUT_START, bytes, sizeof(data), config_saved);
+    if (result == bsp::eeprom::BUSY) {
+        result = bsp::eeprom::write_array(bsp::eeprom::ADDR_IR_LUT_START, bytes, sizeof(data));
     }
 
-    return 0;
+    return result == bsp::eeprom::OK ? 0 : -1;
 }
 
-void Config::load_custom_movements_from_eeprom() {
-    for (const auto& pair : turn_address_map) {
-        Movement movement_id = pair.first;
-        uint16_t address = pair.second;
-
-        TurnParams params;
-        bsp::eeprom::read_array(address, reinterpret_cast<uint8_t*>(&params), sizeof(TurnParams));
+void Config::load_ir_lut_from_eeprom() {
+    uint16_t lut[4][bsp::analog_sensors::IR_LUT_POINTS];
 
-        turn_params_custom[movement_id] = params;
-        bsp::delay_ms(10);
+    if (bsp::eeprom::read_array(bsp::eeprom::ADDR_IR_LUT_START, reinterpret_cast<uint8_t*>(lut), sizeof(lut)) !=
+        bsp::eeprom::OK) {
+        return;
     }
 
-    for (const auto& pair : forward_address_map) {
-        Movement movement_id = pair.first;
-        uint16_t address = pair.second;
-
-        ForwardParams params;
-        bsp::eeprom::read_array(address, reinterpret_cast<uint8_t*>(&params), sizeof(ForwardParams));
-        forward_params_custom[movement_id] = params;
-        bsp::delay_ms(10);
+    // Erased memory is not decreasing, so uncalibrated sensors are rejected by ir_set_lut
+    for (int i = 0; i < 4; i++) {
+        auto direction = static_cast<bsp::analog_sensors::SensingDirection>(i);
+        if (bsp::analog_sensors::ir_set_lut(direction, lut[i])) {
+            std::printf("IR LUT %d: %d ~ %d\r\n", i, lut[i][0], lut[i][bsp::analog_sensors::IR_LUT_POINTS - 1]);
+        }
     }
 }
 
+void Config::load_custom_movements_from_eeprom() {
+    load_config_block();
+}
+
 int Config::write_turn_param_to_eeprom(Movement movement_id) {
-    if (turn_address_map.find(movement_id) == turn_address_map.end()) {
+    auto it = turn_address_map.find(movement_id);
+    if (it == turn_address_map.end()) {
         return -1;
     }
 
-    TurnParams params = turn_params_custom[movement_id];
-    uint16_t address = turn_address_map.at(movement_id);
-
-    bsp::eeprom::write_array(address, reinterpret_cast<uint8_t*>(&params), sizeof(TurnParams));
-
-    return 0;
+    return save_config_range(turn_offset(std::distance(turn_address_map.begin(), it)), sizeof(TurnParams));
 }
 
 int Config::write_forward_param_to_eeprom(Movement movement_id) {
-    if (forward_address_map.find(movement_id) == forward_address_map.end()) {
+    auto it = forward_address_map.find(movement_id);
+    if (it == forward_address_map.end()) {
         return -1;
     }
 
-    ForwardParams params = forward_params_custom[movement_id];
-    uint16_t address = forward_address_map.at(movement_id);
-
-    bsp::eeprom::write_array(address, reinterpret_cast<uint8_t*>(&params), sizeof(ForwardParams));
-
-    return 0;
+    return save_config_range(forward_offset(std::distance(forward_address_map.begin(), it)), sizeof(ForwardParams));
 }
 
 int Config::write_all_move_params_to_eeprom() {
-
-    for (const auto& pair : turn_address_map) {
-        write_turn_param_to_eeprom(pair.first);
-        bsp::delay_ms(20);
-    }
-
-    for (const auto& pair : forward_address_map) {
-        Movement movement_id = pair.first;
-        write_forward_param_to_eeprom(movement_id);
-        bsp::delay_ms(20);
-    }
-
-    return 0;
+    return save_config_range(turn_offset(0), forward_offset(forward_address_map.size()) - turn_offset(0));
 }
 
 int Config::parse_move_sequence_packet(uint8_t packet[bsp::ble::max_packet_size]) {
@@ -485,7 +783,6 @@ int Config::parse_move_sequence_packet(uint8_t packet[bsp::ble::max_packet_size]
     }
 
     std::vector<std::pair<Movement, uint8_t>> moves;
-    uint8_t valid_moves = 0;
 
     for (int i = 2; i < bsp::ble::max_packet_size; ++i) {
         uint8_t byte = packet[i];
@@ -496,25 +793,33 @@ int Config::parse_move_sequence_packet(uint8_t packet[bsp::ble::max_packet_size]
 
         if (count == 0 || type == Movement::STOP) {
             if (type == Movement::STOP) {
-                valid_moves++;
                 moves.push_back({Movement::STOP, 1});
             }
             break;
         }
-        valid_moves++;
         moves.push_back({type, count});
     }
 
     // Ensure the sequence ends with a STOP command
     if (moves.empty() || moves.back().first != Movement::STOP) {
-        valid_moves++;
         moves.push_back({Movement::STOP, 1});
     }
 
     navigation_service->set_hardcoded_movements(moves);
-    bsp::eeprom::write_array(bsp::eeprom::ADDR_MOVE_SEQUENCE_1, &packet[2], valid_moves);
 
-    return 0;
+    // Stored as received, with the STOP added above when the packet had none
+    uint8_t sequence[bsp::eeprom::ADDR_MOVE_SEQUENCE_18 - bsp::eeprom::ADDR_MOVE_SEQUENCE_1 + 1];
+    uint16_t size = std::min<size_t>(moves.size(), sizeof(sequence));
+    for (uint16_t i = 0; i < size; i++) {
+        sequence[i] = static_cast<uint8_t>(moves[i].first) << 3 | moves[i].second;
+    }
+
+    auto result = bsp::eeprom::write_queued(bsp::eeprom::ADDR_MOVE_SEQUENCE_1, sequence, size, config_saved);
+    if (result == bsp::eeprom::BUSY) {
+        result = bsp::eeprom::write_array(bsp::eeprom::ADDR_MOVE_SEQUENCE_1, sequence, size);
+    }
+
+    return result == bsp::eeprom::OK ? 0 : -1;
 }
 
 void Config::send_move_sequence() {
@@ -550,11 +855,12 @@ void Config::send_move_sequence() {
 void Config::load_movement_sequence_from_eeprom() {
     std::vector<std::pair<Movement, uint8_t>> moves;
 
-    for (int i = 0; i < 18; ++i) {
-        uint8_t byte;
-        if (bsp::eeprom::read_u8(bsp::eeprom::ADDR_MOVE_SEQUENCE_1 + i, &byte) != bsp::eeprom::OK) {
-            return;
-        }
+    uint8_t sequence[18];
+    if (bsp::eeprom::read_array(bsp::eeprom::ADDR_MOVE_SEQUENCE_1, sequence, sizeof(sequence)) != bsp::eeprom::OK) {
+        return;
+    }
+
+    for (uint8_t byte : sequence) {
 
         if (byte == 0xFF) {
             break;
@@ -575,8 +881,6 @@ void Config::load_movement_sequence_from_eeprom() {
             break;
         }
         moves.push_back({type, count});
-
-        bsp::delay_ms(10);
     }
 
     auto navigation_service = services::Navigation::instance();
@@ -1,5 +1,7 @@
+#include <atomic>
 #include <cstdio>
 
+#include "algorithms/lqr_gains.hpp"
 #include "bsp/analog_sensors.hpp"
 #include "bsp/encoders.hpp"
 #include "bsp/fan.hpp"
@@ -8,11 +10,15 @@
 #include "bsp/timers.hpp"
 #include "services/config.hpp"
 #include "services/control.hpp"
+#include "utils/math.hpp"
 
 static constexpr float max_battery_voltage = 12.6;
 static constexpr float mot_kt = 0.0064; // motor torque constant [Nm/A]
 static constexpr float mot_ra = 2.5;    // armature resistance[Ohms]
 
+// Fast stage stops driving the motors if the slow stage misses this many periods
+static constexpr uint32_t slow_stage_timeout_us = 3 * (1000000 / services::Config::CONTROL_FREQUENCY_HZ);
+
 namespace services {
 
 Control* Control::instance() {
@@ -49,10 +55,17 @@ void Control::init(void) {
         services::Config::enable_wall_break_correction,
     };
     reset(general_params);
+
+    bsp::analog_sensors::register_current_callback([]() { Control::instance()->current_loop_update(); });
 }
 
-void Control::reset(GeneralParams general_params) {
+void Control::reset(GeneralParams general_params, GainSchedule gain_schedule) {
+    // The timer keeps running, the fast stage just returns until the state below is consistent again
+    fast_loop_enabled = false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
     params = general_params;
+    schedule = gain_schedule;
 
     linear_vel_pid.reset();
     linear_vel_pid.kp = params.linear_vel_kp;
@@ -78,6 +91,29 @@ void Control::reset(GeneralParams general_params) {
     diagonal_walls_pid.kd = params.diagonal_walls_kd;
     diagonal_walls_pid.integral_limit = 0;
 
+    current_loop_l = algorithm::CurrentLoop(mot_ra, mot_kt, Config::current_kp, Config::current_ki, 200);
+    current_loop_r = current_loop_l;
+
+    velocity_lqr.reset();
+    velocity_lqr.set_gains(lqr_default_k);
+    velocity_lqr.integral_limit_linear = 0.02;
+    velocity_lqr.integral_limit_angular = 2.0;
+    control_mode = Config::control_mode > 0.5f ? LQR : PID;
+    linear_saturated = false;
+    angular_saturated = false;
+
+    dob_l.reset();
+    dob_l.inertia_k = Config::dob_inertia_k;
+    dob_l.cutoff_hz = Config::dob_cutoff_hz;
+    dob_l.limit = 2.0f;
+    dob_r = dob_l;
+    dob_enabled = Config::dob_enable > 0.5f;
+    sag_compensation_enabled = Config::battery_sag_compensation > 0.5f;
+
+    current_loop_enabled = Config::current_loop_enable > 0.5f;
+    target_current_l = 0.0f;
+    target_current_r = 0.0f;
+
     target_angular_speed_rad_s = 0;
     last_target_angular_speed_rad_s = 0;
     target_linear_speed_m_s = 0;
@@ -89,15 +125,64 @@ void Control::reset(GeneralParams general_params) {
     angular_jerk_ff_value = 0.0f;
     angular_jerk_ff_counter = 0;
     rotation_ff = 0.0f;
+    linear_ff = 0.0f;
     fan_pwm = 0.0f;
 
     motor_control_disabled = false;
     emergency = false;
+
+    VelocitySetpoint setpoint = {};
+    setpoint.linear_kp = params.linear_vel_kp;
+    setpoint.linear_ki = params.linear_vel_ki;
+    setpoint.linear_kd = params.linear_vel_kd;
+    setpoint.angular_kp = params.angular_kp;
+    setpoint.angular_ki = params.angular_ki;
+    setpoint.angular_kd = params.angular_kd;
+    setpoints[0] = setpoint;
+    setpoints[1] = setpoint;
+    active_setpoint = 0;
+
+    slow_period_s = Config::CONTROL_PERIOD_S;
+    slow_stage_ran = false;
+    fast_loop_stopped = true;
+    last_fast_update_us = bsp::get_tick_us();
+
+    configure_fast_timer();
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    fast_loop_enabled = fast_period_us > 0;
+}
+
+void Control::configure_fast_timer() {
+    float fast_frequency_hz = std::min(Config::control_fast_frequency_hz, Config::CONTROL_FAST_MAX_FREQUENCY_HZ);
+    fast_period_us = 0;
+    if (fast_frequency_hz > Config::CONTROL_FREQUENCY_HZ) {
+        fast_period_us = static_cast<uint32_t>(1000000 / fast_frequency_hz);
+    }
+
+    // Only a new configured rate touches the timer, resets during a run keep it running
+    if (fast_period_us == timer_period_us) {
+        return;
+    }
+
+    bsp::timers::stop_periodic();
+    timer_period_us = fast_period_us;
+    if (timer_period_us > 0) {
+        bsp::timers::start_periodic(timer_period_us, []() { Control::instance()->fast_update(); });
+    }
+}
+
+void Control::publish_setpoint(const VelocitySetpoint& setpoint) {
+    uint8_t next = active_setpoint ^ 1;
+    setpoints[next] = setpoint;
+    std::atomic_signal_fence(std::memory_order_release);
+    active_setpoint = next;
 }
 
 void Control::update() {
 
     float bat_volts = bsp::analog_sensors::battery_latest_reading_volts();
+    battery->update(bat_volts, battery_load_current_a());
 
     if (motor_control_disabled) {
         bsp::motors::set(0, 0);
@@ -109,7 +194,17 @@ void Control::update() {
         last_target_angular_acceleration = 0.0f;
         angular_jerk_ff_value = 0.0f;
         angular_jerk_ff_counter = 0;
+        dob_l.reset();
+        dob_r.reset();
     } else {
+        // Slow stage runs from the main loop, so its period is measured and smoothed instead of assumed
+        uint32_t now = bsp::get_tick_us();
+        if (slow_stage_ran) {
+            float measured_period_s = constrain((now - last_slow_update_us) / 1000000.0f,
+                                                0.5f * Config::CONTROL_PERIOD_S, 2.0f * Config::CONTROL_PERIOD_S);
+            slow_period_s += (measured_period_s - slow_period_s) * 0.05f;
+        }
+
         float mean_velocity_m_s = bsp::encoders::get_filtered_velocity_m_s();
         auto angular_speed_error_raw = std::abs(target_angular_speed_rad_s - bsp::imu::get_rad_per_s());
         auto linear_speed_error = std::abs(target_linear_speed_m_s - mean_velocity_m_s);
@@ -123,12 +218,13 @@ void Control::update() {
             target_angular_speed_rad_s += diagonal_walls_pid.calculate(0.0, bsp::analog_sensors::ir_diagonal_error());
         }
 
-        float linear_ratio = linear_vel_pid.calculate(target_linear_speed_m_s, mean_velocity_m_s);
-        float rotation_ratio = -angular_vel_pid.calculate(target_angular_speed_rad_s, bsp::imu::get_rad_per_s());
+        // Gain scheduling
+        GainSchedulePoint linear_gains = gain_schedule_lookup(schedule.linear, std::abs(target_linear_speed_m_s));
+        GainSchedulePoint angular_gains = gain_schedule_lookup(schedule.angular, std::abs(target_angular_speed_rad_s));
 
         // Angular Feed-Foward
         float target_angular_acceleration =
-            (target_angular_speed_rad_s - last_target_angular_speed_rad_s) * Config::CONTROL_FREQUENCY_HZ;
+            (target_angular_speed_rad_s - last_target_angular_speed_rad_s) / slow_period_s;
 
         float angular_accel_variation = target_angular_acceleration - last_target_angular_acceleration;
         if (std::abs(angular_accel_variation) > 800.0f) {
@@ -152,14 +248,15 @@ void Control::update() {
         }
         last_target_angular_acceleration = target_angular_acceleration;
 
-        rotation_ff = target_angular_acceleration * params.angular_acc_feed_forward_k;
-        rotation_ff += target_angular_speed_rad_s * params.angular_vel_feed_forward_k;
-        rotation_ff += angular_jerk_ff_value;
+        float new_rotation_ff = target_angular_acceleration * params.angular_acc_feed_forward_k;
+        new_rotation_ff += target_angular_speed_rad_s * params.angular_vel_feed_forward_k;
+        new_rotation_ff += angular_jerk_ff_value;
+        rotation_ff = new_rotation_ff * angular_gains.ff_scale;
         last_target_angular_speed_rad_s = target_angular_speed_rad_s;
         
         // Linear Feed-Foward
         float target_linear_acceleration =
-            (target_linear_speed_m_s - last_target_linear_speed_m_s) * Config::CONTROL_FREQUENCY_HZ;
+            (target_linear_speed_m_s - last_target_linear_speed_m_s) / slow_period_s;
 
         float accel_variation = target_linear_acceleration - last_target_linear_acceleration;
         if (std::abs(accel_variation) > 10.0f && std::abs(target_linear_speed_m_s) > 0.5 ) {
@@ -183,31 +280,178 @@ void Control::update() {
         }
         last_target_linear_acceleration = target_linear_acceleration;
 
+        float new_linear_ff;
         if (target_linear_acceleration >= 0.0f) {
-            linear_ff = target_linear_acceleration * params.linear_vel_acc_feed_forward_k;
+            new_linear_ff = target_linear_acceleration * params.linear_vel_acc_feed_forward_k;
         } else {
-            linear_ff = target_linear_acceleration * params.linear_vel_brake_feed_forward_k;
+            new_linear_ff = target_linear_acceleration * params.linear_vel_brake_feed_forward_k;
         }
-        linear_ff += target_linear_speed_m_s * params.linear_vel_feed_forward_k;
-        linear_ff += jerk_ff_value;
+        new_linear_ff += target_linear_speed_m_s * params.linear_vel_feed_forward_k;
+        new_linear_ff += jerk_ff_value;
+        linear_ff = new_linear_ff * linear_gains.ff_scale;
         last_target_linear_speed_m_s = target_linear_speed_m_s;
 
-        // Control
-        float l_current = (linear_ratio + linear_ff) + (rotation_ratio - rotation_ff);
-        float r_current = (linear_ratio + linear_ff) - (rotation_ratio - rotation_ff);
+        VelocitySetpoint setpoint;
+        setpoint.linear_speed_m_s = target_linear_speed_m_s;
+        setpoint.angular_speed_rad_s = target_angular_speed_rad_s;
+        setpoint.linear_ff = linear_ff;
+        setpoint.rotation_ff = rotation_ff;
+        setpoint.linear_kp = params.linear_vel_kp * linear_gains.kp_scale;
+        setpoint.linear_ki = params.linear_vel_ki * linear_gains.ki_scale;
+        setpoint.linear_kd = params.linear_vel_kd * linear_gains.kd_scale;
+        setpoint.angular_kp = params.angular_kp * angular_gains.kp_scale;
+        setpoint.angular_ki = params.angular_ki * angular_gains.ki_scale;
+        setpoint.angular_kd = params.angular_kd * angular_gains.kd_scale;
+        publish_setpoint(setpoint);
+
+        last_slow_update_us = now;
+        slow_stage_ran = true;
+
+        if (!fast_loop_enabled) {
+            velocity_loop_update(slow_period_s);
+        }
+    }
+
+    fan_control_update(bat_volts);
+}
+
+void Control::fast_update() {
+    if (!fast_loop_enabled) {
+        return;
+    }
+
+    uint32_t now = bsp::get_tick_us();
+    float dt = (now - last_fast_update_us) / 1000000.0f;
+    last_fast_update_us = now;
+
+    // Owns the velocity estimate in every state while enabled, the main loop callers skip it then
+    bsp::encoders::update_velocities();
+
+    // Slow stage owns the motors while disabled, and a stale slow stage means nobody is commanding targets
+    if (motor_control_disabled || !slow_stage_ran || (now - last_slow_update_us) > slow_stage_timeout_us) {
+        if (!fast_loop_stopped && !motor_control_disabled) {
+            bsp::motors::set(0, 0);
+        }
+        fast_loop_stopped = true;
+        return;
+    }
+
+    if (fast_loop_stopped) {
+        dt = fast_period_us / 1000000.0f;
+        fast_loop_stopped = false;
+    }
+
+    dt = constrain(dt, 0.5f * fast_period_us / 1000000.0f, 2.0f * fast_period_us / 1000000.0f);
+    velocity_loop_update(dt);
+}
+
+void Control::velocity_loop_update(float dt) {
+    // Copied once, the slow stage only ever writes the other buffer
+    VelocitySetpoint setpoint = setpoints[active_setpoint];
+
+    float bat_volts = bsp::analog_sensors::battery_latest_reading_volts();
+    float mean_velocity_m_s = bsp::encoders::get_filtered_velocity_m_s();
+
+    // Only this stage touches the velocity PIDs, so the integral rescale in set_ki cannot race calculate
+    linear_vel_pid.kp = setpoint.linear_kp;
+    linear_vel_pid.set_ki(setpoint.linear_ki);
+    linear_vel_pid.kd = setpoint.linear_kd;
+    angular_vel_pid.kp = setpoint.angular_kp;
+    angular_vel_pid.set_ki(setpoint.angular_ki);
+    angular_vel_pid.kd = setpoint.angular_kd;
+
+    float linear_ratio;
+    float rotation_ratio;
+    if (control_mode == LQR) {
+        float angular_command;
+        velocity_lqr.calculate(setpoint.linear_speed_m_s, mean_velocity_m_s, setpoint.angular_speed_rad_s,
+                               bsp::imu::get_rad_per_s(), dt, linear_saturated, angular_saturated, &linear_ratio,
+                               &angular_command);
+        rotation_ratio = -angular_command;
+    } else {
+        // PID gains are tuned per CONTROL_PERIOD_S step
+        float period_ratio = dt / Config::CONTROL_PERIOD_S;
+        linear_ratio = linear_vel_pid.calculate(setpoint.linear_speed_m_s, mean_velocity_m_s, period_ratio);
+        rotation_ratio =
+            -angular_vel_pid.calculate(setpoint.angular_speed_rad_s, bsp::imu::get_rad_per_s(), period_ratio);
+    }
+
+    float left_ang_vel = bsp::encoders::get_left_filtered_ang_vel_rad_s();
+    float right_ang_vel = bsp::encoders::get_right_filtered_ang_vel_rad_s();
+
+    // Disturbance observer, fed with the current applied on the last cycle
+    float l_applied = ((pwm_duty_l / 1000.0f) * bat_volts - left_ang_vel * mot_kt) / mot_ra;
+    float r_applied = ((pwm_duty_r / 1000.0f) * bat_volts - right_ang_vel * mot_kt) / mot_ra;
+    dob_l.update(l_applied, left_ang_vel, dt);
+    dob_r.update(r_applied, right_ang_vel, dt);
+
+    // Control
+    float l_current = (linear_ratio + setpoint.linear_ff) + (rotation_ratio - setpoint.rotation_ff);
+    float r_current = (linear_ratio + setpoint.linear_ff) - (rotation_ratio - setpoint.rotation_ff);
 
-        float left_ang_vel = bsp::encoders::get_left_filtered_ang_vel_rad_s();
-        float right_ang_vel = bsp::encoders::get_right_filtered_ang_vel_rad_s();
+    if (dob_enabled) {
+        l_current += dob_l.get_estimate();
+        r_current += dob_r.get_estimate();
+    }
+
+    if (current_loop_enabled) {
+        // Inner loop on the ADC2 callback takes these as its references
+        target_current_l = l_current;
+        target_current_r = r_current;
+    } else {
+        float pwm_volts = bat_volts;
+        if (sag_compensation_enabled) {
+            // Voltage the battery will sag to under the new currents, so the PWM already accounts for it
+            float load_current = (std::abs(l_current * pwm_duty_l) + std::abs(r_current * pwm_duty_r)) / 1000.0f;
+            pwm_volts = battery->predict_volts(load_current);
+            if (pwm_volts < 5.0f) {
+                pwm_volts = bat_volts;
+            }
+        }
 
-        pwm_duty_l = ((l_current * mot_ra + left_ang_vel * mot_kt) / bat_volts) * 1000;
-        pwm_duty_r = ((r_current * mot_ra + right_ang_vel * mot_kt) / bat_volts) * 1000;
+        float pwm_l = ((l_current * mot_ra + left_ang_vel * mot_kt) / pwm_volts) * 1000;
+        float pwm_r = ((r_current * mot_ra + right_ang_vel * mot_kt) / pwm_volts) * 1000;
 
-        std::tie(pwm_duty_l, pwm_duty_r) = clamp_pwms(pwm_duty_l, pwm_duty_r);
+        std::tie(pwm_duty_l, pwm_duty_r) = limit_pwms(pwm_l, pwm_r);
 
         bsp::motors::set(pwm_duty_l, pwm_duty_r);
     }
+}
 
-    fan_control_update(bat_volts);
+float Control::battery_load_current_a() const {
+    float l_amps = bsp::analog_sensors::current_latest_reading_amps(bsp::analog_sensors::CURRENT_LEFT);
+    float r_amps = bsp::analog_sensors::current_latest_reading_amps(bsp::analog_sensors::CURRENT_RIGHT);
+
+    // Drivers draw the motor current only during the on time of the PWM
+    return (std::abs(l_amps * pwm_duty_l) + std::abs(r_amps * pwm_duty_r)) / 1000.0f;
+}
+
+void Control::current_loop_update() {
+    if (!current_loop_enabled || motor_control_disabled) {
+        return;
+    }
+
+    float bat_volts = bsp::analog_sensors::battery_latest_reading_volts();
+    if (bat_volts < 5.0) {
+        return;
+    }
+
+    float l_amps = bsp::analog_sensors::current_latest_reading_amps(bsp::analog_sensors::CURRENT_LEFT);
+    float r_amps = bsp::analog_sensors::current_latest_reading_amps(bsp::analog_sensors::CURRENT_RIGHT);
+
+    float left_ang_vel = bsp::encoders::get_left_filtered_ang_vel_rad_s();
+    float right_ang_vel = bsp::encoders::get_right_filtered_ang_vel_rad_s();
+
+    float l_target = target_current_l;
+    float r_target = target_current_r;
+
+    // The readings are magnitudes, the loops sign them with the voltage applied on the last cycle
+    float l_volts = current_loop_l.calculate(l_target, l_amps, left_ang_vel, (pwm_duty_l / 1000.0f) * bat_volts);
+    float r_volts = current_loop_r.calculate(r_target, r_amps, right_ang_vel, (pwm_duty_r / 1000.0f) * bat_volts);
+
+    std::tie(pwm_duty_l, pwm_duty_r) = limit_pwms((l_volts / bat_volts) * 1000, (r_volts / bat_volts) * 1000);
+
+    bsp::motors::set(pwm_duty_l, pwm_duty_r);
 }
 
 std::pair<int16_t, int16_t> Control::clamp_pwms(int16_t pwm_l, int16_t pwm_r) {
@@ -239,6 +483,30 @@ std::pair<int16_t, int16_t> Control::clamp_pwms(int16_t pwm_l, int16_t pwm_r) {
     return {pwm_l, pwm_r};
 }
 
+std::pair<int16_t, int16_t> Control::allocate_pwms(float pwm_l, float pwm_r) {
+    const float max_pwm = bsp::motors::COUNTER_PERIOD_MAX;
+
+    float common = (pwm_l + pwm_r) / 2.0f;
+    float differential = (pwm_l - pwm_r) / 2.0f;
+
+    angular_saturated = std::abs(differential) > max_pwm;
+    differential = constrain(differential, -max_pwm, max_pwm);
+
+    float common_limit = max_pwm - std::abs(differential);
+    linear_saturated = std::abs(common) > common_limit;
+    common = constrain(common, -common_limit, common_limit);
+
+    return {static_cast<int16_t>(common + differential), static_cast<int16_t>(common - differential)};
+}
+
+std::pair<int16_t, int16_t> Control::limit_pwms(float pwm_l, float pwm_r) {
+    if (control_mode == LQR) {
+        return allocate_pwms(pwm_l, pwm_r);
+    }
+
+    return clamp_pwms(pwm_l, pwm_r);
+}
+
 void Control::fan_control_update(float bat_volts) {
 
     float target_fan_speed = std::min(params.fan_speed, static_cast<float>(bsp::fan::MAX_SPEED));
@@ -1,5 +1,8 @@
 #include "utils/math.hpp"
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 
@@ -9,68 +12,232 @@
 #include "bsp/encoders.hpp"
 #include "bsp/imu.hpp"
 #include "bsp/timers.hpp"
+#include "bsp/usb.hpp"
 #include "services/control.hpp"
 #include "services/logger.hpp"
 #include "services/navigation.hpp"
+#include "utils/bit_packer.hpp"
+#include "utils/crc.hpp"
 
 /// @section Constants
 
+static constexpr uint32_t DUMP_TIMEOUT_MS = 500;
+static constexpr uint16_t STREAM_SCHEMA_PERIOD = 1000; // Records between schema frames
+static constexpr uint32_t RECORD_PERIOD_MS = 1;         // update() runs on the 1 ms control timer
+static constexpr uint16_t PERSIST_QUEUE_RESERVE = 16;   // EEPROM queue pages left to the config and maze saves
+static constexpr uint32_t PERSIST_STEP_RECORDS = 256;   // Records decoded per persist_step while truncating
+static constexpr uint32_t PERSIST_STEP_CRC_BYTES = 2048; // Dump bytes added to the CRC per persist_step
+
 /// @section Service implementation
 
 namespace services {
 
-#if CONTROL_LOG_MODE
-const Logger::ParamInfo paramInfoArray[] = {
-    {8191, -5, 10, 546.0f},       // velocity_ms
-    {8191, -5, 10, 546.0f},       // target_velocity_ms
-    {8191, -70, 70, 58.0f},       // angular_speed_rad_s
-    {8191, -70, 70, 58.0f},       // target_rad_s
-    {1023, -1000, 1000, 0.5115f}, // pwm_left
-    {1023, -1000, 1000, 0.5115f}, // pwm_right
-    {4095, -5, 5, 409.5f},        // encoder_imu_diff
-    {16383, -3, 3, 2730.5f},      // vel_p
-    {16383, -3, 3, 2730.5f},      // vel_i
-    {16383, -2, 2, 4095.75f},     // ang_p
-    {16383, -2, 2, 4095.75f},     // ang_i
-    {1023, -2, 2, 255.0f},        // linear_ff
-    {1023, -2, 2, 255.0f},        // rotation_ff
-};
-#else
-const Logger::ParamInfo paramInfoArray[] = {
-    {8191, -5, 10, 546.0f},       // velocity_ms
-    {8191, -5, 10, 546.0f},       // target_velocity_ms
-    {8191, -70, 70, 58.0f},       // angular_speed_rad_s
-    {8191, -70, 70, 58.0f},       // target_rad_s
-    {1023, -1000, 1000, 0.5115f}, // pwm_left
-    {1023, -1000, 1000, 0.5115f}, // pwm_right
-    {4095, -5, 5, 409.5f},        // encoder_imu_diff
-    {255, 0, 13000, 0.0195f},     // battery
-    {65535, -250, 250, 131.0f},   // position_mm_x
-    {65535, -250, 250, 131.0f},   // position_mm_y
-    {16383, -180, 180, 45.5083f}, // angle
-    {16383, -500, 12600, 1.25061f}, // distance_mm
+static Control* control() {
+    return Control::instance();
+}
+
+static Navigation* nav() {
+    return Navigation::instance();
+}
+
+static constexpr Logger::SignalInfo signal_registry[] = {
+    {"Vel", [] { return bsp::encoders::get_filtered_velocity_m_s(); }, {8191, -5, 10, 546.0f}},
+    {"TgtVel", [] { return control()->get_target_linear_speed(); }, {8191, -5, 10, 546.0f}},
+    {"AngVel", [] { return bsp::imu::get_rad_per_s(); }, {8191, -70, 70, 58.0f}},
+    {"TgtAngVel", [] { return control()->get_target_angular_speed(); }, {8191, -70, 70, 58.0f}},
+    {"PWM_L", [] { return static_cast<float>(control()->get_pwm_duty_l()); }, {1023, -1000, 1000, 0.5115f}},
+    {"PWM_R", [] { return static_cast<float>(control()->get_pwm_duty_r()); }, {1023, -1000, 1000, 0.5115f}},
+    {"ImuDiff", [] { return nav()->get_encoder_imu_diff(); }, {4095, -5, 5, 409.5f}},
+    {"VelP", [] { return control()->get_vel_pid().kp * control()->get_vel_pid().previous_error; },
+     {16383, -3, 3, 2730.5f}},
+    {"VelI", [] { return control()->get_vel_pid().ki * control()->get_vel_pid().integral; },
+     {16383, -3, 3, 2730.5f}},
+    {"AngP", [] { return control()->get_ang_vel_pid().kp * control()->get_ang_vel_pid().previous_error; },
+     {16383, -2, 2, 4095.75f}},
+    {"AngI", [] { return control()->get_ang_vel_pid().ki * control()->get_ang_vel_pid().integral; },
+     {16383, -2, 2, 4095.75f}},
+    {"RotFF", [] { return control()->get_rotation_ff(); }, {1023, -2, 2, 255.0f}},
+    {"LinFF", [] { return control()->get_linear_ff(); }, {1023, -2, 2, 255.0f}},
+    {"Dob_L", [] { return control()->get_disturbance_l(); }, {4095, -3, 3, 682.5f}},
+    {"Dob_R", [] { return control()->get_disturbance_r(); }, {4095, -3, 3, 682.5f}},
+    {"Batt_mV", [] { return bsp::analog_sensors::battery_latest_reading_mv(); }, {255, 0, 13000, 0.0195f}},
+    {"PosX", [] { return nav()->get_robot_position_mm().x; }, {65535, -250, 250, 131.0f}},
+    {"PosY", [] { return nav()->get_robot_position_mm().y; }, {65535, -250, 250, 131.0f}},
+    {"Angle", [] { return bsp::imu::get_angle() * (180.0f / static_cast<float>(M_PI)); }, {16383, -180, 180, 45.5083f}},
+    {"Dist", [] { return nav()->get_robot_travelled_dist_mm(); }, {16383, -500, 12600, 1.25061f}},
 };
-#endif
 
-// This prevents bugs if a new parameter is added to one but not the other.
-static_assert(static_cast<size_t>(ParamIndex::COUNT) == std::size(paramInfoArray));
+// This prevents bugs if a new signal is added to one but not the other.
+static_assert(static_cast<size_t>(ParamIndex::COUNT) == std::size(signal_registry));
+static_assert(static_cast<size_t>(ParamIndex::COUNT) <= 32, "Channel mask is 32 bits wide");
+
+static constexpr uint8_t field_bits(const Logger::SignalInfo& signal) {
+    return std::bit_width(signal.info.max_store_value);
+}
+
+static constexpr size_t all_channels_bits = [] {
+    size_t bits = 0;
+    for (const auto& signal : signal_registry) {
+        bits += field_bits(signal);
+    }
+    return bits;
+}();
+
+static_assert((all_channels_bits + 7) / 8 <= Logger::MAX_RECORD_SIZE, "A record with every channel must fit");
 
 Logger* Logger::instance() {
     static Logger p;
     return &p;
 }
 
+Logger::Logger() {
+    set_channels(CONTROL_CHANNELS);
+}
+
 void Logger::init() {
     reset();
+    capturing = true;
+    run_number = 0;
+}
+
+void Logger::stop() {
+    capturing = false;
+    finalize_ring();
+
+    if (persistence && has_capture()) {
+        // Only stored runs take a number, they carry on across power cycles through the storage directory
+        if (load_directory()) {
+            run_number = directory.next_run++;
+        }
+        persist_state = PERSIST_PREPARE;
+        persist_failed = false;
+    }
 }
 
 void Logger::reset() {
-    log_data_idx = 0;
     addr_offset = 0;
+    record_count = 0;
+    ram_full = false;
+    ram_writer.rewind(0);
+    ram_writer.resize(sizeof(ram_logger));
+    encoder.since_keyframe = KEYFRAME_INTERVAL;
+    total_records = 0;
+    event_count = 0;
+
+    uint32_t ring_records = (trigger_config.pre_ms + trigger_config.post_ms) / RECORD_PERIOD_MS;
+    ring_capacity = std::clamp<uint32_t>(ring_records, 1, (sizeof(ram_logger) - RING_EVENT_RESERVE) / record_size);
+    ring_head = 0;
+    ring_count = 0;
+    post_remaining = 0;
+    records_since_trigger = 0;
+    fired_source = 0;
+    prev_conditions = 0xFF; // Only edges after arming count
+    ring_finalized = false;
+    command_trigger = false;
+    stream_sequence = 0;
+    records_since_schema = 0;
+
+    // The RAM capture is about to change, a half written copy is never added to the directory
+    persist_state = PERSIST_IDLE;
+}
+
+void Logger::set_channels(uint32_t mask) {
+    if ((mask & ((1u << std::size(signal_registry)) - 1)) == 0) {
+        mask = CONTROL_CHANNELS;
+    }
+
+    channel_count = 0;
+    size_t record_bits = 0;
+
+    for (uint8_t id = 0; id < std::size(signal_registry); id++) {
+        if (mask & (1u << id)) {
+            channel_ids[channel_count++] = id;
+            record_bits += field_bits(signal_registry[id]);
+        }
+    }
+
+    channel_mask = mask;
+    record_size = (record_bits + 7) / 8;
+    reset();
+}
+
+uint32_t Logger::get_channels() const {
+    return channel_mask;
 }
 
-void Logger::save_size() {
-    // bsp::eeprom::write_u32(bsp::eeprom::ADDR_LOGGER_SIZE, addr_offset);
+void Logger::set_compression(Compression mode) {
+    compression = mode <= COMPRESSION_LINEAR ? mode : COMPRESSION_NONE;
+    if (trigger_config.sources != 0) {
+        compression = COMPRESSION_NONE;
+    }
+    reset();
+}
+
+void Logger::set_trigger(const TriggerConfig& config) {
+    trigger_config = config;
+    if (trigger_config.sources != 0) {
+        compression = COMPRESSION_NONE;
+    }
+    reset();
+}
+
+void Logger::trigger() {
+    command_trigger = true;
+}
+
+bool Logger::is_triggered() const {
+    return fired_source != 0;
+}
+
+void Logger::log_event(EventTag tag, uint8_t arg, int16_t value) {
+    LogEvent event = {total_records, bsp::get_tick_us(), tag, arg, value};
+
+    if (streaming) {
+        send_stream_frame(STREAM_EVENT, reinterpret_cast<const uint8_t*>(&event), sizeof(event));
+    }
+
+    if (!capturing || ram_full) {
+        return;
+    }
+
+    // Events grow down from the end of ram_logger, the oldest one on top
+    size_t event_start = sizeof(ram_logger) - (event_count + 1) * sizeof(LogEvent);
+
+    if (trigger_config.sources != 0) {
+        if (event_count * sizeof(LogEvent) == RING_EVENT_RESERVE) {
+            // Ring capture keeps the newest events, drop the oldest one
+            event_start += sizeof(LogEvent);
+            memmove(ram_logger + event_start + sizeof(LogEvent), ram_logger + event_start,
+                    (event_count - 1) * sizeof(LogEvent));
+            event_count--;
+        }
+    } else if (event_start < addr_offset) {
+        return;
+    }
+
+    memcpy(ram_logger + event_start, &event, sizeof(event));
+    ram_writer.resize(event_start);
+    event_count++;
+}
+
+const Logger::LogEvent& Logger::event_at(uint16_t index) const {
+    return reinterpret_cast<const LogEvent*>(ram_logger + sizeof(ram_logger))[-1 - index];
+}
+
+uint32_t Logger::first_record() const {
+    return total_records - record_count;
+}
+
+void Logger::set_streaming(bool enabled) {
+    streaming = enabled;
+
+    if (streaming) {
+        send_stream_schema();
+    }
+}
+
+bool Logger::is_streaming() const {
+    return streaming;
 }
 
 float Logger::encode_value(float raw_value, const ParamInfo& info) const {
@@ -83,151 +250,647 @@ float Logger::decode_value(float stored_value, const ParamInfo& info) const {
     return (stored_value / info.scale) + info.min_param_value;
 }
 
+size_t Logger::fill_schema(SchemaEntry* entries) const {
+    for (uint8_t i = 0; i < channel_count; i++) {
+        const auto& signal = signal_registry[channel_ids[i]];
+        SchemaEntry& entry = entries[i];
+
+        entry.signal_id = channel_ids[i];
+        entry.bits = field_bits(signal);
+        memset(entry.name, 0, sizeof(entry.name));
+        strncpy(entry.name, signal.name, sizeof(entry.name) - 1);
+        entry.min_param_value = signal.info.min_param_value;
+        entry.scale = signal.info.scale;
+    }
+
+    return channel_count;
+}
+
+void Logger::send_stream_frame(StreamFrameType type, const uint8_t* payload, uint16_t length) {
+    StreamFrameHeader header;
+    header.sync[0] = STREAM_SYNC_0;
+    header.sync[1] = STREAM_SYNC_1;
+    header.type = type;
+    header.length = length;
+    header.sequence = stream_sequence++;
+    header.timestamp_us = bsp::get_tick_us();
+
+    memcpy(stream_frame, &header, sizeof(header));
+    memcpy(stream_frame + sizeof(header), payload, length);
+
+    size_t checksum_idx = sizeof(header) + length;
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < checksum_idx; i++) {
+        checksum += stream_frame[i];
+    }
+    stream_frame[checksum_idx] = checksum;
+
+    // A full buffer drops the frame, the host sees it as a sequence gap
+    bsp::usb::write(stream_frame, checksum_idx + 1);
+}
+
+void Logger::send_stream_schema() {
+    SchemaEntry schema[static_cast<size_t>(ParamIndex::COUNT)];
+    size_t count = fill_schema(schema);
+    send_stream_frame(STREAM_SCHEMA, reinterpret_cast<const uint8_t*>(schema), count * sizeof(SchemaEntry));
+    records_since_schema = 0;
+}
+
+uint32_t Logger::predict(const Predictor& predictor, uint8_t channel) const {
+    if (compression != COMPRESSION_LINEAR) {
+        return predictor.prev[channel];
+    }
+
+    int32_t linear = 2 * static_cast<int32_t>(predictor.prev[channel]) - static_cast<int32_t>(predictor.prev2[channel]);
+    int32_t max_value = signal_registry[channel_ids[channel]].info.max_store_value;
+    return std::clamp(linear, 0, max_value);
+}
+
+void Logger::push_prediction(Predictor& predictor, const uint32_t* values, bool keyframe) const {
+    for (uint8_t i = 0; i < channel_count; i++) {
+        predictor.prev2[i] = keyframe ? values[i] : predictor.prev[i];
+        predictor.prev[i] = values[i];
+    }
+    predictor.since_keyframe = keyframe ? 1 : predictor.since_keyframe + 1;
+}
+
+bool Logger::store_record(const uint32_t* values) {
+    size_t record_start = ram_writer.bits_written();
+    bool keyframe = compression == COMPRESSION_NONE || encoder.since_keyframe >= KEYFRAME_INTERVAL;
+    bool fits = compression == COMPRESSION_NONE || ram_writer.write(keyframe, 1);
+
+    for (uint8_t i = 0; i < channel_count && fits; i++) {
+        if (keyframe) {
+            fits = ram_writer.write(values[i], field_bits(signal_registry[channel_ids[i]]));
+        } else {
+            int32_t residual = static_cast<int32_t>(values[i]) - static_cast<int32_t>(predict(encoder, i));
+            fits = ram_writer.write_exp_golomb(bit_packer::zigzag_encode(residual));
+        }
+    }
+
+    // Uncompressed records stay byte aligned, record_size bytes each
+    if (compression == COMPRESSION_NONE && fits) {
+        fits = ram_writer.write(0, (8 - ram_writer.bits_written() % 8) % 8);
+    }
+
+    if (!fits) {
+        ram_writer.rewind(record_start);
+        return false;
+    }
+
+    push_prediction(encoder, values, keyframe);
+    addr_offset = (ram_writer.bits_written() + 7) / 8;
+    return true;
+}
+
+void Logger::read_record(bit_packer::Reader& reader, Predictor& predictor, uint32_t* values) const {
+    bool keyframe = compression == COMPRESSION_NONE || reader.read(1);
+
+    for (uint8_t i = 0; i < channel_count; i++) {
+        if (keyframe) {
+            values[i] = reader.read(field_bits(signal_registry[channel_ids[i]]));
+        } else {
+            values[i] = predict(predictor, i) + bit_packer::zigzag_decode(reader.read_exp_golomb());
+        }
+    }
+
+    if (compression == COMPRESSION_NONE) {
+        reader.read((8 - reader.bits_read() % 8) % 8);
+    }
+
+    push_prediction(predictor, values, keyframe);
+}
+
+uint8_t Logger::active_triggers() {
+    uint8_t conditions = 0;
+
+    if (Control::instance()->is_emergency()) {
+        conditions |= TRIGGER_EMERGENCY;
+    }
+    if (Navigation::instance()->is_wall_break_detected()) {
+        conditions |= TRIGGER_WALL_BREAK;
+    }
+    if (Navigation::instance()->get_current_movement() == trigger_config.movement) {
+        conditions |= TRIGGER_MOVEMENT;
+    }
+    if (std::abs(bsp::encoders::get_filtered_velocity_m_s()) > trigger_config.speed_m_s) {
+        conditions |= TRIGGER_SPEED;
+    }
+
+    uint8_t rising = conditions & ~prev_conditions;
+    prev_conditions = conditions;
+
+    if (command_trigger) {
+        command_trigger = false;
+        rising |= TRIGGER_COMMAND;
+    }
+
+    return rising & trigger_config.sources;
+}
+
+void Logger::store_ring_record(const uint32_t* values) {
+    bit_packer::Writer writer(ram_logger + ring_head * record_size, record_size);
+    for (uint8_t i = 0; i < channel_count; i++) {
+        writer.write(values[i], field_bits(signal_registry[channel_ids[i]]));
+    }
+
+    ring_head = (ring_head + 1) % ring_capacity;
+    ring_count = std::min(ring_count + 1, ring_capacity);
+
+    if (fired_source == 0) {
+        fired_source = active_triggers();
+        post_remaining = trigger_config.post_ms / RECORD_PERIOD_MS;
+        if (fired_source != 0) {
+            log_event(EVENT_TRIGGER, fired_source);
+        }
+    } else {
+        records_since_trigger++;
+        post_remaining--;
+    }
+
+    if (fired_source != 0 && post_remaining == 0) {
+        finalize_ring();
+    }
+}
+
+void Logger::finalize_ring() {
+    if (trigger_config.sources == 0 || ring_finalized) {
+        return;
+    }
+
+    // Rotate the oldest record to the start so the capture reads like a linear one
+    if (ring_count == ring_capacity) {
+        std::rotate(ram_logger, ram_logger + ring_head * record_size, ram_logger + ring_capacity * record_size);
+    }
+
+    addr_offset = ring_count * record_size;
+    record_count = ring_count;
+    ram_full = true;
+    ring_finalized = true;
+}
+
 void Logger::update() {
+    if (ram_full && !streaming) {
+        return;
+    }
 
-    if (addr_offset + sizeof(logdata) >= sizeof(ram_logger)) {
+    uint32_t values[static_cast<size_t>(ParamIndex::COUNT)];
+    for (uint8_t i = 0; i < channel_count; i++) {
+        const auto& signal = signal_registry[channel_ids[i]];
+        values[i] = static_cast<uint32_t>(encode_value(signal.getter(), signal.info));
+    }
+
+    if (streaming) {
+        uint8_t record[MAX_RECORD_SIZE];
+        bit_packer::Writer writer(record, record_size);
+        for (uint8_t i = 0; i < channel_count; i++) {
+            writer.write(values[i], field_bits(signal_registry[channel_ids[i]]));
+        }
+
+        // Repeat the schema so a host that attaches mid-run can still decode
+        if (++records_since_schema >= STREAM_SCHEMA_PERIOD) {
+            send_stream_schema();
+        }
+        send_stream_frame(STREAM_RECORD, record, record_size);
+    }
+
+    if (ram_full) {
         return;
     }
 
-    auto control = services::Control::instance();
-    auto nav = services::Navigation::instance();
-
-    auto& current_log_entry = logdata[log_data_idx].fields;
-
-    current_log_entry.velocity_ms = encode_value(bsp::encoders::get_filtered_velocity_m_s(),
-                                                 paramInfoArray[static_cast<size_t>(ParamIndex::VelocityMS)]);
-    current_log_entry.target_velocity_ms = encode_value(
-        control->get_target_linear_speed(), paramInfoArray[static_cast<size_t>(ParamIndex::TargetVelocityMS)]);
-    current_log_entry.angular_speed_rad_s =
-        encode_value(bsp::imu::get_rad_per_s(), paramInfoArray[static_cast<size_t>(ParamIndex::AngularSpeedRadS)]);
-    current_log_entry.target_rad_s =
-        encode_value(control->get_target_angular_speed(), paramInfoArray[static_cast<size_t>(ParamIndex::TargetRadS)]);
-    current_log_entry.pwm_left =
-        encode_value(control->get_pwm_duty_l(), paramInfoArray[static_cast<size_t>(ParamIndex::PwmLeft)]);
-    current_log_entry.pwm_right =
-        encode_value(control->get_pwm_duty_r(), paramInfoArray[static_cast<size_t>(ParamIndex::PwmRight)]);
-    current_log_entry.encoder_imu_diff =
-        encode_value(nav->get_encoder_imu_diff(), paramInfoArray[static_cast<size_t>(ParamIndex::EncoderImuDiff)]);
-#if CONTROL_LOG_MODE
-    current_log_entry.vel_p = encode_value(control->get_vel_pid().kp * control->get_vel_pid().previous_error,
-                                           paramInfoArray[static_cast<size_t>(ParamIndex::VelP)]);
-    current_log_entry.vel_i = encode_value(control->get_vel_pid().ki * control->get_vel_pid().integral,
-                                           paramInfoArray[static_cast<size_t>(ParamIndex::VelI)]);
-    current_log_entry.ang_p = encode_value(control->get_ang_vel_pid().kp * control->get_ang_vel_pid().previous_error,
-                                           paramInfoArray[static_cast<size_t>(ParamIndex::AngP)]);
-    current_log_entry.ang_i = encode_value(control->get_ang_vel_pid().ki * control->get_ang_vel_pid().integral,
-                                           paramInfoArray[static_cast<size_t>(ParamIndex::AngI)]);
-    current_log_entry.rotation_ff =
-        encode_value(control->get_rotation_ff(), paramInfoArray[static_cast<size_t>(ParamIndex::RotationFF)]);
-
-    current_log_entry.linear_ff =
-        encode_value(control->get_linear_ff(), paramInfoArray[static_cast<size_t>(ParamIndex::LinearFF)]);
-#else
-    current_log_entry.battery = encode_value(bsp::analog_sensors::battery_latest_reading_mv(),
-                                             paramInfoArray[static_cast<size_t>(ParamIndex::Battery)]);
-    current_log_entry.position_mm_x =
-        encode_value(nav->get_robot_position_mm().x, paramInfoArray[static_cast<size_t>(ParamIndex::PositionX)]);
-    current_log_entry.position_mm_y =
-        encode_value(nav->get_robot_position_mm().y, paramInfoArray[static_cast<size_t>(ParamIndex::PositionY)]);
-    const float angle_deg = bsp::imu::get_angle() * ((180.0f / M_PI));
-    current_log_entry.angle = encode_value(angle_deg, paramInfoArray[static_cast<size_t>(ParamIndex::Angle)]);
-
-    current_log_entry.distance =
-        encode_value(nav->get_robot_travelled_dist_mm(), paramInfoArray[static_cast<size_t>(ParamIndex::Distance)]);
-#endif
-
-    // --- Buffer Management ---
-    log_data_idx++;
-    if (log_data_idx >= std::size(logdata)) {
-        log_data_idx = 0;
-        memcpy(ram_logger + addr_offset, reinterpret_cast<uint8_t*>(logdata), sizeof(logdata));
-        addr_offset += sizeof(logdata);
+    // Only stored records count, the events refer to them
+    if (trigger_config.sources != 0) {
+        store_ring_record(values);
+        total_records++;
+    } else if (store_record(values)) {
+        record_count++;
+        total_records++;
+    } else {
+        ram_full = true;
     }
 }
 
 void Logger::print_log() {
-#if CONTROL_LOG_MODE
-    std::printf("t;Vel;TgtVel;AngVel;TgtAngVel;PWM_L;PWM_R;ImuDiff;VelP;VelI;AngP;AngI;RotFF;LinFF\r\n");
-#else
-    std::printf("t;Vel;TgtVel;AngVel;TgtAngVel;PWM_L;PWM_R;ImuDiff;Batt_mV;PosX;PosY;Angle;Dist\r\n");
-#endif
+    finalize_ring();
+
+    char line[256];
+    int len = std::snprintf(line, sizeof(line), "t");
+    for (uint8_t i = 0; i < channel_count; i++) {
+        len += std::snprintf(line + len, sizeof(line) - len, ";%s", signal_registry[channel_ids[i]].name);
+    }
+    std::printf("%s\r\n", line);
     bsp::delay_ms(5);
 
-    uint32_t saved_size = addr_offset;
+    bit_packer::Reader reader(ram_logger, addr_offset);
+    Predictor decoder;
+    decoder.since_keyframe = 0;
+    uint16_t event = 0;
+
+    for (uint32_t idx = 0; idx <= record_count; idx++) {
+        // Events go right before the record that followed them, as "#tag;arg;value" lines
+        for (; event < event_count && event_at(event).record <= first_record() + idx; event++) {
+            const LogEvent& entry = event_at(event);
+            if (entry.record < first_record()) {
+                continue;
+            }
+            std::printf("#%lu;%u;%u;%d\r\n", static_cast<unsigned long>(idx), entry.tag, entry.arg, entry.value);
+            bsp::delay_ms(3);
+        }
 
-    for (uint16_t i = 0; i < saved_size; i += sizeof(LogData)) {
-        LogData read_logdata;
-        if (i + sizeof(read_logdata.data) > sizeof(ram_logger)) {
+        if (idx == record_count) {
             break;
         }
 
-        memcpy(read_logdata.data, ram_logger + i, sizeof(read_logdata.data));
-        uint16_t idx = i / sizeof(LogData);
-
-#if CONTROL_LOG_MODE
-        std::printf(
-            "%d;%0.4f;%0.4f;%0.4f;%0.4f;%0.f;%0.f;%0.4f;%0.4f;%0.4f;%0.4f;%0.4f;%0.4f;%0.4f\r\n", idx,
-            decode_value(read_logdata.fields.velocity_ms, paramInfoArray[static_cast<size_t>(ParamIndex::VelocityMS)]),
-            decode_value(read_logdata.fields.target_velocity_ms,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::TargetVelocityMS)]),
-            decode_value(read_logdata.fields.angular_speed_rad_s,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::AngularSpeedRadS)]),
-            decode_value(read_logdata.fields.target_rad_s, paramInfoArray[static_cast<size_t>(ParamIndex::TargetRadS)]),
-            decode_value(read_logdata.fields.pwm_left, paramInfoArray[static_cast<size_t>(ParamIndex::PwmLeft)]),
-            decode_value(read_logdata.fields.pwm_right, paramInfoArray[static_cast<size_t>(ParamIndex::PwmRight)]),
-            decode_value(read_logdata.fields.encoder_imu_diff,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::EncoderImuDiff)]),
-            decode_value(read_logdata.fields.vel_p, paramInfoArray[static_cast<size_t>(ParamIndex::VelP)]),
-            decode_value(read_logdata.fields.vel_i, paramInfoArray[static_cast<size_t>(ParamIndex::VelI)]),
-            decode_value(read_logdata.fields.ang_p, paramInfoArray[static_cast<size_t>(ParamIndex::AngP)]),
-            decode_value(read_logdata.fields.ang_i, paramInfoArray[static_cast<size_t>(ParamIndex::AngI)]),
-            decode_value(read_logdata.fields.rotation_ff, paramInfoArray[static_cast<size_t>(ParamIndex::RotationFF)]),
-            decode_value(read_logdata.fields.linear_ff, paramInfoArray[static_cast<size_t>(ParamIndex::LinearFF)]));
-#else
-        std::printf(
-            "%d;%0.4f;%0.4f;%0.4f;%0.4f;%0.f;%0.f;%0.f;%0.4f;%0.4f;%0.4f;%0.4f;%0.4f\r\n", idx,
-            decode_value(read_logdata.fields.velocity_ms, paramInfoArray[static_cast<size_t>(ParamIndex::VelocityMS)]),
-            decode_value(read_logdata.fields.target_velocity_ms,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::TargetVelocityMS)]),
-            decode_value(read_logdata.fields.angular_speed_rad_s,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::AngularSpeedRadS)]),
-            decode_value(read_logdata.fields.target_rad_s, paramInfoArray[static_cast<size_t>(ParamIndex::TargetRadS)]),
-            decode_value(read_logdata.fields.pwm_left, paramInfoArray[static_cast<size_t>(ParamIndex::PwmLeft)]),
-            decode_value(read_logdata.fields.pwm_right, paramInfoArray[static_cast<size_t>(ParamIndex::PwmRight)]),
-            decode_value(read_logdata.fields.encoder_imu_diff,
-                         paramInfoArray[static_cast<size_t>(ParamIndex::EncoderImuDiff)]),
-            decode_value(read_logdata.fields.battery, paramInfoArray[static_cast<size_t>(ParamIndex::Battery)]),
-            decode_value(read_logdata.fields.position_mm_x, paramInfoArray[static_cast<size_t>(ParamIndex::PositionX)]),
-            decode_value(read_logdata.fields.position_mm_y, paramInfoArray[static_cast<size_t>(ParamIndex::PositionY)]),
-            decode_value(read_logdata.fields.angle, paramInfoArray[static_cast<size_t>(ParamIndex::Angle)]),
-            decode_value(read_logdata.fields.distance, paramInfoArray[static_cast<size_t>(ParamIndex::Distance)]));
-#endif
+        uint32_t values[static_cast<size_t>(ParamIndex::COUNT)];
+        read_record(reader, decoder, values);
+
+        len = std::snprintf(line, sizeof(line), "%lu", static_cast<unsigned long>(idx));
+        for (uint8_t i = 0; i < channel_count && len < static_cast<int>(sizeof(line)); i++) {
+            float value = decode_value(values[i], signal_registry[channel_ids[i]].info);
+            len += std::snprintf(line + len, sizeof(line) - len, ";%0.4f", value);
+        }
+        std::printf("%s\r\n", line);
 
         bsp::delay_ms(3);
     }
 }
 
+void Logger::prepare_dump(DumpImage& image) {
+    begin_dump(image);
+
+    uint32_t crc = 0;
+    uint8_t chunk[64];
+    for (uint32_t offset = 0; offset < image.size - sizeof(crc); offset += sizeof(chunk)) {
+        uint32_t len = std::min<uint32_t>(sizeof(chunk), image.size - sizeof(crc) - offset);
+        read_dump(image, offset, chunk, len);
+        crc = crc::crc32(chunk, len, crc);
+    }
+    image.crc = crc;
+}
+
+void Logger::begin_dump(DumpImage& image) {
+    finalize_ring();
+
+    DumpHeader& header = image.header;
+    memcpy(header.magic, DUMP_MAGIC, sizeof(header.magic));
+    header.schema_version = DUMP_SCHEMA_VERSION;
+    header.record_size = record_size;
+    header.channel_count = channel_count;
+    header.compression = compression;
+    header.record_count = record_count;
+    header.payload_size = addr_offset;
+    bool trigger_kept = fired_source != 0 && records_since_trigger < record_count;
+    header.trigger_record = trigger_kept ? record_count - 1 - records_since_trigger : NO_TRIGGER;
+    header.trigger_source = fired_source;
+    header.first_record = first_record();
+    header.run_number = run_number;
+
+    // Events from before a ring capture window are not dumped
+    image.first_event = 0;
+    while (image.first_event < event_count && event_at(image.first_event).record < header.first_record) {
+        image.first_event++;
+    }
+    header.event_count = event_count - image.first_event;
+
+    image.size = sizeof(DumpHeader) + channel_count * sizeof(SchemaEntry) + header.payload_size +
+                 header.event_count * sizeof(LogEvent) + sizeof(image.crc);
+    image.crc = 0;
+}
+
+void Logger::begin_truncate(const DumpImage& image, TruncateCursor& cursor) const {
+    cursor.reader = bit_packer::Reader(ram_logger, addr_offset);
+    cursor.decoder.since_keyframe = 0;
+    cursor.kept = 0;
+    cursor.kept_size = 0;
+    cursor.events_end = image.first_event;
+}
+
+bool Logger::truncate_step(DumpImage& image, TruncateCursor& cursor, uint32_t max_size, uint32_t max_records) const {
+    // Keep the first records, with their events, that fit in max_size
+    DumpHeader& header = image.header;
+    uint32_t fixed_size = sizeof(DumpHeader) + channel_count * sizeof(SchemaEntry) + sizeof(image.crc);
+    bool full = false;
+
+    for (uint32_t i = 0; i < max_records && cursor.kept < header.record_count; i++) {
+        uint32_t values[static_cast<size_t>(ParamIndex::COUNT)];
+        read_record(cursor.reader, cursor.decoder, values);
+        uint32_t payload_size = (cursor.reader.bits_read() + 7) / 8;
+
+        uint16_t events = cursor.events_end;
+        while (events < event_count && event_at(events).record <= header.first_record + cursor.kept) {
+            events++;
+        }
+
+        if (fixed_size + payload_size + (events - image.first_event) * sizeof(LogEvent) > max_size) {
+            full = true;
+            break;
+        }
+
+        cursor.kept++;
+        cursor.kept_size = payload_size;
+        cursor.events_end = events;
+    }
+
+    if (!full && cursor.kept < header.record_count) {
+        return false;
+    }
+
+    if (header.trigger_record != NO_TRIGGER && header.trigger_record >= cursor.kept) {
+        header.trigger_record = NO_TRIGGER;
+    }
+    header.record_count = cursor.kept;
+    header.payload_size = cursor.kept_size;
+    header.event_count = cursor.events_end - image.first_event;
+    image.size = fixed_size + cursor.kept_size + header.event_count * sizeof(LogEvent);
+    return true;
+}
+
+void Logger::read_dump(const DumpImage& image, uint32_t offset, uint8_t* out, uint32_t len) const {
+    // Walk the dump sections in order, copying the part of each that overlaps [offset, offset + len)
+    auto copy = [&](const void* section, uint32_t size) {
+        if (offset >= size) {
+            offset -= size;
+            return;
+        }
+
+        uint32_t chunk = std::min(size - offset, len);
+        memcpy(out, static_cast<const uint8_t*>(section) + offset, chunk);
+        out += chunk;
+        len -= chunk;
+        offset = 0;
+    };
+
+    SchemaEntry schema[static_cast<size_t>(ParamIndex::COUNT)];
+    size_t schema_count = fill_schema(schema);
+
+    copy(&image.header, sizeof(image.header));
+    copy(schema, schema_count * sizeof(SchemaEntry));
+    copy(ram_logger, image.header.payload_size);
+
+    uint16_t skipped = std::min<uint32_t>(offset / sizeof(LogEvent), image.header.event_count);
+    offset -= skipped * sizeof(LogEvent);
+    for (uint16_t i = skipped; i < image.header.event_count && len > 0; i++) {
+        copy(&event_at(image.first_event + i), sizeof(LogEvent));
+    }
+
+    copy(&image.crc, sizeof(image.crc));
+}
+
+bool Logger::dump_log() {
+    DumpImage image;
+    prepare_dump(image);
+
+    uint8_t chunk[256];
+    for (uint32_t offset = 0; offset < image.size; offset += sizeof(chunk)) {
+        uint32_t len = std::min<uint32_t>(sizeof(chunk), image.size - offset);
+        read_dump(image, offset, chunk, len);
+        if (!bsp::usb::write_blocking(chunk, len, DUMP_TIMEOUT_MS)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Logger::dump_stored() {
+    if (!load_directory()) {
+        return false;
+    }
+
+    // The stored images are complete dumps, they go out byte for byte
+    uint8_t chunk[128];
+    for (uint8_t run = 0; run < directory.run_count; run++) {
+        const StoredRun& stored = directory.runs[run];
+        for (uint32_t offset = 0; offset < stored.size; offset += sizeof(chunk)) {
+            uint16_t len = std::min<uint32_t>(sizeof(chunk), stored.size - offset);
+            if (bsp::eeprom::read_array(stored.address + offset, chunk, len) != bsp::eeprom::OK ||
+                !bsp::usb::write_blocking(chunk, len, DUMP_TIMEOUT_MS)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Logger::has_capture() const {
+    return record_count > 0 || ring_count > 0;
+}
+
+void Logger::set_persistence(bool enabled) {
+    persistence = enabled;
+}
+
+bool Logger::is_persisting() const {
+    return persist_state != PERSIST_IDLE;
+}
+
+bool Logger::load_directory() {
+    if (directory_loaded) {
+        return true;
+    }
+
+    if (bsp::eeprom::read_array(bsp::eeprom::ADDR_LOG_DIRECTORY, reinterpret_cast<uint8_t*>(&directory),
+                                sizeof(directory)) != bsp::eeprom::OK) {
+        return false;
+    }
+
+    // A blank or torn directory starts the storage over
+    uint32_t crc = crc::crc32(reinterpret_cast<const uint8_t*>(&directory), offsetof(LogDirectory, crc));
+    if (memcmp(directory.magic, DIRECTORY_MAGIC, sizeof(directory.magic)) != 0 || crc != directory.crc ||
+        directory.run_count > MAX_STORED_RUNS) {
+        memset(&directory, 0, sizeof(directory));
+        memcpy(directory.magic, DIRECTORY_MAGIC, sizeof(directory.magic));
+        directory.next_run = 1; // 0 is a capture that was not stored
+    }
+
+    directory_loaded = true;
+    return true;
+}
+
+bool Logger::write_directory() {
+    directory.crc = crc::crc32(reinterpret_cast<const uint8_t*>(&directory), offsetof(LogDirectory, crc));
+    if (bsp::eeprom::write_queued(bsp::eeprom::ADDR_LOG_DIRECTORY, reinterpret_cast<const uint8_t*>(&directory),
+                                  sizeof(directory), on_persist_written) != bsp::eeprom::OK) {
+        return false;
+    }
+
+    persist_pending++;
+    return true;
+}
+
+void Logger::on_persist_written(bsp::eeprom::EepromResult result) {
+    Logger* logger = instance();
+    logger->persist_pending--;
+    if (result != bsp::eeprom::OK) {
+        logger->persist_failed = true;
+    }
+}
+
+void Logger::persist_step() {
+    if (persist_state == PERSIST_IDLE) {
+        return;
+    }
+
+    // A run with a failed page is never added to the directory
+    if (persist_failed) {
+        persist_state = PERSIST_IDLE;
+        return;
+    }
+
+    constexpr uint32_t data_start = bsp::eeprom::ADDR_LOG_DATA_START;
+    constexpr uint32_t data_end = bsp::eeprom::ADDR_MAX + 1;
+    constexpr uint32_t page_size = bsp::eeprom::PAGE_SIZE;
+
+    switch (persist_state) {
+    case PERSIST_PREPARE:
+        begin_dump(persist_image);
+        if (persist_image.size > data_end - data_start) {
+            begin_truncate(persist_image, persist_cursor);
+            persist_state = PERSIST_TRUNCATE;
+        } else {
+            persist_offset = 0;
+            persist_state = PERSIST_CRC;
+        }
+        break;
+
+    case PERSIST_TRUNCATE:
+        if (truncate_step(persist_image, persist_cursor, data_end - data_start, PERSIST_STEP_RECORDS)) {
+            persist_offset = 0;
+            persist_state = PERSIST_CRC;
+        }
+        break;
+
+    case PERSIST_CRC: {
+        uint8_t chunk[64];
+        uint32_t crc_size = persist_image.size - sizeof(persist_image.crc);
+        uint32_t crc_end = std::min(crc_size, persist_offset + PERSIST_STEP_CRC_BYTES);
+        while (persist_offset < crc_end) {
+            uint32_t len = std::min<uint32_t>(sizeof(chunk), crc_end - persist_offset);
+            read_dump(persist_image, persist_offset, chunk, len);
+            persist_image.crc = crc::crc32(chunk, len, persist_image.crc);
+            persist_offset += len;
+        }
+
+        if (persist_offset == crc_size) {
+            persist_state = PERSIST_RELEASE;
+        }
+        break;
+    }
+
+    case PERSIST_RELEASE: {
+        if (bsp::eeprom::queue_free_pages() <= PERSIST_QUEUE_RESERVE) {
+            break;
+        }
+
+        // Runs are stored one after the other from a page boundary, wrapping to the start of the region
+        uint32_t address = data_start;
+        if (directory.run_count > 0) {
+            const StoredRun& newest = directory.runs[directory.run_count - 1];
+            address = (newest.address + newest.size + page_size - 1) / page_size * page_size;
+        }
+        if (address + persist_image.size > data_end) {
+            address = data_start;
+        }
+
+        uint8_t kept = 0;
+        for (uint8_t i = 0; i < directory.run_count; i++) {
+            const StoredRun& run = directory.runs[i];
+            bool overlaps = run.address < address + persist_image.size && address < run.address + run.size;
+            if (!overlaps) {
+                directory.runs[kept++] = run;
+            }
+        }
+        directory.run_count = kept;
+
+        persist_address = address;
+        persist_offset = 0;
+        persist_state = write_directory() ? PERSIST_DATA : PERSIST_IDLE;
+        break;
+    }
+
+    case PERSIST_DATA: {
+        uint8_t page[page_size];
+        while (persist_offset < persist_image.size && bsp::eeprom::queue_free_pages() > PERSIST_QUEUE_RESERVE) {
+            uint32_t address = persist_address + persist_offset;
+            uint32_t len = std::min(page_size - address % page_size, persist_image.size - persist_offset);
+            read_dump(persist_image, persist_offset, page, len);
+            if (bsp::eeprom::write_queued(address, page, len, on_persist_written) != bsp::eeprom::OK) {
+                break;
+            }
+            persist_pending++;
+            persist_offset += len;
+        }
+
+        if (persist_offset == persist_image.size) {
+            persist_state = PERSIST_COMMIT;
+        }
+        break;
+    }
+
+    case PERSIST_COMMIT: {
+        // The directory entry goes in once every page of the run is stored
+        if (persist_pending > 0 || bsp::eeprom::queue_free_pages() == 0) {
+            break;
+        }
+
+        if (directory.run_count == MAX_STORED_RUNS) {
+            std::copy(directory.runs + 1, directory.runs + MAX_STORED_RUNS, directory.runs);
+            directory.run_count--;
+        }
+        directory.runs[directory.run_count++] = {
+            persist_image.header.run_number,
+            persist_address,
+            static_cast<uint16_t>(persist_image.size),
+        };
+        write_directory();
+        persist_state = PERSIST_IDLE;
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
 void Logger::send_log_ble() {
+    finalize_ring();
 
-    #if CONTROL_LOG_MODE
-    #else
-    uint32_t saved_size = addr_offset;
-    uint8_t packet[19] = {0};
+    uint8_t packet[bsp::ble::max_packet_size] = {0};
     packet[0] = bsp::ble::header;
-    packet[1] = bsp::ble::BlePacketType::RequestLogData;
 
-    for (uint16_t i = 0; i < saved_size; i += sizeof(LogData)) {
-        LogData read_logdata;
-        if (i + sizeof(read_logdata.data) > sizeof(ram_logger)) {
-            break;
+    // Raw records that fit a packet keep the RequestLogData framing the app reads, one record per packet
+    constexpr uint32_t record_payload = sizeof(packet) - 2;
+    if (compression == COMPRESSION_NONE && record_size <= record_payload) {
+        packet[1] = bsp::ble::BlePacketType::RequestLogData;
+
+        for (uint32_t i = 0; i + record_size <= addr_offset; i += record_size) {
+            memcpy(packet + 2, ram_logger + i, record_size);
+
+            bsp::ble::transmit(packet, 2 + record_size);
+            bsp::delay_ms(5);
         }
+        return;
+    }
 
-        memcpy(packet + 2, ram_logger + i, 17);
+    // Any other layout goes out as the USB dump image in LogDumpData packets, so it can't be mistaken for
+    // records. The joined chunks decode with scripts/dump_log_usb.py
+    DumpImage image;
+    prepare_dump(image);
 
-        bsp::ble::transmit(packet, sizeof(packet));
+    packet[1] = bsp::ble::BlePacketType::LogDumpData;
+    constexpr uint32_t chunk_payload = sizeof(packet) - 4;
+    uint16_t sequence = 0;
+
+    for (uint32_t offset = 0; offset < image.size; offset += chunk_payload) {
+        uint32_t len = std::min(chunk_payload, image.size - offset);
+        packet[2] = sequence & 0xFF;
+        packet[3] = sequence >> 8;
+        read_dump(image, offset, packet + 4, len);
+
+        bsp::ble::transmit(packet, 4 + len);
         bsp::delay_ms(5);
+        sequence++;
     }
-    #endif
-
 }
 }
@@ -7,8 +7,11 @@
 
 #include "bsp/eeprom.hpp"
 #include "bsp/timers.hpp"
+#include "services/logger.hpp"
 #include "services/maze.hpp"
 #include "utils/RingBuffer.hpp"
+#include "utils/bit_packer.hpp"
+#include "utils/crc.hpp"
 #include "utils/math.hpp"
 
 namespace services {
@@ -28,6 +31,7 @@ void Maze::reset() {
             map[x][y].walls = 0;
             map[x][y].known_walls = 0;
             map[x][y].distance = 255;
+            std::memset(map[x][y].confidence, 0, sizeof(map[x][y].confidence));
             map[x][y].north = nullptr;
             map[x][y].east = nullptr;
             map[x][y].south = nullptr;
@@ -36,6 +40,7 @@ void Maze::reset() {
             map_backup[x][y].walls = 0;
             map_backup[x][y].known_walls = 0;
             map_backup[x][y].distance = 255;
+            std::memset(map_backup[x][y].confidence, 0, sizeof(map_backup[x][y].confidence));
             map_backup[x][y].north = nullptr;
             map_backup[x][y].east = nullptr;
             map_backup[x][y].south = nullptr;
@@ -73,6 +78,8 @@ void Maze::reset() {
                 cell.known_walls |= Walls::W;
                 cell_backup.walls |= Walls::W;
                 cell_backup.known_walls |= Walls::W;
+                cell.confidence[std::to_underlying(Direction::WEST)] = algorithm::WALL_CONFIDENCE_LOCKED;
+                cell_backup.confidence[std::to_underlying(Direction::WEST)] = algorithm::WALL_CONFIDENCE_LOCKED;
             }
 
             if (x == CELLS_X - 1) {
@@ -80,6 +87,8 @@ void Maze::reset() {
                 cell.known_walls |= Walls::E;
                 cell_backup.walls |= Walls::E;
                 cell_backup.known_walls |= Walls::E;
+                cell.confidence[std::to_underlying(Direction::EAST)] = algorithm::WALL_CONFIDENCE_LOCKED;
+                cell_backup.confidence[std::to_underlying(Direction::EAST)] = algorithm::WALL_CONFIDENCE_LOCKED;
             }
 
             if (y == 0) {
@@ -87,6 +96,8 @@ void Maze::reset() {
                 cell.known_walls |= Walls::S;
                 cell_backup.walls |= Walls::S;
                 cell_backup.known_walls |= Walls::S;
+                cell.confidence[std::to_underlying(Direction::SOUTH)] = algorithm::WALL_CONFIDENCE_LOCKED;
+                cell_backup.confidence[std::to_underlying(Direction::SOUTH)] = algorithm::WALL_CONFIDENCE_LOCKED;
             }
 
             if (y == CELLS_Y - 1) {
@@ -94,6 +105,8 @@ void Maze::reset() {
                 cell.known_walls |= Walls::N;
                 cell_backup.walls |= Walls::N;
                 cell_backup.known_walls |= Walls::N;
+                cell.confidence[std::to_underlying(Direction::NORTH)] = algorithm::WALL_CONFIDENCE_LOCKED;
+                cell_backup.confidence[std::to_underlying(Direction::NORTH)] = algorithm::WALL_CONFIDENCE_LOCKED;
             }
         }
     }
@@ -103,12 +116,13 @@ void Maze::reset() {
     map[0][0].known_walls = 0b1111;
 }
 
-Direction Maze::next_step(Point const& current_position, uint8_t walls, Point const& target, bool search_mode) {
+Direction Maze::next_step(Point const& current_position, uint8_t walls, Point const& target, bool search_mode,
+                          std::array<uint8_t, 4> const& confidence) {
     algorithm::Cell& cell = map[current_position.x][current_position.y];
 
     if (target == current_position) {
         if (search_mode) {
-            cell.update_walls(walls);
+            cell.update_walls(walls, confidence);
         }
         return Direction::STOP;
     }
@@ -120,11 +134,13 @@ Direction Maze::next_step(Point const& current_position, uint8_t walls, Point co
 
     // Update our grid
     if (search_mode) {
-        cell.update_walls(walls);
+        cell.update_walls(walls, confidence);
     }
 
     // Recalculate the distances
+    uint32_t start_us = bsp::get_tick_us();
     algorithm::flood_fill(map, target, search_mode);
+    log_flood_fill(start_us);
 
     if (map[current_position.x][current_position.y].distance == 255) {
         // Unreachable
@@ -176,7 +192,9 @@ Direction Maze::next_step(Point const& current_position, uint8_t walls, Point co
 }
 
 Point Maze::closest_unvisited(Point const& current_position) {
+    uint32_t start_us = bsp::get_tick_us();
     algorithm::flood_fill(map, current_position, true);
+    log_flood_fill(start_us);
 
     int closest_dist = 255;
     auto closest_point = ORIGIN;
@@ -231,40 +249,110 @@ std::vector<Direction> Maze::directions_to_goal() {
 }
 
 void Maze::save_maze_to_memory(bool backup) {
-    uint8_t data[4];
+    auto& grid = backup ? map_backup : map;
+    uint8_t image[MAZE_IMAGE_SIZE] = {};
+    std::memcpy(image, MAZE_MAGIC, sizeof(MAZE_MAGIC));
+    image[sizeof(MAZE_MAGIC)] = MAZE_FORMAT_VERSION;
+
+    bit_packer::Writer writer(image + MAZE_HEADER_SIZE, MAZE_DATA_SIZE);
+    for_each_wall(grid, [&](algorithm::Cell& cell, Direction d) {
+        uint8_t idx = std::to_underlying(d);
+        writer.write((cell.known_walls >> idx) & 1, 1);
+        writer.write((cell.walls >> idx) & 1, 1);
+        writer.write(confidence_level(cell.confidence[idx]), 2);
+    });
+
+    uint32_t crc = crc::crc32(image, MAZE_IMAGE_SIZE - sizeof(crc));
+    std::memcpy(image + MAZE_IMAGE_SIZE - sizeof(crc), &crc, sizeof(crc));
+
+    // Stored in the background, blocking only when the EEPROM queue is full
+    auto base_addr = backup ? bsp::eeprom::param_addresses_t::ADDR_MAZE_BACKUP_START
+                            : bsp::eeprom::param_addresses_t::ADDR_MAZE_START;
+    if (bsp::eeprom::write_queued(base_addr, image, sizeof(image)) == bsp::eeprom::BUSY) {
+        bsp::eeprom::write_array(base_addr, image, sizeof(image));
+    }
+}
+
+uint8_t Maze::confidence_level(uint8_t confidence) {
+    // Level 3 is only kept by locked walls
+    return confidence == algorithm::WALL_CONFIDENCE_LOCKED ? 3 : std::min(confidence / 85, 2);
+}
+
+uint8_t Maze::level_confidence(uint8_t level) {
+    return level * 85;
+}
+
+template <typename F>
+void Maze::for_each_wall(algorithm::Grid<CELLS_X, CELLS_Y>& grid, F&& visit) {
+    // Each wall once: the north and east side of every cell, then the west and south borders
     for (int x = 0; x < CELLS_X; x++) {
         for (int y = 0; y < CELLS_Y; y++) {
-            auto& cell = backup ? map_backup[x][y] : map[x][y];
-            data[0] = cell.walls;
-            data[1] = cell.known_walls;
-            data[2] = cell.distance;
-            data[3] = 0;
-            auto base_addr = backup ? bsp::eeprom::param_addresses_t::ADDR_MAZE_BACKUP_START
-                                    : bsp::eeprom::param_addresses_t::ADDR_MAZE_START;
-            bsp::eeprom::write_u32(base_addr + 4 * (x * CELLS_Y + y), *(uint32_t*)data);
-            bsp::delay_ms(5);
+            visit(grid[x][y], Direction::NORTH);
+            visit(grid[x][y], Direction::EAST);
         }
     }
+
+    for (int y = 0; y < CELLS_Y; y++) {
+        visit(grid[0][y], Direction::WEST);
+    }
+
+    for (int x = 0; x < CELLS_X; x++) {
+        visit(grid[x][0], Direction::SOUTH);
+    }
+}
+
+void Maze::log_flood_fill(uint32_t start_us) {
+    uint32_t duration_us = std::min<uint32_t>(bsp::get_tick_us() - start_us, INT16_MAX);
+    Logger::instance()->log_event(Logger::EVENT_FLOOD_FILL, 0, static_cast<int16_t>(duration_us));
 }
 
 void Maze::create_maze_backup() {
     std::memcpy(map_backup, map, sizeof(map));
 }
 
-void Maze::read_maze_from_memory(bool backup) {
+bool Maze::read_maze_from_memory(bool backup) {
     this->reset();
-    uint8_t data[4];
+
+    uint8_t image[MAZE_IMAGE_SIZE];
     auto base_addr = backup ? bsp::eeprom::param_addresses_t::ADDR_MAZE_BACKUP_START
                             : bsp::eeprom::param_addresses_t::ADDR_MAZE_START;
-    for (int x = 0; x < CELLS_X; x++) {
-        for (int y = 0; y < CELLS_Y; y++) {
-            bsp::eeprom::read_u32(base_addr + 4 * (x * CELLS_Y + y), (uint32_t*)data);
-            map[x][y].walls = data[0];
-            map[x][y].known_walls = data[1];
-            map[x][y].distance = data[2];
-            bsp::delay_ms(5);
-        }
+    if (bsp::eeprom::read_array(base_addr, image, sizeof(image)) != bsp::eeprom::OK) {
+        return false;
     }
+
+    uint32_t crc;
+    std::memcpy(&crc, image + MAZE_IMAGE_SIZE - sizeof(crc), sizeof(crc));
+    if (std::memcmp(image, MAZE_MAGIC, sizeof(MAZE_MAGIC)) != 0 || image[sizeof(MAZE_MAGIC)] != MAZE_FORMAT_VERSION ||
+        crc != crc::crc32(image, MAZE_IMAGE_SIZE - sizeof(crc))) {
+        return false;
+    }
+
+    bit_packer::Reader reader(image + MAZE_HEADER_SIZE, MAZE_DATA_SIZE);
+    for_each_wall(map, [&](algorithm::Cell& cell, Direction d) {
+        bool known = reader.read(1);
+        bool wall = reader.read(1);
+        uint8_t confidence = level_confidence(reader.read(2));
+        if (!known) {
+            return;
+        }
+
+        auto store = [&](algorithm::Cell& side, uint8_t idx) {
+            uint8_t bit = 1 << idx;
+            side.walls = wall ? (side.walls | bit) : (side.walls & ~bit);
+            side.known_walls |= bit;
+            side.confidence[idx] = confidence;
+        };
+
+        uint8_t idx = std::to_underlying(d);
+        store(cell, idx);
+        if (algorithm::Cell* other = cell.neighbor(d)) {
+            store(*other, (idx + 2) % 4);
+        }
+    });
+
+    // Distances are not stored, compute the ones a run starts from
+    algorithm::flood_fill(map, GOAL_POSITIONS[0], false);
+    return true;
 }
 
 void Maze::print(Point const& curr) {
@@ -8,17 +8,24 @@
 #include "bsp/leds.hpp"
 #include "bsp/motors.hpp"
 #include "bsp/timers.hpp"
+#include "services/battery.hpp"
 #include "services/config.hpp"
+#include "services/logger.hpp"
 #include "services/navigation.hpp"
 #include "utils/math.hpp"
 #include "utils/movement_params.hpp"
+#include "utils/sample_bus.hpp"
 #include "utils/types.hpp"
 
 /// @section Constants
 
+// The IMU sample is up to one cycle old, don't project it further than two
+static constexpr uint32_t HEADING_MAX_EXTRAPOLATION_US = 2000;
+
 static std::map<Movement, TurnParams> turn_params;
 static std::map<Movement, ForwardParams> forward_params;
 static GeneralParams general_params;
+static GainSchedule gain_schedule;
 
 using bsp::leds::Color;
 
@@ -58,16 +65,19 @@ void Navigation::reset(navigation_mode_t mode) {
         turn_params = turn_params_search_slow;
         forward_params = forward_params_search_slow;
         general_params = general_params_search_slow;
+        gain_schedule = gain_schedule_search_slow;
         break;
     case SEARCH_MEDIUM:
         turn_params = turn_params_search_medium;
         forward_params = forward_params_search_medium;
         general_params = general_params_search_medium;
+        gain_schedule = gain_schedule_search_medium;
         break;
     case SEARCH_FAST:
         turn_params = turn_params_search_fast;
         forward_params = forward_params_search_fast;
         general_params = general_params_search_fast;
+        gain_schedule = gain_schedule_search_fast;
         break;
     case CUSTOM:
         turn_params = turn_params_custom;
@@ -99,30 +109,47 @@ void Navigation::reset(navigation_mode_t mode) {
             services::Config::start_wall_break_mm_right,
             services::Config::enable_wall_break_correction,
         };
+        gain_schedule = gain_schedule_flat;
         break;
     case SLOW:
         turn_params = turn_params_slow;
         forward_params = forward_params_slow;
         general_params = general_params_slow;
+        gain_schedule = gain_schedule_slow;
         break;
     case MEDIUM:
         turn_params = turn_params_medium;
         forward_params = forward_params_medium;
         general_params = general_params_medium;
+        gain_schedule = gain_schedule_medium;
         break;
     case FAST:
         turn_params = turn_params_fast;
         forward_params = forward_params_fast;
         general_params = general_params_fast;
+        gain_schedule = gain_schedule_fast;
         break;
     case SUPER:
         turn_params = turn_params_super;
         forward_params = forward_params_super;
         general_params = general_params_super;
+        gain_schedule = gain_schedule_super;
         break;
     }
 
-    control->reset(general_params);
+    // Fall back to the next slower profile if this one would pull the battery below its minimum mid-run
+    bool has_slower_profile = (mode == SEARCH_MEDIUM) || (mode == SEARCH_FAST) || (mode == MEDIUM) ||
+                              (mode == FAST) || (mode == SUPER);
+    Battery* battery = Battery::instance();
+    if (has_slower_profile && battery->is_initialized() &&
+        profile_peak_current_a() > battery->max_current_a(Battery::MIN_LOAD_VOLTS)) {
+        std::printf("Battery would sag to %.2fV, using a slower profile\r\n",
+                    battery->predict_volts(profile_peak_current_a()));
+        reset(static_cast<navigation_mode_t>(mode - 1));
+        return;
+    }
+
+    control->reset(general_params, gain_schedule);
 
     current_movement = Movement::START;
     previous_movement = Movement::START;
@@ -130,6 +157,19 @@ void Navigation::reset(navigation_mode_t mode) {
     forward_end_speed = forward_params[Movement::START].max_speed;
 }
 
+float Navigation::profile_peak_current_a() {
+    float peak_motor_current = 0.0f;
+
+    for (auto const& [movement, forward] : forward_params) {
+        float current = forward.acceleration * general_params.linear_vel_acc_feed_forward_k +
+                        forward.max_speed * general_params.linear_vel_feed_forward_k;
+        peak_motor_current = std::max(peak_motor_current, current);
+    }
+
+    // Both motors, with the drivers at full duty as the worst case
+    return 2.0f * peak_motor_current;
+}
+
 void Navigation::reset_movement_variables() {
     bsp::imu::reset_angle();
     mini_fsm_state = MiniFSMStates::FORWARD_1;
@@ -221,12 +261,23 @@ Navigation::WallBreak Navigation::process_wall_break() {
 void Navigation::update(void) {
     bsp::imu::update();
     bsp::encoders::update_ticks();
-    bsp::encoders::update_velocities();
+    if (!control->is_fast_loop_enabled()) {
+        bsp::encoders::update_velocities();
+    }
 
     bsp::encoders::EncoderData left_encoder = bsp::encoders::get_data(bsp::encoders::EncoderSide::LEFT);
     bsp::encoders::EncoderData right_encoder = bsp::encoders::get_data(bsp::encoders::EncoderSide::RIGHT);
+    bsp::imu::set_wheels_still(left_encoder.linear_vel_m_s == 0.0f && right_encoder.linear_vel_m_s == 0.0f);
     float measured_angle_rad = bsp::imu::get_angle();
 
+    // Bring the heading to the control instant with its recent rate
+    sample_bus::Sample heading_sample;
+    if (sample_bus::latest(sample_bus::HEADING, &heading_sample)) {
+        float heading_now =
+            sample_bus::value_at(sample_bus::HEADING, bsp::get_tick_us(), HEADING_MAX_EXTRAPOLATION_US);
+        measured_angle_rad = limit_angle_minus_pi_pi(measured_angle_rad + (heading_now - heading_sample.value));
+    }
+
     float estimated_delta_l_mm = (left_encoder.ticks * bsp::encoders::get_encoder_dist_mm_pulse());
     float estimated_delta_r_mm = (right_encoder.ticks * bsp::encoders::get_encoder_dist_mm_pulse());
 
@@ -311,6 +362,8 @@ bool Navigation::step() {
                 }
 
                 float distance_error_mm = current_movement_traveled - corrected_distance_mm;
+                Logger::instance()->log_event(Logger::EVENT_WALL_BREAK, wall_break == WallBreak::LEFT ? 0 : 1,
+                                              static_cast<int16_t>(distance_error_mm));
                 if (std::abs(distance_error_mm) < 60.0f) {
                     traveled_dist_mm = corrected_distance_mm;
                     // bsp::buzzer::start();
@@ -551,7 +604,7 @@ bool Navigation::step() {
             uint32_t elapsed_time = bsp::get_tick_ms() - reference_time;
             if (elapsed_time > 200) {
                 reference_time = bsp::get_tick_ms();
-                control->reset(general_params);
+                control->reset(general_params, gain_schedule);
                 control->set_motor_control_disabled(false);
                 traveled_dist_mm = 0;
                 mini_fsm_state = MiniFSMStates::TURN;
@@ -563,7 +616,7 @@ bool Navigation::step() {
             control->set_diagonal_pid_enabled(false);
             if (elapsed_time > 400) {
                 reference_time = bsp::get_tick_ms();
-                control->reset(general_params);
+                control->reset(general_params, gain_schedule);
                 control->set_motor_control_disabled(false);
                 traveled_dist_mm = 0;
 
@@ -617,6 +670,7 @@ void Navigation::set_movement(Direction dir) {
     target_direction = dir;
     current_movement = get_movement(dir, current_direction, true);
     reset_movement_variables();
+    Logger::instance()->log_event(Logger::EVENT_MOVEMENT, static_cast<uint8_t>(current_movement), 1);
 
     target_travel_mm = forward_params[current_movement].target_travel_mm;
 
@@ -677,6 +731,7 @@ void Navigation::set_movement(Movement movement, Movement prev_movement, Movemen
     previous_movement = prev_movement;
     current_movement = movement;
     reset_movement_variables();
+    Logger::instance()->log_event(Logger::EVENT_MOVEMENT, static_cast<uint8_t>(movement), count);
 
     if (movement == Movement::FORWARD || movement == Movement::DIAGONAL) {
         if (waiting_for_fast_param) {
@@ -685,10 +740,12 @@ void Navigation::set_movement(Movement movement, Movement prev_movement, Movemen
                 turn_params = turn_params_fast;
                 forward_params = forward_params_fast;
                 general_params = general_params_fast;
+                gain_schedule = gain_schedule_fast;
             } else if (selected_mode == SUPER) {
                 turn_params = turn_params_super;
                 forward_params = forward_params_super;
                 general_params = general_params_super;
+                gain_schedule = gain_schedule_super;
             }
         }
         target_travel_mm = complete_prev_move_travel + (forward_params[movement].target_travel_mm * count) +
@@ -703,6 +760,7 @@ void Navigation::set_movement(Movement movement, Movement prev_movement, Movemen
                 turn_params = turn_params_medium;
                 forward_params = forward_params_medium;
                 general_params = general_params_medium;
+                gain_schedule = gain_schedule_medium;
             }
         }
         target_travel_mm = forward_params[movement].target_travel_mm + turn_params[next_movement].start;
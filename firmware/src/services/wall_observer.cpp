@@ -0,0 +1,80 @@
+#include <cstdlib>
+
+#include "algorithms/flood_fill.hpp"
+#include "bsp/analog_sensors.hpp"
+#include "services/wall_observer.hpp"
+
+namespace services {
+
+WallObserver* WallObserver::instance() {
+    static WallObserver w;
+    return &w;
+}
+
+void WallObserver::reset() {
+    sample_idx = 0;
+    sample_count = 0;
+    last_sample_dist_mm = 0;
+}
+
+void WallObserver::update(float traveled_dist_mm) {
+    // Distance restarts with every movement
+    if (traveled_dist_mm < last_sample_dist_mm) {
+        last_sample_dist_mm = traveled_dist_mm;
+    }
+
+    if ((traveled_dist_mm - last_sample_dist_mm) < SAMPLE_SPACING_MM) {
+        return;
+    }
+
+    last_sample_dist_mm = traveled_dist_mm;
+    add_sample();
+}
+
+void WallObserver::add_sample() {
+    auto status = bsp::analog_sensors::ir_get_sensing_status();
+
+    samples[sample_idx] = status.front_seeing * N | status.right_seeing * E | status.left_seeing * W;
+    sample_idx = (sample_idx + 1) % SAMPLES;
+    if (sample_count < SAMPLES) {
+        sample_count++;
+    }
+}
+
+WallObserver::Observation WallObserver::observe(Direction robot_dir) {
+    add_sample();
+
+    Observation observation = {0, {0, 0, 0, 0}};
+    uint8_t relative_confidence[4] = {0, 0, 0, 0};
+
+    for (auto& d : Directions) {
+        uint8_t bit = 1 << std::to_underlying(d);
+        if (bit == S) {
+            continue;
+        }
+
+        int votes = 0;
+        for (uint8_t i = 0; i < sample_count; i++) {
+            votes += (samples[i] & bit) != 0;
+        }
+
+        // Laplace smoothed probability, confidence is how far it is from 0.5
+        float probability = (votes + 1.0f) / (sample_count + 2.0f);
+        if (probability > 0.5f) {
+            observation.walls |= bit;
+        }
+        relative_confidence[std::to_underlying(d)] = std::abs(2.0f * probability - 1.0f) * OBSERVATION_WEIGHT;
+    }
+
+    // Same circular rotation used for the walls, bit i goes to bit (i + robot_dir) % 4
+    for (uint8_t i = 0; i < 4; i++) {
+        observation.confidence[(i + std::to_underlying(robot_dir)) % 4] = relative_confidence[i];
+    }
+    observation.walls = observation.walls << robot_dir;
+
+    reset();
+
+    return observation;
+}
+
+}
@@ -0,0 +1,33 @@
+#include <array>
+
+#include "utils/crc.hpp"
+
+namespace crc {
+
+/// @section Constants
+
+static constexpr uint32_t CRC32_POLY = 0xEDB88320;
+
+static constexpr std::array<uint32_t, 256> crc32_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; bit++) {
+            value = (value & 1) ? (value >> 1) ^ CRC32_POLY : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}();
+
+/// @section Interface implementation
+
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace
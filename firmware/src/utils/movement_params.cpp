@@ -368,3 +368,55 @@ const GeneralParams general_params_super = {
     72.0,                    // Start wall break mm right
     1.0                      // Enable wall break correction
 };
+
+GainSchedulePoint gain_schedule_lookup(const GainSchedulePoint (&table)[GAIN_SCHEDULE_POINTS], float speed) {
+    if (speed <= table[0].speed) {
+        return table[0];
+    }
+
+    for (uint8_t i = 1; i < GAIN_SCHEDULE_POINTS; i++) {
+        const GainSchedulePoint& lo = table[i - 1];
+        const GainSchedulePoint& hi = table[i];
+        if (speed <= hi.speed) {
+            float span = hi.speed - lo.speed;
+            float t = span > 0.0f ? (speed - lo.speed) / span : 1.0f;
+            return {
+                speed,
+                lo.kp_scale + t * (hi.kp_scale - lo.kp_scale),
+                lo.ki_scale + t * (hi.ki_scale - lo.ki_scale),
+                lo.kd_scale + t * (hi.kd_scale - lo.kd_scale),
+                lo.ff_scale + t * (hi.ff_scale - lo.ff_scale),
+            };
+        }
+    }
+
+    return table[GAIN_SCHEDULE_POINTS - 1];
+}
+
+// Speed, kp scale, ki scale, kd scale, ff scale. Linear speeds in [m/s], angular speeds in [rad/s]
+// The scales are uncalibrated starting points picked by hand, not derived from measurements.
+// Retune them from logged step responses at each breakpoint before relying on them
+const GainSchedule gain_schedule_flat = {
+    {{0.0, 1.0, 1.0, 1.0, 1.0}, {1.0, 1.0, 1.0, 1.0, 1.0}, {2.0, 1.0, 1.0, 1.0, 1.0}, {3.0, 1.0, 1.0, 1.0, 1.0}},
+    {{0.0, 1.0, 1.0, 1.0, 1.0}, {10.0, 1.0, 1.0, 1.0, 1.0}, {20.0, 1.0, 1.0, 1.0, 1.0}, {30.0, 1.0, 1.0, 1.0, 1.0}},
+};
+
+const GainSchedule gain_schedule_search_slow = gain_schedule_flat;
+const GainSchedule gain_schedule_search_medium = gain_schedule_flat;
+const GainSchedule gain_schedule_search_fast = gain_schedule_flat;
+const GainSchedule gain_schedule_slow = gain_schedule_flat;
+
+const GainSchedule gain_schedule_medium = {
+    {{0.0, 0.85, 1.0, 1.0, 1.0}, {0.5, 1.0, 1.0, 1.0, 1.0}, {2.0, 1.0, 1.0, 1.0, 1.0}, {3.0, 1.0, 1.0, 1.0, 1.0}},
+    {{0.0, 1.0, 1.0, 1.0, 1.0}, {10.0, 1.0, 1.0, 1.0, 1.0}, {20.0, 1.0, 1.0, 1.0, 1.0}, {30.0, 1.0, 1.0, 1.0, 1.0}},
+};
+
+const GainSchedule gain_schedule_fast = {
+    {{0.0, 0.85, 1.0, 1.0, 1.0}, {0.5, 1.0, 1.0, 1.0, 1.0}, {2.5, 1.0, 1.0, 1.0, 1.0}, {4.0, 1.10, 1.0, 1.0, 1.0}},
+    {{0.0, 1.0, 1.0, 1.0, 1.0}, {10.0, 1.0, 1.0, 1.0, 1.0}, {20.0, 1.0, 1.0, 1.0, 1.0}, {30.0, 1.05, 1.0, 1.0, 1.0}},
+};
+
+const GainSchedule gain_schedule_super = {
+    {{0.0, 0.85, 1.0, 1.0, 1.0}, {0.5, 1.0, 1.0, 1.0, 1.0}, {2.5, 1.05, 1.0, 1.0, 1.0}, {5.0, 1.20, 1.0, 1.0, 1.0}},
+    {{0.0, 1.0, 1.0, 1.0, 1.0}, {10.0, 1.0, 1.0, 1.0, 1.0}, {20.0, 1.05, 1.0, 1.0, 1.0}, {30.0, 1.10, 1.0, 1.0, 1.0}},
+};
@@ -0,0 +1,49 @@
+#include "utils/sample_bus.hpp"
+
+namespace sample_bus {
+
+/// @section Private variables
+
+static constexpr size_t HISTORY_SIZE = 8;
+
+static SampleHistory<HISTORY_SIZE> channels[CHANNEL_COUNT];
+
+/// @section Interface implementation
+
+void publish(Channel channel, uint32_t timestamp_us, float value) {
+    channels[channel].publish({timestamp_us, value});
+}
+
+bool latest(Channel channel, Sample* out) {
+    Sample previous;
+    return channels[channel].read(out, &previous);
+}
+
+float value_at(Channel channel, uint32_t time_us, uint32_t max_horizon_us) {
+    Sample newest;
+    Sample previous;
+
+    if (!channels[channel].read(&newest, &previous)) {
+        return 0.0f;
+    }
+
+    uint32_t sample_interval_us = newest.timestamp_us - previous.timestamp_us;
+    int32_t horizon_us = static_cast<int32_t>(time_us - newest.timestamp_us);
+
+    if (sample_interval_us == 0 || horizon_us <= 0) {
+        return newest.value;
+    }
+
+    if (static_cast<uint32_t>(horizon_us) > max_horizon_us) {
+        horizon_us = max_horizon_us;
+    }
+
+    float slope = (newest.value - previous.value) / sample_interval_us;
+    return newest.value + slope * horizon_us;
+}
+
+void reset(Channel channel) {
+    channels[channel].reset();
+}
+
+}
@@ -0,0 +1,36 @@
+/// @brief Minimal checks for the host tests, a failed check is printed and counted
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+static int check_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            check_failures++;                                                    \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance)                                                                     \
+    do {                                                                                                \
+        double _a = (a), _b = (b);                                                                      \
+        if (!(std::abs(_a - _b) <= (tolerance))) {                                                      \
+            std::printf("%s:%d: check failed: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, _a, #b, _b); \
+            check_failures++;                                                                           \
+        }                                                                                               \
+    } while (0)
+
+static inline int check_result(const char* name) {
+    if (check_failures == 0) {
+        std::printf("%s: ok\n", name);
+        return 0;
+    }
+
+    std::printf("%s: %d checks failed\n", name, check_failures);
+    return 1;
+}
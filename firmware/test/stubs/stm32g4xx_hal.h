@@ -0,0 +1,86 @@
+/// @brief Host stand-in for the parts of the STM32 HAL that timers.cpp uses, included through the target st/hal.h.
+/// The TIM calls keep the HAL behaviour the timebase depends on, HAL_TIM_OC_Stop_IT clears CEN once no channel
+/// is left on
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+#define TIM_CR1_CEN (1U << 0)
+#define TIM_DIER_CC1IE (1U << 1)
+#define TIM_SR_CC1IF (1U << 1)
+#define TIM_CCER_CC1E (1U << 0)
+#define TIM_CCER_CCxE_MASK (TIM_CCER_CC1E | (1U << 4) | (1U << 8) | (1U << 12))
+
+#define TIM_IT_CC1 TIM_DIER_CC1IE
+#define TIM_CHANNEL_1 0x00U
+#define TIM_CCx_ENABLE 1U
+#define TIM_CCx_DISABLE 0U
+
+#define TIM_OCMODE_TIMING 0U
+#define TIM_OCPOLARITY_HIGH 0U
+#define TIM_OCFAST_DISABLE 0U
+
+struct TIM_TypeDef {
+    uint32_t CR1;
+    uint32_t DIER;
+    uint32_t SR;
+    uint32_t CCER;
+    uint32_t CNT;
+    uint32_t CCR1;
+};
+
+enum HAL_StatusTypeDef { HAL_OK, HAL_ERROR };
+enum HAL_TIM_ChannelStateTypeDef {
+    HAL_TIM_CHANNEL_STATE_RESET,
+    HAL_TIM_CHANNEL_STATE_READY,
+    HAL_TIM_CHANNEL_STATE_BUSY,
+};
+enum HAL_TIM_ActiveChannel { HAL_TIM_ACTIVE_CHANNEL_CLEARED, HAL_TIM_ACTIVE_CHANNEL_1 };
+
+struct TIM_HandleTypeDef {
+    TIM_TypeDef* Instance;
+    HAL_TIM_ActiveChannel Channel;
+    HAL_TIM_ChannelStateTypeDef ChannelState[1];
+};
+
+struct TIM_OC_InitTypeDef {
+    uint32_t OCMode;
+    uint32_t Pulse;
+    uint32_t OCPolarity;
+    uint32_t OCFastMode;
+};
+
+// Only declared by st/hal.h
+struct ADC_HandleTypeDef {};
+struct DMA_HandleTypeDef {};
+struct CRC_HandleTypeDef {};
+struct I2C_HandleTypeDef {};
+struct SPI_HandleTypeDef {};
+struct UART_HandleTypeDef {};
+
+extern TIM_TypeDef tim5_registers;
+#define TIM5 (&tim5_registers)
+
+#define __HAL_TIM_GET_COUNTER(h) ((h)->Instance->CNT)
+#define __HAL_TIM_GET_COMPARE(h, channel) ((h)->Instance->CCR1)
+#define __HAL_TIM_SET_COMPARE(h, channel, value) ((h)->Instance->CCR1 = (value))
+#define __HAL_TIM_DISABLE_IT(h, it) ((h)->Instance->DIER &= ~(it))
+#define __HAL_TIM_CLEAR_IT(h, it) ((h)->Instance->SR = ~(it))
+#define TIM_CHANNEL_STATE_SET(h, channel, state) ((h)->ChannelState[(channel) >> 2] = (state))
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim);
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef* htim, TIM_OC_InitTypeDef* config, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef* htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef* htim, uint32_t channel);
+void TIM_CCxChannelCmd(TIM_TypeDef* tim, uint32_t channel, uint32_t state);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef* htim);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+/// @brief Lets the counter run for one microsecond, the busy waits call it through __NOP
+void tim5_tick(void);
+#define __NOP() tim5_tick()
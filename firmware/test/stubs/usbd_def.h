@@ -0,0 +1,5 @@
+/// @brief Host stand-in for the USB device types st/hal.h declares
+
+#pragma once
+
+struct USBD_HandleTypeDef {};
@@ -0,0 +1,107 @@
+/// @brief Round trips the bit packer fields and codes used by the compressed RAM log
+
+#include <cstdint>
+#include <vector>
+
+#include "check.hpp"
+#include "utils/bit_packer.hpp"
+
+static void check_zigzag() {
+    CHECK(bit_packer::zigzag_encode(0) == 0);
+    CHECK(bit_packer::zigzag_encode(-1) == 1);
+    CHECK(bit_packer::zigzag_encode(1) == 2);
+    CHECK(bit_packer::zigzag_encode(-2) == 3);
+
+    for (int32_t value : {0, 1, -1, 1000, -1000, INT32_MAX, INT32_MIN}) {
+        CHECK(bit_packer::zigzag_decode(bit_packer::zigzag_encode(value)) == value);
+    }
+}
+
+static void check_exp_golomb() {
+    const uint32_t values[] = {0, 1, 2, 3, 7, 8, 255, 256, 65535, 1u << 31, UINT32_MAX};
+    uint8_t buffer[64] = {0};
+
+    bit_packer::Writer writer(buffer, sizeof(buffer));
+    for (uint32_t value : values) {
+        CHECK(writer.write_exp_golomb(value));
+    }
+
+    bit_packer::Reader reader(buffer, sizeof(buffer));
+    for (uint32_t value : values) {
+        CHECK(reader.read_exp_golomb() == value);
+    }
+    CHECK(reader.bits_read() == writer.bits_written());
+
+    // A zero residual is one bit, one and two are three
+    bit_packer::Writer sizes(buffer, sizeof(buffer));
+    sizes.write_exp_golomb(0);
+    CHECK(sizes.bits_written() == 1);
+    sizes.write_exp_golomb(2);
+    CHECK(sizes.bits_written() == 4);
+}
+
+static void check_fields() {
+    uint8_t buffer[16] = {0};
+    bit_packer::Writer writer(buffer, sizeof(buffer));
+    CHECK(writer.write(1, 1));
+    CHECK(writer.write(0x2AB, 10));
+    CHECK(writer.write(0xDEADBEEF, 32));
+    CHECK(writer.write_exp_golomb(5));
+    CHECK(writer.write(0x3, 2));
+
+    bit_packer::Reader reader(buffer, sizeof(buffer));
+    CHECK(reader.read(1) == 1);
+    CHECK(reader.read(10) == 0x2AB);
+    CHECK(reader.read(32) == 0xDEADBEEF);
+    CHECK(reader.read_exp_golomb() == 5);
+    CHECK(reader.read(2) == 0x3);
+
+    // Full buffer: the write fails, rewinding drops its partial code and the next record starts there
+    uint8_t small[2] = {0};
+    bit_packer::Writer full(small, sizeof(small));
+    CHECK(full.write(0x1FF, 9));
+    size_t record_start = full.bits_written();
+    CHECK(!full.write_exp_golomb(1000));
+    full.rewind(record_start);
+    CHECK(full.bits_written() == record_start);
+    CHECK(full.write(0x7F, 7));
+    CHECK(!full.write(1, 1));
+}
+
+static void check_delta_stream() {
+    // A slow 16 bit channel, as the pose and speed fields change between 1 kHz records
+    std::vector<int32_t> samples;
+    for (int i = 0; i < 1000; i++) {
+        samples.push_back(20000 + (i * i) / 400 + ((i * 7919) % 5) - 2);
+    }
+
+    std::vector<uint8_t> buffer(samples.size() * 4);
+    bit_packer::Writer writer(buffer.data(), buffer.size());
+    int32_t previous = 0;
+    for (int32_t sample : samples) {
+        CHECK(writer.write_exp_golomb(bit_packer::zigzag_encode(sample - previous)));
+        previous = sample;
+    }
+
+    bit_packer::Reader reader(buffer.data(), buffer.size());
+    previous = 0;
+    size_t mismatches = 0;
+    for (int32_t sample : samples) {
+        previous += bit_packer::zigzag_decode(reader.read_exp_golomb());
+        mismatches += previous != sample;
+    }
+    CHECK(mismatches == 0);
+
+    float bits_per_sample = static_cast<float>(writer.bits_written()) / samples.size();
+    std::printf("delta coded 16 bit channel: %.1f bits per sample\n", bits_per_sample);
+    CHECK(bits_per_sample < 16.0f / 2.0f);
+}
+
+int main() {
+    check_zigzag();
+    check_exp_golomb();
+    check_fields();
+    check_delta_stream();
+
+    return check_result("bit_packer");
+}
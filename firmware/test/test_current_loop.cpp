@@ -0,0 +1,88 @@
+/// @brief Runs the current loop against a motor whose driver only reports the current magnitude, checking it
+/// settles on positive and negative references, turning either way
+
+#include <cmath>
+
+#include "algorithms/current_loop.hpp"
+#include "check.hpp"
+
+// Same as control.cpp and the config defaults
+static constexpr float MODEL_RA_OHM = 2.5f;
+static constexpr float KT = 0.0064f;
+static constexpr float KP = 1.5f;
+static constexpr float KI = 0.05f;
+static constexpr float INTEGRAL_LIMIT = 200.0f;
+static constexpr float BATTERY_VOLTS = 8.0f;
+
+// The real winding is warmer than the model, so the PI has to close the difference
+static constexpr float MOTOR_RA_OHM = 3.0f;
+static constexpr float MOTOR_L_H = 0.0001f;
+static constexpr float STEP_S = 0.0001f;
+
+static constexpr int STEPS = 2000;
+
+struct Result {
+    float current_a;
+    float max_volts;
+};
+
+/// @brief RL winding with the back EMF of a wheel at a fixed speed, the driver reads |i|
+static Result run(float target_a, float ang_vel_rad_s, bool sign_reading) {
+    algorithm::CurrentLoop loop(MODEL_RA_OHM, KT, KP, KI, INTEGRAL_LIMIT);
+    float current = 0.0f;
+    float volts = 0.0f;
+    Result result = {0.0f, 0.0f};
+
+    for (int i = 0; i < STEPS; i++) {
+        float measured = std::abs(current);
+        if (sign_reading) {
+            volts = loop.calculate(target_a, measured, ang_vel_rad_s, volts);
+        } else {
+            // The loop as it was, with the magnitude taken as the signed current
+            volts = target_a * MODEL_RA_OHM + ang_vel_rad_s * KT + loop.pid.calculate(target_a, measured);
+        }
+        volts = std::fmax(-BATTERY_VOLTS, std::fmin(BATTERY_VOLTS, volts));
+        result.max_volts = std::fmax(result.max_volts, std::abs(volts));
+
+        float steady = (volts - KT * ang_vel_rad_s) / MOTOR_RA_OHM;
+        current = steady + (current - steady) * std::exp(-MOTOR_RA_OHM / MOTOR_L_H * STEP_S);
+    }
+
+    result.current_a = current;
+    return result;
+}
+
+static void check_references() {
+    static constexpr float SPEEDS[] = {0.0f, 200.0f, -200.0f};
+
+    for (float speed : SPEEDS) {
+        CHECK_NEAR(run(0.6f, speed, true).current_a, 0.6, 0.01);
+        CHECK_NEAR(run(-0.6f, speed, true).current_a, -0.6, 0.01);
+        CHECK_NEAR(run(-1.5f, speed, true).current_a, -1.5, 0.02);
+    }
+
+    // Unsigned, a negative reference reads as a large positive error and the loop runs into the rail
+    auto unsigned_reading = run(-0.6f, 0.0f, false);
+    CHECK(std::abs(unsigned_reading.current_a + 0.6f) > 0.5f);
+    CHECK(unsigned_reading.max_volts >= BATTERY_VOLTS);
+}
+
+static void check_sign() {
+    using algorithm::CurrentLoop;
+
+    CHECK(CurrentLoop::signed_current(0.4f, -3.0f, 0.5f) == -0.4f);
+    CHECK(CurrentLoop::signed_current(0.4f, 3.0f, -0.5f) == 0.4f);
+
+    // Nothing applied yet, the target gives the direction
+    CHECK(CurrentLoop::signed_current(0.1f, 0.0f, -0.5f) == -0.1f);
+
+    // Offset noise below zero is still a magnitude
+    CHECK(CurrentLoop::signed_current(-0.02f, -3.0f, -0.5f) == -0.02f);
+}
+
+int main() {
+    check_references();
+    check_sign();
+
+    return check_result("current_loop");
+}
@@ -0,0 +1,191 @@
+/// @brief Replays a 10 minute gyro trace of a search and runs through the bias estimator, checking the heading
+/// error it leaves against the fixed calibrated bias
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "algorithms/gyro_bias_estimator.hpp"
+#include "check.hpp"
+
+// Same as imu.cpp
+static constexpr float SAMPLE_FREQ_HZ = 1000.0f;
+static constexpr float BIAS_SETTLE_TIME_S = 0.5f;
+static constexpr float BIAS_TAU_S = 2.0f;
+static constexpr float BIAS_GYRO_THRESHOLD_DPS = 1.0f;
+static constexpr float BIAS_ACC_THRESHOLD_G = 0.05f;
+
+static constexpr float SESSION_S = 600.0f;
+
+// Bias of the trace: calibrated value at the start, then following the die warming up
+static constexpr float START_BIAS_DPS = 0.4f;
+static constexpr float TEMP_COEFFICIENT_DPS_C = 0.02f;
+static constexpr float START_TEMPERATURE_C = 30.0f;
+static constexpr float WARM_TEMPERATURE_C = 42.0f;
+static constexpr float WARM_UP_TAU_S = 120.0f;
+
+struct Sample {
+    float gyro_dps;
+    float true_rate_dps;
+    float true_bias_dps;
+    float acc_norm_g;
+    float temperature_c;
+    bool wheels_still;
+};
+
+/// @brief Deterministic gaussian noise
+struct Noise {
+    uint32_t seed = 42;
+
+    float uniform() {
+        seed = seed * 1664525 + 1013904223;
+        return ((seed >> 8) + 0.5f) / 16777216.0f;
+    }
+
+    float gaussian() {
+        return std::sqrt(-2.0f * std::log(uniform())) * std::cos(2.0f * static_cast<float>(M_PI) * uniform());
+    }
+};
+
+/// @brief A search with a short stop in each cell, then runs, waiting still before each start. There is also a
+/// pick up with the wheels still and a knock on the table
+static std::vector<Sample> make_trace() {
+    std::vector<Sample> trace;
+    Noise noise;
+    float dt = 1.0f / SAMPLE_FREQ_HZ;
+    size_t samples = static_cast<size_t>(SESSION_S * SAMPLE_FREQ_HZ);
+    trace.reserve(samples);
+
+    for (size_t i = 0; i < samples; i++) {
+        float t = i * dt;
+        float warm_up = 1.0f - std::exp(-t / WARM_UP_TAU_S);
+        float temperature = START_TEMPERATURE_C + (WARM_TEMPERATURE_C - START_TEMPERATURE_C) * warm_up;
+        float bias = START_BIAS_DPS + TEMP_COEFFICIENT_DPS_C * (temperature - START_TEMPERATURE_C);
+
+        float rate = 0.0f;
+        float acc = 1.0f;
+        bool still = true;
+
+        bool searching = t > 3.0f && t < 300.0f;
+        bool running = t > 305.0f && std::fmod(t - 305.0f, 30.0f) > 3.0f && std::fmod(t - 305.0f, 30.0f) < 25.0f;
+        float cell_time = std::fmod(t, 1.2f);
+
+        if (searching && cell_time < 0.8f) {
+            // Moving through a cell, turning in one of every two
+            still = false;
+            bool turning = static_cast<int>(t / 1.2f) % 2 == 0;
+            rate = turning ? 300.0f * std::sin(cell_time / 0.8f * static_cast<float>(M_PI)) : 0.0f;
+            acc = 1.0f + 0.2f * std::sin(2.0f * static_cast<float>(M_PI) * 40.0f * t);
+        } else if (running) {
+            still = false;
+            rate = 600.0f * std::sin(2.0f * static_cast<float>(M_PI) * 0.5f * t);
+            acc = 1.0f + 0.4f * std::sin(2.0f * static_cast<float>(M_PI) * 60.0f * t);
+        } else if (t > 301.0f && t < 302.0f) {
+            // Picked up and turned by hand between the search and the runs, the wheels do not move
+            rate = 90.0f;
+        } else if (t > 303.0f && t < 303.3f) {
+            // Knock on the table, too short a rate to stand out from the noise
+            acc = 1.0f + 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 25.0f * t);
+            rate = 0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 25.0f * t);
+        }
+
+        Sample sample;
+        sample.true_rate_dps = rate;
+        sample.true_bias_dps = bias;
+        sample.gyro_dps = rate + bias + 0.1f * noise.gaussian();
+        sample.acc_norm_g = acc + 0.005f * noise.gaussian();
+        sample.temperature_c = temperature + 0.05f * noise.gaussian();
+        sample.wheels_still = still;
+        trace.push_back(sample);
+    }
+
+    return trace;
+}
+
+struct Result {
+    float max_heading_error_deg;
+    float final_bias_error_dps;
+};
+
+/// @brief Heading error is the integral of the rate left after removing the bias, minus the true rate
+static Result replay(const std::vector<Sample>& trace, bool estimate, float temp_coefficient_dps_c) {
+    algorithm::GyroBiasEstimator estimator(BIAS_SETTLE_TIME_S, BIAS_TAU_S, BIAS_GYRO_THRESHOLD_DPS,
+                                           BIAS_ACC_THRESHOLD_G);
+    estimator.temp_coefficient_dps_c = temp_coefficient_dps_c;
+    estimator.reset(START_BIAS_DPS);
+
+    float dt = 1.0f / SAMPLE_FREQ_HZ;
+    double heading_error = 0.0;
+    Result result = {0.0f, 0.0f};
+    float bias = START_BIAS_DPS;
+
+    for (const auto& sample : trace) {
+        if (estimate) {
+            bias = estimator.update(sample.gyro_dps, sample.acc_norm_g, sample.temperature_c, sample.wheels_still, dt);
+        }
+
+        heading_error += (sample.gyro_dps - bias - sample.true_rate_dps) * dt;
+        float error_deg = static_cast<float>(std::abs(heading_error));
+        result.max_heading_error_deg = std::max(result.max_heading_error_deg, error_deg);
+        result.final_bias_error_dps = bias - sample.true_bias_dps;
+    }
+
+    return result;
+}
+
+static void check_heading_error() {
+    auto trace = make_trace();
+
+    auto fixed = replay(trace, false, 0.0f);
+    auto estimated = replay(trace, true, 0.0f);
+    auto temperature_model = replay(trace, true, TEMP_COEFFICIENT_DPS_C);
+
+    std::printf("max heading error over %.0f s: fixed bias %.1f deg, estimated %.1f deg, with temperature %.1f deg\n",
+                SESSION_S, fixed.max_heading_error_deg, estimated.max_heading_error_deg,
+                temperature_model.max_heading_error_deg);
+
+    // The fixed bias drifts by the whole warm up. The cell stops are shorter than the settle time, so without
+    // the temperature model the search drifts until the runs, with it the heading stays within a few degrees
+    CHECK(fixed.max_heading_error_deg > 50.0f);
+    CHECK(estimated.max_heading_error_deg < 0.5f * fixed.max_heading_error_deg);
+    CHECK(temperature_model.max_heading_error_deg < 5.0f);
+    CHECK_NEAR(estimated.final_bias_error_dps, 0.0, 0.02);
+    CHECK_NEAR(temperature_model.final_bias_error_dps, 0.0, 0.02);
+}
+
+static void check_rejection() {
+    algorithm::GyroBiasEstimator estimator(BIAS_SETTLE_TIME_S, BIAS_TAU_S, BIAS_GYRO_THRESHOLD_DPS,
+                                           BIAS_ACC_THRESHOLD_G);
+    estimator.reset(START_BIAS_DPS);
+    float dt = 1.0f / SAMPLE_FREQ_HZ;
+
+    // Turning with the wheels still, moving wheels and an accelerometer off gravity are all left out
+    for (int i = 0; i < 5000; i++) {
+        estimator.update(START_BIAS_DPS + 50.0f, 1.0f, 30.0f, true, dt);
+        estimator.update(START_BIAS_DPS + 0.5f, 1.0f, 30.0f, false, dt);
+        estimator.update(START_BIAS_DPS + 0.5f, 1.2f, 30.0f, true, dt);
+    }
+    CHECK(!estimator.is_still());
+    CHECK_NEAR(estimator.get_bias(30.0f), START_BIAS_DPS, 1e-6);
+
+    // Still for less than the settle time does not count either
+    for (int i = 0; i < BIAS_SETTLE_TIME_S * SAMPLE_FREQ_HZ - 10; i++) {
+        estimator.update(START_BIAS_DPS + 0.5f, 1.0f, 30.0f, true, dt);
+    }
+    CHECK(!estimator.is_still());
+    CHECK_NEAR(estimator.get_bias(30.0f), START_BIAS_DPS, 1e-6);
+
+    // Past it the bias follows with the configured time constant
+    for (int i = 0; i < 20 + BIAS_TAU_S * SAMPLE_FREQ_HZ; i++) {
+        estimator.update(START_BIAS_DPS + 0.5f, 1.0f, 30.0f, true, dt);
+    }
+    CHECK(estimator.is_still());
+    CHECK_NEAR(estimator.get_bias(30.0f), START_BIAS_DPS + 0.5f * (1.0f - std::exp(-1.0f)), 0.01);
+}
+
+int main() {
+    check_heading_error();
+    check_rejection();
+
+    return check_result("gyro_bias_estimator");
+}
@@ -0,0 +1,134 @@
+/// @brief Feeds synthetic ADC1 DMA half buffers through the IR pipeline and the per sample one it replaced, checking
+/// they give the same readings. The buffers are generated with the DMA layout, walls and noise, not recorded
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "algorithms/ir_filter.hpp"
+#include "check.hpp"
+#include "utils/math.hpp"
+
+// Same layout as the ADC1 DMA in analog_sensors.cpp
+static constexpr size_t CHANNELS = 5;
+static constexpr size_t FRAMES = 20;
+static constexpr size_t SETTLE_FRAMES = 4;
+static constexpr size_t SAMPLES = FRAMES - SETTLE_FRAMES;
+static constexpr size_t HALF_BUFFER_SIZE = CHANNELS * FRAMES;
+static constexpr size_t IR_CHANNELS = 4;
+
+static constexpr size_t BUFFERS = 4000;
+
+/// @brief Synthetic half buffers in the DMA layout: 12 bit readings, walls coming and going and some noise
+static std::vector<uint32_t> make_buffers() {
+    std::vector<uint32_t> buffers(BUFFERS * HALF_BUFFER_SIZE);
+    uint32_t seed = 12345;
+    for (size_t b = 0; b < BUFFERS; b++) {
+        uint32_t level[CHANNELS];
+        for (size_t c = 0; c < IR_CHANNELS; c++) {
+            bool wall = ((b / (200 + 50 * c)) % 2) == 0;
+            level[c] = wall ? 1400 + 300 * c : 150 + 20 * c;
+        }
+        level[4] = 2900 - b / 20;
+
+        for (size_t f = 0; f < FRAMES; f++) {
+            for (size_t c = 0; c < CHANNELS; c++) {
+                seed = seed * 1664525 + 1013904223;
+                int32_t noise = static_cast<int32_t>(seed >> 26) - 32;
+                int32_t value = static_cast<int32_t>(level[c]) + noise;
+                buffers[b * HALF_BUFFER_SIZE + f * CHANNELS + c] = constrain(value, 0, 4095);
+            }
+        }
+    }
+
+    return buffers;
+}
+
+/// @brief The per sample pipeline: indexed sums over the half buffer, then a moving average that sums its window
+struct ReferencePipeline {
+    uint32_t window[IR_CHANNELS][algorithm::IrFilter::MAX_WINDOW] = {};
+    size_t idx[IR_CHANNELS] = {};
+    size_t window_size;
+
+    void process(const uint32_t* data, uint32_t readings[IR_CHANNELS]) {
+        uint32_t aux[CHANNELS] = {0};
+        for (size_t i = SETTLE_FRAMES * CHANNELS; i < HALF_BUFFER_SIZE; i++) {
+            aux[i % CHANNELS] += data[i];
+        }
+
+        for (size_t c = 0; c < IR_CHANNELS; c++) {
+            readings[c] = moving_average(window[c], window_size, &idx[c], aux[c] / SAMPLES);
+        }
+    }
+};
+
+/// @brief The ADC1 callback pipeline: one pass interleaved sums and a running sum filter per channel
+struct Pipeline {
+    algorithm::IrFilter filters[IR_CHANNELS];
+
+    void process(const uint32_t* data, uint32_t readings[IR_CHANNELS]) {
+        uint32_t aux[CHANNELS];
+        algorithm::sum_interleaved(data + SETTLE_FRAMES * CHANNELS, SAMPLES, aux);
+
+        for (size_t c = 0; c < IR_CHANNELS; c++) {
+            readings[c] = filters[c].update(aux[c] / SAMPLES);
+        }
+    }
+};
+
+static void check_equivalence(const std::vector<uint32_t>& buffers, size_t window) {
+    ReferencePipeline reference;
+    reference.window_size = window;
+    Pipeline pipeline;
+    for (auto& filter : pipeline.filters) {
+        filter.configure(algorithm::IrFilter::MOVING_AVERAGE, window, 0);
+    }
+
+    size_t mismatches = 0;
+    for (size_t b = 0; b < BUFFERS; b++) {
+        uint32_t expected[IR_CHANNELS];
+        uint32_t readings[IR_CHANNELS];
+        reference.process(&buffers[b * HALF_BUFFER_SIZE], expected);
+        pipeline.process(&buffers[b * HALF_BUFFER_SIZE], readings);
+        for (size_t c = 0; c < IR_CHANNELS; c++) {
+            mismatches += readings[c] != expected[c];
+        }
+    }
+
+    if (mismatches != 0) {
+        std::printf("window %zu: %zu readings differ\n", window, mismatches);
+    }
+    CHECK(mismatches == 0);
+}
+
+static void check_iir() {
+    algorithm::IrFilter filter(algorithm::IrFilter::IIR, 1, 3);
+
+    // Starts on the first sample instead of ramping up from zero
+    CHECK(filter.update(1000) == 1000);
+
+    uint32_t output = 0;
+    for (int i = 0; i < 200; i++) {
+        output = filter.update(2000);
+    }
+    CHECK_NEAR(output, 2000, 8);
+
+    // One step moves by 1 / 2^shift of the error
+    filter.reset();
+    filter.update(0);
+    CHECK(filter.update(800) == 100);
+
+    algorithm::IrFilter none(algorithm::IrFilter::NONE, 1, 0);
+    CHECK(none.update(1234) == 1234);
+}
+
+int main() {
+    auto buffers = make_buffers();
+
+    check_equivalence(buffers, 1);
+    check_equivalence(buffers, 25);
+    check_equivalence(buffers, algorithm::IrFilter::MAX_WINDOW);
+    check_iir();
+
+    return check_result("ir_pipeline_equivalence");
+}
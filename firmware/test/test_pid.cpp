@@ -0,0 +1,40 @@
+/// @brief Checks the PID keeps its I term through the scheduled ki changes, within the integral limit
+
+#include "algorithms/pid.hpp"
+#include "check.hpp"
+
+static void check_set_ki() {
+    algorithm::PID pid(0.0f, 2.0f, 0.0f, 100.0f);
+    for (int i = 0; i < 30; i++) {
+        pid.calculate(1.0f, 0.0f);
+    }
+    CHECK_NEAR(pid.get_integral(), 30.0, 1e-4);
+
+    // Same I term at the new gain
+    pid.set_ki(4.0f);
+    CHECK_NEAR(pid.ki * pid.get_integral(), 60.0, 1e-4);
+
+    // A smaller ki would need a sum past the limit, it is capped there as calculate would
+    pid.set_ki(0.5f);
+    CHECK_NEAR(pid.get_integral(), 100.0, 1e-4);
+    pid.set_ki(0.1f);
+    CHECK_NEAR(pid.get_integral(), 100.0, 1e-4);
+
+    // Dropping the I term clears it
+    pid.set_ki(0.0f);
+    CHECK(pid.get_integral() == 0.0f);
+
+    // The sum kept while ki was zero does not kick in when it comes back
+    for (int i = 0; i < 30; i++) {
+        pid.calculate(1.0f, 0.0f);
+    }
+    pid.set_ki(2.0f);
+    CHECK(pid.get_integral() == 0.0f);
+    CHECK_NEAR(pid.calculate(1.0f, 1.0f), 0.0, 1e-6);
+}
+
+int main() {
+    check_set_ki();
+
+    return check_result("pid");
+}
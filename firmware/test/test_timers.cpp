@@ -0,0 +1,131 @@
+/// @brief Runs the TIM5 periodic compare of timers.cpp on a stand-in timer, checking that stopping and
+/// restarting the fast loop never stops the microsecond timebase
+
+#include <cstdlib>
+
+#include "bsp/timers.hpp"
+#include "check.hpp"
+#include "st/hal.h"
+
+TIM_TypeDef tim5_registers;
+TIM_HandleTypeDef htim5;
+
+static int periodic_calls = 0;
+static int nop_calls = 0;
+
+// A busy wait on a stopped counter never returns, fail instead of hanging
+static constexpr int MAX_STOPPED_NOPS = 1000000;
+
+void MX_TIM5_Init(void) {
+    tim5_registers = {};
+    htim5.Instance = TIM5;
+    htim5.Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+    htim5.ChannelState[0] = HAL_TIM_CHANNEL_STATE_READY;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim) {
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef* htim, TIM_OC_InitTypeDef* config, uint32_t) {
+    htim->Instance->CCR1 = config->Pulse;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Start_IT(TIM_HandleTypeDef* htim, uint32_t channel) {
+    if (htim->ChannelState[channel >> 2] != HAL_TIM_CHANNEL_STATE_READY) {
+        return HAL_ERROR;
+    }
+
+    htim->ChannelState[channel >> 2] = HAL_TIM_CHANNEL_STATE_BUSY;
+    htim->Instance->DIER |= TIM_DIER_CC1IE;
+    TIM_CCxChannelCmd(htim->Instance, channel, TIM_CCx_ENABLE);
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+// Same as the HAL: the counter is disabled once no channel is left on
+HAL_StatusTypeDef HAL_TIM_OC_Stop_IT(TIM_HandleTypeDef* htim, uint32_t channel) {
+    htim->Instance->DIER &= ~TIM_DIER_CC1IE;
+    TIM_CCxChannelCmd(htim->Instance, channel, TIM_CCx_DISABLE);
+    if ((htim->Instance->CCER & TIM_CCER_CCxE_MASK) == 0) {
+        htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    }
+    htim->ChannelState[channel >> 2] = HAL_TIM_CHANNEL_STATE_READY;
+    return HAL_OK;
+}
+
+void TIM_CCxChannelCmd(TIM_TypeDef* tim, uint32_t channel, uint32_t state) {
+    uint32_t bit = TIM_CCER_CC1E << (channel & 0x1FU);
+    tim->CCER = (tim->CCER & ~bit) | (state ? bit : 0);
+}
+
+uint32_t HAL_GetTick(void) {
+    return tim5_registers.CNT / 1000;
+}
+
+void HAL_Delay(uint32_t) {}
+
+void tim5_tick(void) {
+    nop_calls++;
+    if (!(tim5_registers.CR1 & TIM_CR1_CEN)) {
+        if (nop_calls > MAX_STOPPED_NOPS) {
+            std::printf("timers: waiting on a stopped counter\n");
+            std::exit(1);
+        }
+        return;
+    }
+
+    tim5_registers.CNT++;
+    if ((tim5_registers.DIER & TIM_DIER_CC1IE) && tim5_registers.CNT == tim5_registers.CCR1) {
+        htim5.Channel = HAL_TIM_ACTIVE_CHANNEL_1;
+        HAL_TIM_OC_DelayElapsedCallback(&htim5);
+        htim5.Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+    }
+}
+
+static void count_periodic() {
+    periodic_calls++;
+}
+
+/// @brief delay_us spins on the counter, a stopped timebase makes it wait forever
+static bool delay_completes(uint32_t us) {
+    nop_calls = 0;
+    uint32_t start = bsp::get_tick_us();
+    bsp::delay_us(us);
+    return bsp::get_tick_us() - start >= us && nop_calls < 10 * static_cast<int>(us);
+}
+
+int main() {
+    bsp::timers::init();
+    CHECK(delay_completes(100));
+
+    bsp::timers::start_periodic(250, count_periodic);
+    CHECK(delay_completes(1000));
+    CHECK(periodic_calls == 4);
+
+    // Stopping the fast loop leaves the counter running
+    bsp::timers::stop_periodic();
+    CHECK(tim5_registers.CR1 & TIM_CR1_CEN);
+    CHECK(!(tim5_registers.DIER & TIM_DIER_CC1IE));
+    CHECK(!(tim5_registers.CCER & TIM_CCER_CC1E));
+    uint32_t before = bsp::get_tick_us();
+    CHECK(delay_completes(1000));
+    CHECK(bsp::get_tick_us() - before >= 1000);
+    CHECK(periodic_calls == 4);
+
+    // And it can be started again, at another period
+    bsp::timers::start_periodic(500, count_periodic);
+    CHECK(tim5_registers.DIER & TIM_DIER_CC1IE);
+    CHECK(delay_completes(1000));
+    CHECK(periodic_calls == 6);
+
+    // Restarting while running does not stop it either
+    bsp::timers::start_periodic(500, count_periodic);
+    CHECK(tim5_registers.CR1 & TIM_CR1_CEN);
+    CHECK(delay_completes(1000));
+    CHECK(periodic_calls == 8);
+
+    return check_result("timers");
+}
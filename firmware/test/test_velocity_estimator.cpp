@@ -0,0 +1,197 @@
+/// @brief Runs the M/T velocity estimator and the alpha-beta tracker on synthetic encoder edge streams
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#include "algorithms/velocity_estimator.hpp"
+#include "check.hpp"
+
+// Same encoder as encoders.cpp: 1024 edges over a 12.75 mm radius wheel
+static constexpr double DIST_MM_PER_TICK = 2.0 * M_PI * 12.75 / 1024.0;
+static constexpr uint32_t MAX_TIME_WITHOUT_TICK_US = 10000;
+
+// Estimator output is in mm/us
+static constexpr double MM_PER_US_TO_M_PER_S = 1000.0;
+
+/// @brief Edges of a wheel moving at a given speed, timestamped with the 1 us resolution of the firmware
+struct EdgeStream {
+    double position_mm = 0.0;
+    int64_t tick = 0;
+    int32_t pending_ticks = 0;
+    uint32_t last_edge_us = 0;
+
+    void step(uint32_t now_us, double speed_m_s) {
+        // 1 m/s is 1 mm/ms, so 0.001 mm each us
+        position_mm += speed_m_s * 0.001;
+        int64_t new_tick = static_cast<int64_t>(std::floor(position_mm / DIST_MM_PER_TICK));
+        if (new_tick != tick) {
+            pending_ticks += new_tick - tick;
+            tick = new_tick;
+            last_edge_us = now_us;
+        }
+    }
+
+    int32_t take_ticks() {
+        int32_t ticks = pending_ticks;
+        pending_ticks = 0;
+        return ticks;
+    }
+};
+
+/// @brief The estimate it replaced: edges over the window, one edge assumed when the window has none
+static double tick_count_velocity(int32_t ticks, uint32_t window_us, int32_t last_direction) {
+    if (ticks == 0) {
+        ticks = last_direction;
+    }
+
+    return ticks * DIST_MM_PER_TICK / window_us * MM_PER_US_TO_M_PER_S;
+}
+
+struct RunResult {
+    double mt_max_error = 0.0;
+    double mt_rms_error = 0.0;
+    double tick_count_max_error = 0.0;
+    double tick_count_rms_error = 0.0;
+    double last_velocity = 0.0;
+    double last_rate = 0.0;
+};
+
+/// @brief Feeds a speed profile through the estimators, comparing each window with the speed at that time
+/// @param settle_us Windows before this are not scored
+static RunResult run(std::function<double(uint32_t)> speed_m_s, uint32_t duration_us, uint32_t window_us,
+                     uint32_t settle_us, std::function<void(uint32_t, double)> on_window = nullptr) {
+    algorithm::MTVelocityEstimator estimator(DIST_MM_PER_TICK, MAX_TIME_WITHOUT_TICK_US);
+    algorithm::AlphaBetaTracker tracker(0.006);
+    EdgeStream stream;
+    RunResult result;
+    int32_t direction = 1;
+    size_t scored = 0;
+
+    for (uint32_t now = 1; now <= duration_us; now++) {
+        stream.step(now, speed_m_s(now));
+        if (now % window_us != 0) {
+            continue;
+        }
+
+        int32_t ticks = stream.take_ticks();
+        double mt = estimator.update(ticks, stream.last_edge_us, now) * MM_PER_US_TO_M_PER_S;
+        double tick_count = tick_count_velocity(ticks, window_us, direction);
+        if (ticks != 0) {
+            direction = ticks > 0 ? 1 : -1;
+        }
+        tracker.update(mt, window_us / 1000000.0f);
+
+        if (on_window) {
+            on_window(now, mt);
+        }
+
+        if (now < settle_us) {
+            continue;
+        }
+
+        double truth = speed_m_s(now);
+        double mt_error = std::abs(mt - truth);
+        double tick_count_error = std::abs(tick_count - truth);
+        result.mt_max_error = std::max(result.mt_max_error, mt_error);
+        result.tick_count_max_error = std::max(result.tick_count_max_error, tick_count_error);
+        result.mt_rms_error += mt_error * mt_error;
+        result.tick_count_rms_error += tick_count_error * tick_count_error;
+        scored++;
+    }
+
+    result.mt_rms_error = std::sqrt(result.mt_rms_error / scored);
+    result.tick_count_rms_error = std::sqrt(result.tick_count_rms_error / scored);
+    result.last_velocity = tracker.get_value();
+    result.last_rate = tracker.get_rate();
+    return result;
+}
+
+static void check_constant_speed() {
+    // Cruise at the control loop rate and at the fast loop rate
+    for (uint32_t window_us : {1000u, 250u}) {
+        auto result = run([](uint32_t) { return 1.5; }, 200000, window_us, 10000);
+        CHECK_NEAR(result.mt_max_error, 0.0, 0.01 * 1.5);
+        CHECK(result.mt_rms_error < result.tick_count_rms_error / 5.0);
+        CHECK_NEAR(result.last_velocity, 1.5, 0.005);
+        CHECK_NEAR(result.last_rate, 0.0, 0.5);
+    }
+}
+
+static void check_low_speed() {
+    // An edge every 4 ms, most windows have none
+    auto result = run([](uint32_t) { return 0.02; }, 500000, 1000, 20000);
+    CHECK_NEAR(result.mt_max_error, 0.0, 0.05 * 0.02);
+
+    // The assumed edge alone is four times the speed
+    CHECK(result.tick_count_max_error > 0.05);
+}
+
+static void check_reverse() {
+    auto result = run([](uint32_t) { return -0.8; }, 100000, 1000, 10000);
+    CHECK_NEAR(result.mt_max_error, 0.0, 0.01 * 0.8);
+    CHECK_NEAR(result.last_velocity, -0.8, 0.005);
+}
+
+static void check_stop() {
+    static constexpr uint32_t STOP_US = 50000;
+    auto speed = [](uint32_t now) { return now < STOP_US ? 0.5 : 0.0; };
+
+    double previous = 1.0;
+    bool increased = false;
+    double after_timeout = 0.0;
+    run(speed, 100000, 1000, 0, [&](uint32_t now, double mt) {
+        if (now <= STOP_US) {
+            return;
+        }
+
+        // Without edges the estimate can only come down
+        increased |= mt > previous;
+        previous = mt;
+        if (now > STOP_US + MAX_TIME_WITHOUT_TICK_US + 1000) {
+            after_timeout = std::max(after_timeout, std::abs(mt));
+        }
+    });
+
+    CHECK(!increased);
+    CHECK(after_timeout == 0.0);
+}
+
+static void check_acceleration() {
+    // 0 to 2 m/s at 4 m/s^2
+    static constexpr double ACCEL = 4.0;
+    auto speed = [](uint32_t now) { return std::min(2.0, ACCEL * now / 1000000.0); };
+
+    double worst = 0.0;
+    run(speed, 500000, 1000, 0, [&](uint32_t now, double mt) {
+        if (speed(now) > 0.3) {
+            worst = std::max(worst, std::abs(mt - speed(now)));
+        }
+    });
+    // The estimate is the mean speed since the last edge of the previous window, about half a window old
+    CHECK_NEAR(worst, 0.0, 0.01);
+
+    // The tracker follows the ramp and its slope
+    algorithm::AlphaBetaTracker tracker(0.006);
+    double truth = 0.0;
+    for (int i = 0; i < 400; i++) {
+        truth = ACCEL * i * 0.001;
+        tracker.update(truth, 0.001f);
+    }
+    CHECK_NEAR(tracker.get_value(), truth, 0.01);
+    CHECK_NEAR(tracker.get_rate(), ACCEL, 0.1 * ACCEL);
+
+    // A non positive step is ignored
+    float value = tracker.get_value();
+    CHECK(tracker.update(100.0f, 0.0f) == value);
+}
+
+int main() {
+    check_constant_speed();
+    check_low_speed();
+    check_reverse();
+    check_stop();
+    check_acceleration();
+
+    return check_result("velocity_estimator");
+}
@@ -0,0 +1,163 @@
+import serial
+import struct
+import sys
+import signal
+import os
+from datetime import datetime
+
+from dump_log_usb import EVENT_FMT, parse_schema, decode_record, format_event
+
+# --- Configuration ---
+SERIAL_PORT = '/dev/ttyACM0'
+BAUD_RATE = 115200
+READ_TIMEOUT = 0.1
+
+# Frame layout of services::Logger::StreamFrameHeader, followed by the payload and a checksum byte
+SYNC = bytes([0xA5, 0x5A])
+HEADER_FMT = '<2sBHHI'
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+MAX_PAYLOAD = 1024
+STREAM_SCHEMA = 0
+STREAM_RECORD = 1
+STREAM_EVENT = 2
+
+
+def signal_handler(sig, frame):
+    raise KeyboardInterrupt
+
+
+class FrameParser:
+    """Resynchronises on the sync word and validates the checksum of each frame."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.schema = None
+        self.last_sequence = None
+        self.first_timestamp = None
+        self.last_timestamp = None
+        self.timestamp_offset = 0
+        self.frames = 0
+        self.lost = 0
+        self.bad = 0
+
+    def columns(self):
+        return "t;" + ";".join(name for name, _, _, _ in self.schema) if self.schema else "t"
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        rows = []
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                del self.buffer[:-1]
+                break
+            if len(self.buffer) - start < HEADER_SIZE:
+                del self.buffer[:start]
+                break
+
+            _, frame_type, length, sequence, timestamp_us = struct.unpack_from(HEADER_FMT, self.buffer, start)
+            if length > MAX_PAYLOAD:
+                self.bad += 1
+                del self.buffer[:start + 1]
+                continue
+
+            frame_size = HEADER_SIZE + length + 1
+            if len(self.buffer) - start < frame_size:
+                del self.buffer[:start]
+                break
+
+            frame = bytes(self.buffer[start:start + frame_size])
+            if sum(frame[:-1]) & 0xFF != frame[-1]:
+                self.bad += 1
+                del self.buffer[:start + 1]
+                continue
+            del self.buffer[:start + frame_size]
+
+            if self.last_sequence is not None:
+                self.lost += (sequence - self.last_sequence - 1) & 0xFFFF
+            self.last_sequence = sequence
+            self.frames += 1
+
+            payload = frame[HEADER_SIZE:-1]
+            if frame_type == STREAM_SCHEMA:
+                self.schema = parse_schema(payload)
+                continue
+            if frame_type == STREAM_EVENT and len(payload) == struct.calcsize(EVENT_FMT):
+                _, _, tag, arg, value = struct.unpack(EVENT_FMT, payload)
+                rows.append(f"#{self.elapsed_ms(timestamp_us):.4f};{format_event(tag, arg, value)}")
+                continue
+            if frame_type != STREAM_RECORD or self.schema is None:
+                continue
+
+            rows.append([self.elapsed_ms(timestamp_us)] + decode_record(self.schema, payload))
+        return rows
+
+    def elapsed_ms(self, timestamp_us):
+        # The microsecond tick is 32 bits wide, unwrap it
+        if self.last_timestamp is not None and timestamp_us < self.last_timestamp:
+            self.timestamp_offset += 1 << 32
+        self.last_timestamp = timestamp_us
+        timestamp_us += self.timestamp_offset
+        if self.first_timestamp is None:
+            self.first_timestamp = timestamp_us
+
+        return (timestamp_us - self.first_timestamp) / 1000.0
+
+
+def save_log_to_disk(header, lines):
+    """Stores the decoded rows in the same format plot_control_usb.py reads."""
+    date_folder = os.path.join("logs", datetime.now().strftime("%Y-%m-%d"))
+    os.makedirs(date_folder, exist_ok=True)
+    log_path = os.path.join(date_folder, f"stream_{datetime.now().strftime('%H-%M-%S')}.txt")
+    with open(log_path, "w") as f:
+        f.write(header + "\n")
+        f.write("\n".join(lines))
+    print(f"\n[Success] Log safely stored to: {log_path}")
+
+
+def format_row(row):
+    # Events already come as "#t;label" lines
+    if isinstance(row, str):
+        return row
+    return ";".join(f"{v:.4f}" for v in row)
+
+
+def main():
+    signal.signal(signal.SIGINT, signal_handler)
+
+    if len(sys.argv) > 1 and os.path.isfile(sys.argv[1]):
+        # Offline decode of a raw capture, e.g. `cat /dev/ttyACM0 > capture.bin`
+        parser = FrameParser()
+        with open(sys.argv[1], 'rb') as f:
+            rows = parser.feed(f.read())
+        print(parser.columns())
+        for row in rows:
+            print(format_row(row))
+        print(f"frames={parser.frames} lost={parser.lost} bad={parser.bad}", file=sys.stderr)
+        return
+
+    port = sys.argv[1] if len(sys.argv) > 1 else SERIAL_PORT
+    parser = FrameParser()
+    lines = []
+    try:
+        with serial.Serial(port, BAUD_RATE, timeout=READ_TIMEOUT) as ser:
+            print(f"Listening on {port}, Ctrl+C to stop and save.")
+            while True:
+                for row in parser.feed(ser.read(4096)):
+                    lines.append(format_row(row))
+                    if isinstance(row, str):
+                        print(f"\n{row}")
+                    elif len(lines) % 100 == 0:
+                        print(f"\r t={row[0]:8.1f} ms  {parser.schema[0][0]}={row[1]:8.3f}  "
+                              f"frames={parser.frames} lost={parser.lost} bad={parser.bad}", end="")
+    except KeyboardInterrupt:
+        pass
+    except serial.SerialException as e:
+        print(f"Serial error: {e}")
+
+    if lines:
+        save_log_to_disk(parser.columns(), lines)
+
+
+if __name__ == "__main__":
+    main()
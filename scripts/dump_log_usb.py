@@ -0,0 +1,260 @@
+import serial
+import struct
+import sys
+import os
+import time
+import zlib
+from datetime import datetime
+
+# --- Configuration ---
+SERIAL_PORT = '/dev/ttyACM0'
+BAUD_RATE = 115200
+READ_TIMEOUT = 0.2
+WAIT_FOR_DUMP_S = 60.0  # Time to press the log button on the robot
+NEXT_DUMP_S = 2.0       # Stored runs follow each other, stop after this long without one
+
+# Layout of services::Logger::DumpHeader and SchemaEntry
+MAGIC = b'FJLG'
+SCHEMA_VERSION = 6
+HEADER_FMT = '<4sBBBBIIIBIHI'
+NO_TRIGGER = 0xFFFFFFFF
+
+# services::Logger::LogEvent and EventTag
+EVENT_FMT = '<IIBBh'
+EVENT_STATE, EVENT_MOVEMENT, EVENT_WALL_BREAK, EVENT_MAZE_STEP, EVENT_FLOOD_FILL, EVENT_TRIGGER = range(6)
+
+# Argument names, in the order of state_index() in fsm.cpp and of the enums in utils/types.hpp
+STATE_NAMES = [
+    'Idle', 'PreSearch', 'SearchWaitStart', 'SearchParamSelect', 'SearchExploreModeSelect', 'Search', 'PreRun',
+    'RunWaitStart', 'Run', 'RunParamSelect', 'RunMoveModeSelect', 'RunMapSelect', 'PreCalib',
+    'CalibrationModeSelect', 'CalibrationIRSensors', 'CalibrationIMU', 'CalibrationFan', 'CalibrationMotors'
+]
+MOVEMENT_NAMES = [
+    'START', 'FORWARD', 'DIAGONAL', 'TURN_RIGHT_45', 'TURN_LEFT_45', 'TURN_RIGHT_90', 'TURN_LEFT_90',
+    'TURN_RIGHT_135', 'TURN_LEFT_135', 'TURN_RIGHT_180', 'TURN_LEFT_180', 'TURN_RIGHT_45_FROM_45',
+    'TURN_LEFT_45_FROM_45', 'TURN_RIGHT_90_FROM_45', 'TURN_LEFT_90_FROM_45', 'TURN_RIGHT_135_FROM_45',
+    'TURN_LEFT_135_FROM_45', 'TURN_AROUND', 'TURN_RIGHT_90_SEARCH_MODE', 'TURN_LEFT_90_SEARCH_MODE',
+    'TURN_AROUND_INPLACE', 'STOP'
+]
+DIRECTION_NAMES = ['NORTH', 'WEST', 'SOUTH', 'EAST', 'STOP']
+
+# services::Logger::TriggerSource bits
+TRIGGER_NAMES = ['emergency', 'wall break', 'movement', 'speed', 'command']
+
+# services::Logger::Compression
+COMPRESSION_NONE = 0
+COMPRESSION_LINEAR = 2
+SCHEMA_ENTRY_FMT = '<BB10sff'
+
+
+class Reader:
+    """Exact-length reads from either a serial port or a captured file."""
+
+    def __init__(self, source, live):
+        self.source = source
+        self.live = live
+
+    def read(self, size, deadline):
+        data = bytearray()
+        while len(data) < size:
+            chunk = self.source.read(size - len(data))
+            if not chunk and (not self.live or time.time() > deadline):
+                raise EOFError(f"Dump truncated after {len(data)} of {size} bytes")
+            data.extend(chunk)
+        return bytes(data)
+
+
+def lookup(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def format_event(tag, arg, value):
+    """Human readable label of a services::Logger::LogEvent, used for the plot overlays."""
+    if tag == EVENT_STATE:
+        return f"state {lookup(STATE_NAMES, arg)}"
+    if tag == EVENT_MOVEMENT:
+        return f"{lookup(MOVEMENT_NAMES, arg)} x{value}"
+    if tag == EVENT_WALL_BREAK:
+        return f"wall break {'LEFT' if arg == 0 else 'RIGHT'} error {value} mm"
+    if tag == EVENT_MAZE_STEP:
+        return f"step {lookup(DIRECTION_NAMES, arg)} at ({value & 0xFF},{value >> 8})"
+    if tag == EVENT_FLOOD_FILL:
+        return f"flood fill {value} us"
+    if tag == EVENT_TRIGGER:
+        return "trigger " + ", ".join(name for bit, name in enumerate(TRIGGER_NAMES) if arg & (1 << bit))
+    return f"event {tag} {arg} {value}"
+
+
+def parse_schema(raw_schema):
+    """Returns (name, bits, min_value, scale) per logged channel, in record order."""
+    schema = []
+    for _, bits, name, min_value, scale in struct.iter_unpack(SCHEMA_ENTRY_FMT, raw_schema):
+        schema.append((name.split(b'\0')[0].decode(), bits, min_value, scale))
+    return schema
+
+
+def decode_record(schema, record_bytes):
+    """Unpacks the fields the firmware bit packer wrote LSB first and applies the quantisation."""
+    record = int.from_bytes(record_bytes, 'little')
+    values = []
+    shift = 0
+    for _, bits, min_value, scale in schema:
+        values.append(((record >> shift) & ((1 << bits) - 1)) / scale + min_value)
+        shift += bits
+    return values
+
+
+class BitReader:
+    """Mirror of bit_packer::Reader in the firmware."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, bits):
+        first = self.pos >> 3
+        window = int.from_bytes(self.data[first:first + (bits >> 3) + 2], 'little')
+        result = (window >> (self.pos & 7)) & ((1 << bits) - 1)
+        self.pos += bits
+        return result
+
+    def read_exp_golomb(self):
+        suffix_bits = 0
+        while self.read(1) == 0:
+            suffix_bits += 1
+        return ((1 << suffix_bits) | self.read(suffix_bits)) - 1
+
+
+def decode_compressed(schema, compression, payload, record_count):
+    """Undoes the keyframe + predicted residual encoding of Logger::store_record."""
+    reader = BitReader(payload)
+    prev = [0] * len(schema)
+    prev2 = [0] * len(schema)
+    records = []
+    for _ in range(record_count):
+        keyframe = reader.read(1)
+        quantised = []
+        for i, (_, bits, _, _) in enumerate(schema):
+            if keyframe:
+                quantised.append(reader.read(bits))
+                continue
+            prediction = prev[i]
+            if compression == COMPRESSION_LINEAR:
+                prediction = min(max(2 * prev[i] - prev2[i], 0), (1 << bits) - 1)
+            zigzag = reader.read_exp_golomb()
+            quantised.append(prediction + ((zigzag >> 1) ^ -(zigzag & 1)))
+        prev2 = list(quantised) if keyframe else prev
+        prev = quantised
+        records.append([q / scale + min_value for q, (_, _, min_value, scale) in zip(quantised, schema)])
+    return records
+
+
+def wait_for_magic(reader, deadline):
+    window = b''
+    while window != MAGIC:
+        window = (window + reader.read(1, deadline))[-len(MAGIC):]
+    return window
+
+
+def decode_dump(reader, wait_s):
+    deadline = time.time() + wait_s
+    raw_header = wait_for_magic(reader, deadline)
+    deadline = time.time() + 10.0
+    raw_header += reader.read(struct.calcsize(HEADER_FMT) - len(MAGIC), deadline)
+    (_, version, record_size, channel_count, compression, record_count, payload_size, trigger_record,
+     trigger_source, first_record, event_count, run_number) = struct.unpack(HEADER_FMT, raw_header)
+    if version != SCHEMA_VERSION:
+        raise ValueError(f"Unsupported log schema version {version}")
+
+    raw_schema = reader.read(struct.calcsize(SCHEMA_ENTRY_FMT) * channel_count, deadline)
+    schema = parse_schema(raw_schema)
+
+    raw_records = reader.read(payload_size, deadline)
+    raw_events = reader.read(struct.calcsize(EVENT_FMT) * event_count, deadline)
+    (expected_crc,) = struct.unpack('<I', reader.read(4, deadline))
+    crc = zlib.crc32(raw_header + raw_schema + raw_records + raw_events)
+    if crc != expected_crc:
+        raise ValueError(f"CRC mismatch: got {crc:08x}, expected {expected_crc:08x}")
+
+    if trigger_source != 0:
+        sources = ", ".join(name for bit, name in enumerate(TRIGGER_NAMES) if trigger_source & (1 << bit))
+        where = f"record {trigger_record}" if trigger_record != NO_TRIGGER else "before the kept window"
+        print(f"Triggered by {sources} at {where}")
+
+    if compression == COMPRESSION_NONE:
+        rows = [[idx] + decode_record(schema, raw_records[idx * record_size:(idx + 1) * record_size])
+                for idx in range(record_count)]
+    else:
+        rows = [[idx] + values for idx, values in enumerate(decode_compressed(schema, compression, raw_records,
+                                                                              record_count))]
+
+    # Events are placed on the record index that followed them, one record per millisecond
+    events = [(record - first_record, format_event(tag, arg, value))
+              for record, _, tag, arg, value in struct.iter_unpack(EVENT_FMT, raw_events)]
+
+    return "t;" + ";".join(name for name, _, _, _ in schema), rows, events, run_number
+
+
+def format_lines(rows, events):
+    """Record rows in the print_log format with "#t;label" event lines ahead of the record they precede."""
+    lines = []
+    pending = iter(events)
+    event = next(pending, None)
+    for row in rows:
+        while event is not None and event[0] <= row[0]:
+            lines.append(f"#{event[0]};{event[1]}")
+            event = next(pending, None)
+        lines.append(f"{row[0]};" + ";".join(f"{v:.4f}" for v in row[1:]))
+    while event is not None:
+        lines.append(f"#{event[0]};{event[1]}")
+        event = next(pending, None)
+    return lines
+
+
+def save_log_to_disk(header, lines, run_number):
+    """Stores the lines in the print_log format that plot_control_usb.py reads."""
+    date_folder = os.path.join("logs", datetime.now().strftime("%Y-%m-%d"))
+    os.makedirs(date_folder, exist_ok=True)
+    log_path = os.path.join(date_folder, f"log_run{run_number}_{datetime.now().strftime('%H-%M-%S')}.txt")
+    with open(log_path, "w") as f:
+        f.write(header + "\n")
+        f.write("\n".join(lines))
+    print(f"[Success] Log safely stored to: {log_path}")
+
+
+def receive_dumps(reader):
+    """Decodes the RAM capture or every stored run the robot sends, one after the other."""
+    dumps = []
+    start = time.time()
+    try:
+        while True:
+            header, rows, events, run_number = decode_dump(reader, NEXT_DUMP_S if dumps else WAIT_FOR_DUMP_S)
+            print(f"Run {run_number}: {len(rows)} records and {len(events)} events in {time.time() - start:.2f} s")
+            dumps.append((header, format_lines(rows, events), run_number))
+            start = time.time()
+    except EOFError:
+        if not dumps:
+            raise
+    return dumps
+
+
+def main():
+    source = sys.argv[1] if len(sys.argv) > 1 else SERIAL_PORT
+    try:
+        if os.path.isfile(source):
+            with open(source, 'rb') as f:
+                dumps = receive_dumps(Reader(f, False))
+        else:
+            with serial.Serial(source, BAUD_RATE, timeout=READ_TIMEOUT) as ser:
+                print(f"Waiting for a log dump on {source} (long press the log button)...")
+                dumps = receive_dumps(Reader(ser, True))
+    except (EOFError, ValueError, serial.SerialException) as e:
+        print(f"Error: {e}")
+        sys.exit(1)
+
+    for header, lines, run_number in dumps:
+        save_log_to_disk(header, lines, run_number)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+Computes the discrete LQR gains used by the firmware state-space controller (algorithm::LQR).
+
+State:  x = [e_v, e_w, int(e_v), int(e_w)]  (errors are target - measured)
+Input:  u = [u_lin, u_ang]                   (motor current units [A], same as the PID outputs)
+Mixing: i_left = u_lin - u_ang, i_right = u_lin + u_ang
+
+The model is a differential drive robot with independent left/right motor constants. The mixing above splits it
+into a linear and an angular plant, and only a mismatch between KT_LEFT and KT_RIGHT couples them, so with matched
+motors K is block diagonal: two SISO LQRs, [e_v, int(e_v)] -> u_lin and [e_w, int(e_w)] -> u_ang. Their gains still
+come from one Q/R trade off. Run it and paste the output in firmware/inc/algorithms/lqr_gains.hpp.
+
+Only the Python standard library is used, so it runs anywhere.
+"""
+import argparse
+
+# --- Robot model ---
+MASS_KG = 0.110
+INERTIA_KG_M2 = 8.0e-5
+WHEEL_RADIUS_M = 0.01275
+WHEELS_DIST_M = 0.070
+KT_LEFT = 0.0064  # Motor torque constant [Nm/A]
+KT_RIGHT = 0.0064
+LINEAR_DAMPING = 0.05  # [N / (m/s)]
+ANGULAR_DAMPING = 1.0e-4  # [Nm / (rad/s)]
+
+CONTROL_PERIOD_S = 0.001
+
+# --- Weights ---
+Q_DIAG = [1.0, 0.01, 1000.0, 2.0]
+R_DIAG = [0.03, 1.0]
+
+
+def mat_mul(a, b):
+    return [[sum(a[i][k] * b[k][j] for k in range(len(b))) for j in range(len(b[0]))] for i in range(len(a))]
+
+
+def mat_add(a, b):
+    return [[a[i][j] + b[i][j] for j in range(len(a[0]))] for i in range(len(a))]
+
+
+def mat_sub(a, b):
+    return [[a[i][j] - b[i][j] for j in range(len(a[0]))] for i in range(len(a))]
+
+
+def mat_scale(a, k):
+    return [[a[i][j] * k for j in range(len(a[0]))] for i in range(len(a))]
+
+
+def transpose(a):
+    return [list(row) for row in zip(*a)]
+
+
+def identity(n):
+    return [[1.0 if i == j else 0.0 for j in range(n)] for i in range(n)]
+
+
+def diag(values):
+    return [[values[i] if i == j else 0.0 for j in range(len(values))] for i in range(len(values))]
+
+
+def inverse(a):
+    n = len(a)
+    m = [row[:] + identity(n)[i] for i, row in enumerate(a)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(m[r][col]))
+        m[col], m[pivot] = m[pivot], m[col]
+        p = m[col][col]
+        m[col] = [v / p for v in m[col]]
+        for r in range(n):
+            if r != col:
+                f = m[r][col]
+                m[r] = [m[r][j] - f * m[col][j] for j in range(2 * n)]
+    return [row[n:] for row in m]
+
+
+def expm(a, terms=20):
+    result = identity(len(a))
+    term = identity(len(a))
+    for k in range(1, terms):
+        term = mat_scale(mat_mul(term, a), 1.0 / k)
+        result = mat_add(result, term)
+    return result
+
+
+def continuous_model():
+    r = WHEEL_RADIUS_M
+    half_w = WHEELS_DIST_M / 2.0
+
+    # Forces on each wheel: F = kt * i / r, with i_left = u_lin - u_ang and i_right = u_lin + u_ang
+    fl = [KT_LEFT / r, -KT_LEFT / r]
+    fr = [KT_RIGHT / r, KT_RIGHT / r]
+
+    a = [[-LINEAR_DAMPING / MASS_KG, 0.0], [0.0, -ANGULAR_DAMPING / INERTIA_KG_M2]]
+    b = [
+        [(fl[0] + fr[0]) / MASS_KG, (fl[1] + fr[1]) / MASS_KG],
+        [half_w * (fr[0] - fl[0]) / INERTIA_KG_M2, half_w * (fr[1] - fl[1]) / INERTIA_KG_M2],
+    ]
+    return a, b
+
+
+def discretize(a, b, ts):
+    # Zero order hold through the exponential of the augmented matrix [[A, B], [0, 0]]
+    n, m = len(a), len(b[0])
+    aug = [[0.0] * (n + m) for _ in range(n + m)]
+    for i in range(n):
+        for j in range(n):
+            aug[i][j] = a[i][j] * ts
+        for j in range(m):
+            aug[i][n + j] = b[i][j] * ts
+    e = expm(aug)
+    ad = [row[:n] for row in e[:n]]
+    bd = [row[n:] for row in e[:n]]
+    return ad, bd
+
+
+def augment_with_integrals(ad, bd, ts):
+    # x = [v, w, qv, qw], q[k+1] = q[k] - ts * y[k] (regulation to zero)
+    a = [
+        [ad[0][0], ad[0][1], 0.0, 0.0],
+        [ad[1][0], ad[1][1], 0.0, 0.0],
+        [-ts, 0.0, 1.0, 0.0],
+        [0.0, -ts, 0.0, 1.0],
+    ]
+    b = [bd[0][:], bd[1][:], [0.0, 0.0], [0.0, 0.0]]
+    return a, b
+
+
+def dlqr(a, b, q, r, iterations=200000, tol=1e-12):
+    p = q
+    at = transpose(a)
+    bt = transpose(b)
+    for _ in range(iterations):
+        btp = mat_mul(bt, p)
+        k = mat_mul(inverse(mat_add(r, mat_mul(btp, b))), mat_mul(btp, a))
+        p_next = mat_add(q, mat_sub(mat_mul(mat_mul(at, p), a), mat_mul(mat_mul(at, mat_mul(p, b)), k)))
+        delta = max(abs(p_next[i][j] - p[i][j]) for i in range(len(p)) for j in range(len(p)))
+        p = p_next
+        if delta < tol * max(1.0, max(abs(v) for row in p for v in row)):
+            break
+    btp = mat_mul(bt, p)
+    return mat_mul(inverse(mat_add(r, mat_mul(btp, b))), mat_mul(btp, a))
+
+
+def firmware_gains(k):
+    # u = -K [v, w, qv, qw] with errors e = ref - y becomes u = K_v e + (-K_q) q
+    return [[k[i][0], k[i][1], -k[i][2], -k[i][3]] for i in range(len(k))]
+
+
+def c_float(value):
+    if abs(value) < 1e-9:
+        return "0.0f"
+    text = f"{value:.6g}"
+    if "." not in text and "e" not in text:
+        text += ".0"
+    return text + "f"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compute firmware LQR gains")
+    parser.add_argument("--ts", type=float, default=CONTROL_PERIOD_S, help="Control period [s]")
+    args = parser.parse_args()
+
+    a, b = continuous_model()
+    ad, bd = discretize(a, b, args.ts)
+    a_aug, b_aug = augment_with_integrals(ad, bd, args.ts)
+    k = firmware_gains(dlqr(a_aug, b_aug, diag(Q_DIAG), diag(R_DIAG)))
+
+    print("// Generated by scripts/lqr_gains.py")
+    print(f"// Q = {Q_DIAG}, R = {R_DIAG}, Ts = {args.ts}")
+    if all(abs(k[0][j]) < 1e-9 for j in (1, 3)) and all(abs(k[1][j]) < 1e-9 for j in (0, 2)):
+        print("// Matched motors leave no cross terms, so this is two SISO LQRs, linear and angular")
+    print("static constexpr float lqr_default_k[2][4] = {")
+    for row in k:
+        print("    {" + ", ".join(c_float(v) for v in row) + "},")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -5,6 +5,8 @@ import signal
 import os
 from datetime import datetime
 
+from dump_log_usb import format_event
+
 # --- Configuration ---
 SERIAL_PORT = '/dev/ttyACM0'
 BAUD_RATE = 115200
@@ -34,6 +36,13 @@ def save_log_to_disk(header, data_lines):
     except Exception as e:
         print(f"Error saving log file: {e}")
 
+def parse_event_line(line):
+    """Returns (time, label) of a "#t;label" event line, print_log writes "#t;tag;arg;value"."""
+    fields = line[1:].split(';')
+    if len(fields) == 4 and all(f.lstrip('-').isdigit() for f in fields[1:]):
+        return float(fields[0]), format_event(*(int(f) for f in fields[1:]))
+    return float(fields[0]), ";".join(fields[1:])
+
 def parse_log_file(file_path):
     """Reads a log file and returns a structured dictionary of data arrays."""
     if not os.path.exists(file_path):
@@ -50,7 +59,8 @@ def parse_log_file(file_path):
     if CONTROL_LOG_MODE:
         keys = [
             'time', 'lin_vel_act', 'lin_vel_tgt', 'ang_vel_act', 'ang_vel_tgt',
-            'pwm_left', 'pwm_right', 'imu_diff', 'vel_p', 'vel_i', 'ang_p', 'ang_i', 'rotation_ff', 'linear_ff'
+            'pwm_left', 'pwm_right', 'imu_diff', 'vel_p', 'vel_i', 'ang_p', 'ang_i', 'rotation_ff', 'linear_ff',
+            'dob_left', 'dob_right'
         ]
     else:
         keys = [
@@ -59,11 +69,15 @@ def parse_log_file(file_path):
         ]
 
     data_dict = {k: [] for k in keys}
+    data_dict['events'] = []
 
     for line in lines[1:]:
         line = line.strip()
         if not line: 
             continue
+        if line.startswith('#'):
+            data_dict['events'].append(parse_event_line(line))
+            continue
         try:
             fields = [float(x) for x in line.split(';')]
             # Handle legacy files dynamically: loop only up to the available column count
@@ -130,6 +144,9 @@ def plot_single(data_dict, title_suffix=""):
             axs[2, 1].set_title('Feed Forward Terms')
         else:
             axs[2, 1].set_title('Feed Forward (rotation_ff)')
+        if 'dob_left' in data_dict and len(data_dict['dob_left']) == len(t):
+            axs[2, 1].plot(t, data_dict['dob_left'], label='Disturbance Left', linestyle=':')
+            axs[2, 1].plot(t, data_dict['dob_right'], label='Disturbance Right', linestyle=':')
         axs[2, 1].set_ylabel('Value')
 
     else:
@@ -178,6 +195,14 @@ def plot_single(data_dict, title_suffix=""):
         ax.legend()
         ax.grid(True)
 
+    # Firmware events as vertical markers, labelled on the top row
+    for event_t, label in data_dict.get('events', []):
+        for ax in axs.flat:
+            ax.axvline(event_t, color='gray', linestyle=':', linewidth=0.8)
+        for ax in axs[0]:
+            ax.text(event_t, 1.0, label, transform=ax.get_xaxis_transform(), rotation=90, fontsize='x-small',
+                    va='top', ha='right', color='gray')
+
     fig.tight_layout(rect=[0, 0.03, 1, 0.95])
     plt.show()
 
@@ -304,11 +329,12 @@ def collect_print_and_plot_data():
     if CONTROL_LOG_MODE:
         keys = [
             'time', 'lin_vel_act', 'lin_vel_tgt', 'ang_vel_act', 'ang_vel_tgt',
-            'pwm_left', 'pwm_right', 'imu_diff', 'vel_p', 'vel_i', 'ang_p', 'ang_i', 'rotation_ff', 'linear_ff'
+            'pwm_left', 'pwm_right', 'imu_diff', 'vel_p', 'vel_i', 'ang_p', 'ang_i', 'rotation_ff', 'linear_ff',
+            'dob_left', 'dob_right'
         ]
         header = (
             "Time(ms);ActualLinearVel;TargetLinearVel;ActualAngularVel;TargetAngularVel;"
-            "PWML;PWMR;ImuDiff;VelP;VelI;AngP;AngI;RotationFF;LinearFF"
+            "PWML;PWMR;ImuDiff;VelP;VelI;AngP;AngI;RotationFF;LinearFF;DobLeft;DobRight"
         )
     else:
         keys = [
@@ -321,6 +347,7 @@ def collect_print_and_plot_data():
         )
 
     data_dict = {k: [] for k in keys}
+    data_dict['events'] = []
     data_lines = []
 
     try:
@@ -340,6 +367,11 @@ def collect_print_and_plot_data():
                 if not line:
                     break 
                 
+                if line.startswith('#'):
+                    data_lines.append(line)
+                    data_dict['events'].append(parse_event_line(line))
+                    continue
+
                 try:
                     fields = line.split(';')
                     if len(fields) >= len(fields): # parse whatever columns show up